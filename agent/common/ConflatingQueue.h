@@ -0,0 +1,198 @@
+/*
+ * Copyright 2018-present Open Networking Foundation
+
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CONFLATING_QUEUE_
+#define CONFLATING_QUEUE_
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <utility>
+
+/**
+ * @brief      FIFO queue that keeps only the latest of the items sharing a key
+ * @details    Same interface as Queue. Items for which key_of() returns true are
+ *             state-like: pushing one removes any still queued item with the same
+ *             key and appends the new one at the tail, so order relative to other
+ *             items is preserved and at most one item per key is ever queued.
+ *             Items for which key_of() returns false are event-like and are
+ *             queued in plain FIFO order.
+ */
+template <typename T, typename K>
+class ConflatingQueue
+{
+ public:
+  typedef bool (*key_fn)(const T& item, K* key);
+
+  explicit ConflatingQueue(key_fn key_of) : key_of_(key_of), conflated_(0) {}
+
+  bool pop(T& value,
+    std::chrono::milliseconds timeout_duration,
+    const std::chrono::milliseconds& check_interval=std::chrono::milliseconds(10)) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    while (queue_.empty()) {
+      if (cond_.wait_for(lock, check_interval) == std::cv_status::timeout) {
+        timeout_duration -= check_interval;
+        if (timeout_duration <= std::chrono::milliseconds::zero() ) {
+          return false;
+        }
+      }
+    }
+
+    value = take_front();
+    return true;
+  }
+
+  // timeout is in milliseconds, wait_granularity in milliseconds
+  std::pair<T, bool> pop(int timeout, int wait_granularity=10)
+  {
+    std::unique_lock<std::mutex> mlock(mutex_);
+    int duration = 0;
+    if (timeout < wait_granularity) {
+        wait_granularity = timeout;
+    }
+    while (queue_.empty())
+    {
+      if (cond_.wait_for(mlock, std::chrono::milliseconds(wait_granularity)) == std::cv_status::timeout)
+      {
+        duration+=wait_granularity;
+        if (duration > timeout)
+        {
+          return std::pair<T, bool>({}, false);
+        }
+      }
+    }
+    T val = take_front();
+    return std::pair<T, bool>(std::move(val), true);
+  }
+
+  void pop(T& item)
+  {
+    std::unique_lock<std::mutex> mlock(mutex_);
+    while (queue_.empty())
+    {
+      cond_.wait(mlock);
+    }
+    item = take_front();
+  }
+
+  void push(const T& item)
+  {
+    T copy(item);
+    push(std::move(copy));
+  }
+
+  void push(T&& item)
+  {
+    Entry entry;
+    entry.keyed = key_of_(item, &entry.key);
+    entry.item = std::move(item);
+
+    std::unique_lock<std::mutex> mlock(mutex_);
+    if (entry.keyed) {
+      typename std::map<K, typename std::list<Entry>::iterator>::iterator it = index_.find(entry.key);
+      if (it != index_.end()) {
+        // superseded by the new item
+        queue_.erase(it->second);
+        index_.erase(it);
+        conflated_++;
+      }
+    }
+    queue_.push_back(std::move(entry));
+    if (queue_.back().keyed) {
+      index_[queue_.back().key] = std::prev(queue_.end());
+    }
+    mlock.unlock();
+    cond_.notify_one();
+  }
+
+  /**
+   * @brief      put back an item that was popped but could not be delivered
+   * @details    The item goes back to the head of the queue, unless a newer item
+   *             with the same key has been pushed meanwhile, in which case the
+   *             returned item is stale and dropped.
+   */
+  void push_front(T&& item)
+  {
+    Entry entry;
+    entry.keyed = key_of_(item, &entry.key);
+    entry.item = std::move(item);
+
+    std::unique_lock<std::mutex> mlock(mutex_);
+    if (entry.keyed) {
+      if (index_.find(entry.key) != index_.end()) {
+        conflated_++;
+        return;
+      }
+    }
+    queue_.push_front(std::move(entry));
+    if (queue_.front().keyed) {
+      index_[queue_.front().key] = queue_.begin();
+    }
+    mlock.unlock();
+    cond_.notify_one();
+  }
+
+  /**
+   * @brief      returns the number of elements
+   * @return     Returns the number of elements currently queued.
+   */
+  std::size_t size() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return queue_.size();
+  }
+
+  /**
+   * @brief      returns the number of items dropped because a newer item with the same key was pushed
+   */
+  std::size_t conflated() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return conflated_;
+  }
+
+  ConflatingQueue(const ConflatingQueue&) = delete;            // disable copying
+  ConflatingQueue& operator=(const ConflatingQueue&) = delete; // disable assignment
+
+ private:
+  struct Entry {
+    T item;
+    bool keyed;
+    K key;
+  };
+
+  // mutex_ must be held and the queue must not be empty
+  T take_front() {
+    Entry& entry = queue_.front();
+    if (entry.keyed) {
+      index_.erase(entry.key);
+    }
+    T item = std::move(entry.item);
+    queue_.pop_front();
+    return item;
+  }
+
+  key_fn key_of_;
+  std::size_t conflated_;
+  std::list<Entry> queue_;
+  std::map<K, typename std::list<Entry>::iterator> index_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+};
+
+#endif
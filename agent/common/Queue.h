@@ -12,6 +12,7 @@
 #include <mutex>
 #include <condition_variable>
 #include <chrono>
+#include <utility>
 
 template <typename T>
 class Queue
@@ -42,7 +43,7 @@ class Queue
       }
     }
 
-    value = queue_.front();
+    value = std::move(queue_.front());
     queue_.pop();
     return true;
   }
@@ -78,9 +79,9 @@ class Queue
         }
       }
     }
-    auto val = queue_.front();
+    T val = std::move(queue_.front());
     queue_.pop();
-    return std::pair<T, bool>(val, true);
+    return std::pair<T, bool>(std::move(val), true);
   }
 
   void pop(T& item)
@@ -90,7 +91,7 @@ class Queue
     {
       cond_.wait(mlock);
     }
-    item = queue_.front();
+    item = std::move(queue_.front());
     queue_.pop();
   }
 
@@ -101,6 +102,16 @@ class Queue
     mlock.unlock();
     cond_.notify_one();
   }
+
+  // Elements are moved in and out of the queue, so large items such as
+  // indications carrying packets are never deep copied on the way through.
+  void push(T&& item)
+  {
+    std::unique_lock<std::mutex> mlock(mutex_);
+    queue_.push(std::move(item));
+    mlock.unlock();
+    cond_.notify_one();
+  }
   Queue()=default;
   Queue(const Queue&) = delete;            // disable copying
   Queue& operator=(const Queue&) = delete; // disable assignment
@@ -25,6 +25,7 @@ using grpc::Status;
 
 #include "state.h"
 #include "vendor.h"
+#include "async_log.h"
 
 extern "C"
 {
@@ -51,17 +52,35 @@ extern "C"
 #define LIGHT_RED "\033[1;31m"
 #define BROWN "\033[0;33m"
 #define LIGHT_GREEN "\033[1;32m"
+// Written before returning, after the messages queued by the calling thread
+#define OPENOLT_BCM_LOG_SYNC(level, id, fmt, ...) \
+    do { \
+        if (async_log_enabled()) \
+            async_log_flush_this_thread(); \
+        BCM_LOG(level, id, fmt, ##__VA_ARGS__); \
+    } while (0)
+
+// Deferred to the log thread while the asynchronous log is running
+#define OPENOLT_BCM_LOG(level, id, fmt, ...) \
+    do { \
+        if (decltype(async_log_check(__VA_ARGS__))::value && async_log_enabled()) { \
+            if (async_log_level_enabled(id, DEV_LOG_LEVEL_##level)) \
+                async_log(DEV_LOG_LEVEL_##level, id, fmt, ##__VA_ARGS__); \
+        } else \
+            OPENOLT_BCM_LOG_SYNC(level, id, fmt, ##__VA_ARGS__); \
+    } while (0)
+
 #define OPENOLT_LOG(level, id, fmt, ...)  \
     if (DEV_LOG_LEVEL_##level == DEV_LOG_LEVEL_ERROR) \
-        BCM_LOG(level, id, "%s" fmt "%s", LIGHT_RED, ##__VA_ARGS__, NONE); \
+        OPENOLT_BCM_LOG_SYNC(level, id, "%s" fmt "%s", LIGHT_RED, ##__VA_ARGS__, NONE); \
     else if (DEV_LOG_LEVEL_##level == DEV_LOG_LEVEL_INFO) \
-        BCM_LOG(level, id, "%s" fmt "%s", NONE, ##__VA_ARGS__, NONE); \
+        OPENOLT_BCM_LOG(level, id, "%s" fmt "%s", NONE, ##__VA_ARGS__, NONE); \
     else if (DEV_LOG_LEVEL_##level == DEV_LOG_LEVEL_WARNING) \
-        BCM_LOG(level, id, "%s" fmt "%s", BROWN, ##__VA_ARGS__, NONE); \
+        OPENOLT_BCM_LOG(level, id, "%s" fmt "%s", BROWN, ##__VA_ARGS__, NONE); \
     else if (DEV_LOG_LEVEL_##level == DEV_LOG_LEVEL_DEBUG) \
-        BCM_LOG(level, id, "%s" fmt "%s", LIGHT_GREEN, ##__VA_ARGS__, NONE); \
+        OPENOLT_BCM_LOG(level, id, "%s" fmt "%s", LIGHT_GREEN, ##__VA_ARGS__, NONE); \
     else \
-        BCM_LOG(INFO, id, fmt, ##__VA_ARGS__);
+        OPENOLT_BCM_LOG_SYNC(INFO, id, fmt, ##__VA_ARGS__);
 
 
 #define ACL_LOG(level,msg,err) \
@@ -177,6 +196,41 @@ extern "C"
 #define NUMBER_OF_PBITS 8
 #define MAX_NUMBER_OF_REPLICATED_FLOWS NUMBER_OF_PBITS
 #define GRPC_THREAD_POOL_SIZE 150
+#define MAX_OMCI_MSG_LENGTH 44 // OMCI baseline message size without CRC
+#define BAL_CONNECT_TIMEOUT 60 // in seconds
+#define BAL_READY_TIMEOUT 150 // in seconds
+#define BAL_PROBE_MIN_INTERVAL 10 // in milliseconds
+#define BAL_PROBE_MAX_INTERVAL 1000 // in milliseconds
+#define DEVICE_CAPABILITY_CACHE_FILE "./device_capability.cache"
+#define DEVICE_CAPABILITY_CACHE_VERSION 1
+#define WARM_RESTART_SCAN_FANOUT 8
+#define STATE_SNAPSHOT_FILE "./openolt_state.snapshot"
+#define STATE_JOURNAL_FILE "./openolt_state.journal"
+#define STATE_JOURNAL_SIZE (4 * 1024 * 1024) // in bytes, compacted at half full
+#define STATE_JOURNAL_SYNC_INTERVAL 20 // in milliseconds
+#define RECONCILE_PAGE_SIZE 64 // ONU indications queued at a time on reconciliation
+#define ONU_DISCOVERY_WINDOW 10 // in seconds, repeated discoveries of an ONU are suppressed for that long
+#define ONU_DISCOVERY_SUMMARY_INTERVAL 60 // in seconds
+#define STATS_SWEEP_INTERVAL 60 // in seconds, the ONU and GEM port statistics are read at that interval
+#define ONU_STATS_SWEEP_RATE 100 // ONU statistics read from BAL per second by the sweep
+#define GEM_STATS_SWEEP_RATE 500 // GEM port statistics read from BAL per second by the sweep
+#define FLOW_STATS_BUDGET 50 // flow statistics read from BAL per COLLECTION_PERIOD
+#define RSSI_SWEEP_INTERVAL 600 // in seconds, the rx power of the active ONUs is measured at that interval
+#define TRX_DDM_POLL_INTERVAL 0 // in seconds, the diagnostics of the PON transceivers are read at that interval, 0 disables it
+#define ASYNC_LOG_RING_SIZE (64 * 1024) // in bytes, per logging thread
+#define ASYNC_LOG_MAX_STRING 256 // longest string argument copied into the ring, with its terminator
+#define ASYNC_LOG_LINE_SIZE 512 // longest formatted log message
+#define ASYNC_LOG_POLL_INTERVAL 10 // in milliseconds, the log thread checks the rings at that interval while idle
+#define ASYNC_LOG_DROP_REPORT_INTERVAL 60 // in seconds
+#define STATS_HISTORY_DEPTH 60 // samples kept per port and ONU
+#define STATS_HISTORY_NNI_PORTS 16 // NNI ports with a statistics history
+#define STATS_HISTORY_EWMA_ALPHA 0.3 // weight of the last sample in the smoothed rates
+#define STATS_RATES_LOG_PERIOD 300 // in seconds, the smoothed rates of the ports are logged at that period
+#define THRESHOLD_WINDOW 300 // in seconds, the ONU counters are compared to the thresholds over that window
+#define THRESHOLD_BIP_ERROR_RATIO 1e-6 // bip_errors per bip_units
+#define THRESHOLD_FEC_UNCORRECTABLE_RATIO 1e-6 // fec_codewords_uncorrectable per fec_codewords
+#define GEM_TOP_TALKERS 64 // GEM ports counted per PON to find the top talkers
+#define GEM_TOP_TALKERS_LOGGED 5 // top talkers logged per PON after each statistics sweep
 
 #define GET_FLOW_INTERFACE_TYPE(type) \
        (type == BCMOLT_FLOW_INTERFACE_TYPE_PON) ? "PON" : \
@@ -223,8 +277,8 @@ Status SetStateUplinkIf_(uint32_t intf_id, bool set_state);
 uint32_t GetNniSpeed_(uint32_t intf_id);
 unsigned NumNniIf_();
 unsigned NumPonIf_();
-Status OmciMsgOut_(uint32_t intf_id, uint32_t onu_id, const std::string pkt);
-Status OnuPacketOut_(uint32_t intf_id, uint32_t onu_id, uint32_t port_no, uint32_t gemport_id, const std::string pkt);
+Status OmciMsgOut_(uint32_t intf_id, uint32_t onu_id, const std::string& pkt);
+Status OnuPacketOut_(uint32_t intf_id, uint32_t onu_id, uint32_t port_no, uint32_t gemport_id, const std::string& pkt);
 Status ProbeDeviceCapabilities_();
 Status ProbePonIfTechnology_();
 Status UplinkPacketOut_(uint32_t intf_id, const std::string pkt);
@@ -16,13 +16,36 @@
 
 #include <iostream>
 #include <unistd.h>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <vector>
 
 #include "server.h"
 #include "core.h"
 #include "src/core_data.h"
+#include "src/core_utils.h"
+#include "src/stats_collection.h"
+#include "src/threshold_alarms.h"
+#include "src/rssi_sweep.h"
+#include "src/trx_ddm_poller.h"
+#include "src/async_log.h"
+#include "src/state_journal.h"
 
 using namespace std;
 
+// Number of interfaces enabled concurrently at startup, --startup-fanout overrides it
+#define DEFAULT_STARTUP_FANOUT 8
+// Readiness conditions are polled at this interval instead of sleeping a fixed time
+#define STARTUP_POLL_INTERVAL std::chrono::milliseconds(100)
+#define ACTIVATION_TIMEOUT std::chrono::seconds(300)
+#define PON_READY_TIMEOUT std::chrono::seconds(10)
+
 /*
 *   This function displays openolt version, BAL version, openolt build date
 *   and other VCS params like VCS url, VCS ref, commit date and exits.
@@ -76,31 +99,174 @@ void display_version_info(int argc, char *argv[]) {
     }
 }
 
+/*
+*   Calls fn for every index in [0, count) using up to fanout threads.
+*/
+static void run_parallel(int count, uint32_t fanout, const std::function<void(int)>& fn) {
+    std::atomic<int> next(0);
+    std::vector<std::thread> workers;
+
+    if (count <= 0) {
+        return;
+    }
+    if (fanout > (uint32_t)count) {
+        fanout = count;
+    }
+    for (uint32_t t = 0; t < fanout; t++) {
+        workers.emplace_back([&]() {
+            for (int i = next++; i < count; i = next++) {
+                fn(i);
+            }
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+}
+
+/*
+*   Polls cond until it holds or timeout expires.
+*
+*   @return true if cond became true before the timeout
+*/
+static bool wait_for_condition(const std::function<bool()>& cond, std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!cond()) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(STARTUP_POLL_INTERVAL);
+    }
+    return true;
+}
+
+static long elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool pon_interface_active(int intf_id) {
+    bcmolt_interface_state intf_state;
+    bcmolt_status los_status;
+
+    return get_pon_interface_status((bcmolt_interface)intf_id, &intf_state, &los_status) == BCM_ERR_OK &&
+        intf_state == BCMOLT_INTERFACE_STATE_ACTIVE_WORKING;
+}
+
+/*
+*   Finds the value given to a command line option.
+*
+*   @return the argument following name, or NULL if the option is not given
+*/
+static const char* option_value(int argc, char *argv[], const char* name) {
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i-1], name) == 0) {
+            return argv[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+*   Parses the value of a command line option taking a non negative integer.
+*   value is left unchanged if the option is not given.
+*
+*   @return false if the value is not an integer in [0, UINT32_MAX]
+*/
+static bool parse_uint_option(int argc, char *argv[], const char* name, uint32_t* value) {
+    const char* arg = option_value(argc, argv, name);
+    if (arg == NULL) {
+        return true;
+    }
+    char* end;
+    errno = 0;
+    long long parsed = strtoll(arg, &end, 10);
+    if (end == arg || *end != '\0' || errno == ERANGE || parsed < 0 || parsed > UINT32_MAX) {
+        cout << "ERROR: " << name << " expects a non negative integer, got " << arg << endl;
+        return false;
+    }
+    *value = (uint32_t)parsed;
+    return true;
+}
+
+/*
+*   Parses the value of a command line option taking a non negative ratio.
+*   value is left unchanged if the option is not given.
+*
+*   @return false if the value is not a finite number >= 0
+*/
+static bool parse_ratio_option(int argc, char *argv[], const char* name, double* value) {
+    const char* arg = option_value(argc, argv, name);
+    if (arg == NULL) {
+        return true;
+    }
+    char* end;
+    errno = 0;
+    double parsed = strtod(arg, &end);
+    if (end == arg || *end != '\0' || errno == ERANGE || !std::isfinite(parsed) || parsed < 0) {
+        cout << "ERROR: " << name << " expects a non negative ratio, got " << arg << endl;
+        return false;
+    }
+    *value = parsed;
+    return true;
+}
+
 int main(int argc, char** argv) {
 
     display_version_info(argc, argv);
 
 #ifdef DYNAMIC_PON_TRX_SUPPORT
+    auto trx_begin = std::chrono::steady_clock::now();
     auto sfp = ponTrx.read_sfp_presence_data();
     if (sfp.size() == 0) {
         perror("sfp presence map could not be read\n");
         return 2;
     }
-    for (const auto& it : sfp) {
-        bool res = ponTrx.read_eeprom_data_for_sfp(it);
-        if (!res) {
-            cerr << "eeprom data for sfp could not be read: " << it << endl;
-            return 2;
-        }
+    long trx_presence_ms = elapsed_ms(trx_begin);
+    if (!ponTrx.read_and_decode_eeprom_data(sfp)) {
+        return 2;
+    }
+    cout << "PON Trx detection timing (ms): presence " << trx_presence_ms
+         << ", eeprom " << elapsed_ms(trx_begin) - trx_presence_ms
+         << ", total " << elapsed_ms(trx_begin) << endl;
+#endif
+    uint32_t fanout = DEFAULT_STARTUP_FANOUT;
+    double bip_threshold = THRESHOLD_BIP_ERROR_RATIO;
+    double fec_threshold = THRESHOLD_FEC_UNCORRECTABLE_RATIO;
+    if (!parse_uint_option(argc, argv, "--startup-fanout", &fanout) ||
+        !parse_uint_option(argc, argv, "--discovery-window", &onu_discovery_window) ||
+        !parse_uint_option(argc, argv, "--onu-stats-rate", &onu_stats_sweep_rate) ||
+        !parse_uint_option(argc, argv, "--gem-stats-rate", &gem_stats_sweep_rate) ||
+        !parse_uint_option(argc, argv, "--flow-stats-budget", &flow_stats_budget) ||
+        !parse_uint_option(argc, argv, "--rssi-interval", &rssi_sweep_interval) ||
+        !parse_uint_option(argc, argv, "--ddm-interval", &trx_ddm_poll_interval) ||
+        !parse_ratio_option(argc, argv, "--bip-threshold", &bip_threshold) ||
+        !parse_ratio_option(argc, argv, "--fec-threshold", &fec_threshold)) {
+        return 1;
     }
-    for (const auto &it : sfp) {
-        bool res = ponTrx.decode_eeprom_data(it);
-        if (!res) {
-            cerr << "eeprom data for sfp could not be decoded: " << it << endl;
-            return 2;
+    if (fanout < 1) {
+        fanout = 1;
+    }
+    set_onu_threshold_rule(ONU_THRESHOLD_BIP_ERRORS, bip_threshold, THRESHOLD_WINDOW);
+    set_onu_threshold_rule(ONU_THRESHOLD_FEC_UNCORRECTABLE, fec_threshold, THRESHOLD_WINDOW);
+
+    bool sync_log = false;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--sync-log") == 0) {
+            sync_log = true;
+            break;
         }
     }
-#endif
+    if (!sync_log) {
+        start_async_log();
+        // write the queued messages on any exit
+        atexit(stop_async_log);
+    }
+
+    // Enable_ opens the state journal, its sync thread is stopped on any exit
+    atexit(state_journal_close);
+
+    auto startup_begin = std::chrono::steady_clock::now();
+    auto phase_begin = startup_begin;
     Status status = Enable_(argc, argv);
     if (!status.ok()) {
         cout << "ERROR: Enable_ failed - "
@@ -108,48 +274,98 @@ int main(int argc, char** argv) {
                   << endl;
         return 1;
     }
+    long enable_ms = elapsed_ms(phase_begin);
 
     // Wait for successful activation before allowing VOLTHA to connect.
     // This is necessary to allow the device topology to be dynamically
     // queried from driver after initialization and activation is complete.
-    int maxTrials = 300;
-    while (!state.is_activated()) {
-        sleep(1);
-        if (--maxTrials == 0) {
-            cout << "ERROR: OLT/PON Activation failed" << endl;
-            return 1;
-        }
+    phase_begin = std::chrono::steady_clock::now();
+    if (!state.wait_until_activated(std::chrono::steady_clock::now() + ACTIVATION_TIMEOUT)) {
+        cout << "ERROR: OLT/PON Activation failed" << endl;
+        return 1;
     }
+    long activation_ms = elapsed_ms(phase_begin);
 
+    phase_begin = std::chrono::steady_clock::now();
     status = ProbeDeviceCapabilities_();
     if (!status.ok()) {
         cout << "ERROR: Could not find the OLT Device capabilities" << endl;
         return 1;
     }
+    long probe_ms = elapsed_ms(phase_begin);
 
-    sleep(2);
-    // Enable all PON interfaces.
-    for (int i = 0; i < NumPonIf_(); i++) {
-        status = EnablePonIf_(i);
-        if (!status.ok()) {
+    // Enable all PON interfaces, fanout of them at a time. Each one is enabled
+    // as soon as its interface object can be queried.
+    phase_begin = std::chrono::steady_clock::now();
+    std::vector<char> pon_enabled(NumPonIf_(), 0);
+    run_parallel(NumPonIf_(), fanout, [&](int i) {
+        bcmolt_interface_state intf_state;
+        bcmolt_status los_status;
+        wait_for_condition([&]() {
+            return get_pon_interface_status((bcmolt_interface)i, &intf_state, &los_status) == BCM_ERR_OK;
+        }, PON_READY_TIMEOUT);
+
+        Status pon_status = EnablePonIf_(i);
+        if (!pon_status.ok()) {
             // raise alarm to report error in enabling PON
             pushOltOperInd(i, "pon", "down", 0 /*Speed will be ignored in the adapter for PONs*/ );
         }
-        else
+        else {
+            pon_enabled[i] = 1;
             pushOltOperInd(i, "pon", "up", 0 /*Speed will be ignored in the adapter for PONs*/);
+        }
+    });
+    long pon_enable_ms = elapsed_ms(phase_begin);
+
+    // The NNIs are brought up once the enabled PONs have reached active working
+    phase_begin = std::chrono::steady_clock::now();
+    bool pons_ready = wait_for_condition([&]() {
+        for (int i = 0; i < NumPonIf_(); i++) {
+            if (pon_enabled[i] && !pon_interface_active(i)) {
+                return false;
+            }
+        }
+        return true;
+    }, PON_READY_TIMEOUT);
+    if (!pons_ready) {
+        cout << "WARNING: not all enabled PON interfaces reached active working state" << endl;
     }
-    sleep(2);
+    long pon_ready_ms = elapsed_ms(phase_begin);
+
     // Enable all NNI interfaces.
-    for (int i = 0; i < NumNniIf_(); i++) {
+    phase_begin = std::chrono::steady_clock::now();
+    run_parallel(NumNniIf_(), fanout, [&](int i) {
         uint32_t nni_speed = GetNniSpeed_(i);
-        status = SetStateUplinkIf_(i, true);
-        if (!status.ok()) {
+        Status nni_status = SetStateUplinkIf_(i, true);
+        if (!nni_status.ok()) {
             // raise alarm to report error in enabling PON
             pushOltOperInd(i, "nni", "down", nni_speed);
         }
         else
             pushOltOperInd(i, "nni", "up", nni_speed);
-    }
+    });
+    long nni_enable_ms = elapsed_ms(phase_begin);
+
+    cout << "Startup timing (ms): enable " << enable_ms
+         << ", activation " << activation_ms
+         << ", probe " << probe_ms
+         << ", pon enable " << pon_enable_ms
+         << ", pon ready " << pon_ready_ms
+         << ", nni enable " << nni_enable_ms
+         << ", total " << elapsed_ms(startup_begin)
+         << " (fanout " << fanout << ")" << endl;
+
+#ifdef STARTUP_TIME_MEASUREMENT
+    return 0;
+#endif
+
+    start_stats_sweep();
+    // the sweep threads are joined on any exit
+    atexit(stop_stats_sweep);
+    start_rssi_sweep();
+    atexit(stop_rssi_sweep);
+    start_trx_ddm_poller();
+    atexit(stop_trx_ddm_poller);
 
     for (int i = 1; i < argc; ++i) {
        if(strcmp(argv[i-1], "--interface") == 0 || (strcmp(argv[i-1], "--intf") == 0)) {
@@ -19,6 +19,8 @@
 #include <string>
 #include <time.h>
 #include <pthread.h>
+#include <mutex>
+#include <thread>
 
 #include "Queue.h"
 #include <iostream>
@@ -45,7 +47,47 @@ const char *serverPort = "0.0.0.0:9191";
 int signature;
 std::unique_ptr<Server> server;
 
-Queue<openolt::Indication> oltIndQ;
+// While voltha is slow or disconnected only the latest port statistics,
+// interface and ONU state is kept per object, see indication_conflation_key
+ConflatingQueue<openolt::Indication, indication_key> oltIndQ(indication_conflation_key);
+// OMCI and packet-in indications are queued separately from the control
+// indications so that a burst on one class does not hold back the others.
+Queue<openolt::Indication> omciIndQ;
+Queue<openolt::Indication> pktIndQ;
+
+/* Write one indication to the stream. When more indications are already
+   queued the write is only buffered, so a burst is coalesced by gRPC into
+   fewer HTTP/2 frames and syscalls instead of being flushed one by one. */
+static bool WriteIndication(ServerWriter<openolt::Indication>* writer, std::mutex& write_lock,
+        const openolt::Indication& ind, bool more_pending) {
+    grpc::WriteOptions options;
+
+    if (more_pending) {
+        options.set_buffer_hint();
+    }
+    std::lock_guard<std::mutex> lock(write_lock);
+    return writer->Write(ind, options);
+}
+
+/* Drain one indication queue onto the stream until the connection to voltha
+   is lost. write_lock serializes the writers sharing the same stream. */
+static void StreamIndications(Queue<openolt::Indication>& indQ,
+        ServerWriter<openolt::Indication>* writer, std::mutex& write_lock) {
+    openolt::Indication ind;
+
+    while (state.is_connected()) {
+        if (!indQ.pop(ind, std::chrono::milliseconds(1000), std::chrono::milliseconds(100))) {
+            continue;
+        }
+        bool isConnected = WriteIndication(writer, write_lock, ind, indQ.size() > 0);
+        if (!isConnected) {
+            //Lost connectivity to this Voltha instance
+            //Put the indication back in the queue for next connecting instance
+            indQ.push(std::move(ind));
+            state.disconnect();
+        }
+    }
+}
 
 class OpenoltService final : public openolt::Openolt::Service {
 
@@ -150,7 +192,8 @@ class OpenoltService final : public openolt::Openolt::Service {
         std::cout << "Connection to Voltha established. Indications enabled"
         << std::endl;
 
-        if (state.previously_connected()) {
+        bool reconciling = state.previously_connected();
+        if (reconciling) {
             // Reconciliation / recovery case
             std::cout << "Reconciliation / Recovery case" << std::endl;
             if (state.is_activated()){
@@ -165,12 +208,32 @@ class OpenoltService final : public openolt::Openolt::Service {
                     std::cout << "Extra OLT indication down" << std::endl;
                 }
                 ind.set_allocated_olt_ind(oltInd);
-                oltIndQ.push(ind);
+                oltIndQ.push(std::move(ind));
             }
         }
 
+        // The discoveries suppressed so far may not have reached this VOLTHA instance
+        for (uint32_t i = 0; i < MAX_SUPPORTED_PON; i++) {
+            onu_discovery_forget_pon(i);
+        }
         state.connect();
 
+        // The PON and ONU oper state is replayed to the reconciling adapter
+        // while the indications are streamed
+        std::thread replay;
+        if (reconciling && state.is_activated()) {
+            replay = std::thread([]() {
+                uint32_t num_onus = ReplayIndications(-1);
+                OPENOLT_LOG(INFO, openolt_log_id, "Replayed oper state of %u ONUs for reconciliation\n", num_onus);
+            });
+        }
+
+        // OMCI and packet-in are drained by their own writers, so they are not
+        // queued behind alarms and statistics on the way to the adapter.
+        std::mutex write_lock;
+        std::thread omci_writer(StreamIndications, std::ref(omciIndQ), writer, std::ref(write_lock));
+        std::thread pkt_writer(StreamIndications, std::ref(pktIndQ), writer, std::ref(write_lock));
+
         while (state.is_connected()) {
             std::pair<openolt::Indication, bool> ind = oltIndQ.pop(COLLECTION_PERIOD*1000, 1000);
             if (ind.second == false) {
@@ -178,17 +241,24 @@ class OpenoltService final : public openolt::Openolt::Service {
                 stats_collection();
                 continue;
             }
-            openolt::Indication oltInd = ind.first;
-            bool isConnected = writer->Write(oltInd);
+            openolt::Indication oltInd = std::move(ind.first);
+            bool isConnected = WriteIndication(writer, write_lock, oltInd, oltIndQ.size() > 0);
             if (!isConnected) {
                 //Lost connectivity to this Voltha instance
                 //Put the indication back in the queue for next connecting instance
-                oltIndQ.push(oltInd);
+                oltIndQ.push_front(std::move(oltInd));
                 state.disconnect();
             }
             //oltInd.release_olt_ind()
         }
 
+        // The writer is only valid for the lifetime of this call
+        omci_writer.join();
+        pkt_writer.join();
+        if (replay.joinable()) {
+            replay.join();
+        }
+
         return Status::OK;
     }
 
@@ -495,6 +565,15 @@ bool RunServer(int argc, char** argv) {
         credentials = grpc::InsecureServerCredentials();
     }
 
+    state.on_connected([]() {
+        OPENOLT_LOG(INFO, openolt_log_id, "%zu indications queued, %zu superseded indications dropped so far\n",
+            oltIndQ.size(), oltIndQ.conflated());
+    });
+    state.on_disconnected([]() {
+        OPENOLT_LOG(WARNING, openolt_log_id, "Lost connectivity to voltha, %zu indications queued\n",
+            oltIndQ.size() + omciIndQ.size() + pktIndQ.size());
+    });
+
     serverPort = ipAddress.append(":9191").c_str();
     OpenoltService service;
     std::string server_address(serverPort);
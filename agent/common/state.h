@@ -17,41 +17,102 @@
 #ifndef OPENOLT_STATE_H_
 #define OPENOLT_STATE_H_
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/* Connection and activation state of the agent. The flags are read lock free
+   from any thread; transitions are made under mutex_ so that threads blocked
+   in wait_until_activated() and the registered callbacks see every change
+   as soon as it happens. */
 class State {
   public:
+    typedef std::function<void()> callback;
 
     bool is_connected() {
-        return connected_to_voltha;
+        return connected_to_voltha.load();
     }
 
     bool is_activated() {
-        return activated;
+        return activated.load();
     }
 
     bool previously_connected() {
-        return connected_once;
+        return connected_once.load();
     }
 
     void connect() {
-        connected_to_voltha = true;
+        std::unique_lock<std::mutex> lock(mutex_);
         connected_once = true;
+        if (connected_to_voltha.exchange(true)) {
+            return;
+        }
+        std::vector<callback> callbacks(on_connected_);
+        lock.unlock();
+        cond_.notify_all();
+        for (auto& cb : callbacks) {
+            cb();
+        }
     }
 
     void disconnect() {
-        connected_to_voltha = false;
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!connected_to_voltha.exchange(false)) {
+            return;
+        }
+        std::vector<callback> callbacks(on_disconnected_);
+        lock.unlock();
+        cond_.notify_all();
+        for (auto& cb : callbacks) {
+            cb();
+        }
     }
 
     void activate() {
-        activated = true;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            activated = true;
+        }
+        cond_.notify_all();
     }
 
     void deactivate() {
-        activated = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            activated = false;
+        }
+        cond_.notify_all();
+    }
+
+    /* Block until the OLT is activated or the deadline passes.
+       Returns true if the OLT is activated. */
+    bool wait_until_activated(std::chrono::steady_clock::time_point deadline) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return cond_.wait_until(lock, deadline, [this]() { return activated.load(); });
+    }
+
+    /* Register a callback run on each transition to connected / disconnected
+       from voltha. Callbacks run on the thread making the transition. */
+    void on_connected(callback cb) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        on_connected_.push_back(cb);
+    }
+
+    void on_disconnected(callback cb) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        on_disconnected_.push_back(cb);
     }
 
   private:
-    bool connected_to_voltha = false;
-    bool activated = false;
-    bool connected_once = false;
+    std::atomic<bool> connected_to_voltha{false};
+    std::atomic<bool> activated{false};
+    std::atomic<bool> connected_once{false};
+    std::vector<callback> on_connected_;
+    std::vector<callback> on_disconnected_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
 };
 #endif
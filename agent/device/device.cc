@@ -14,6 +14,13 @@
  * limitations under the License.
  */
 
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
 #include "device.h"
 #include "vendor.h"
 #include "core_utils.h"
@@ -48,9 +55,35 @@ const set<int> PonTrxBase::get_sfp_presence_data() {
     return _sfp_presence_data;
 }
 
-// reads, updates and returns the _sfp_presence_data
-const set<int> PonTrxBase::read_sfp_presence_data() {
-    set<int> sp;
+// reads the sfp presence from the EEPROM files in sysfs. A PON Trx is present
+// if the first byte of its EEPROM can be read.
+// returns false if none of the EEPROM files exist
+bool PonTrxBase::read_sfp_presence_from_sysfs(set<int>& sp) {
+    bool found = false;
+    for (int i = 0; i < TOTAL_PON_TRX_PORTS; i++) {
+        if (!resolve_eeprom_read_path(i)) {
+            return false;
+        }
+        int fd = open(_eeprom_read_path[i].data(), O_RDONLY);
+        if (fd < 0) {
+            if (errno != ENOENT) {
+                found = true;
+            }
+            continue;
+        }
+        found = true;
+        unsigned char id;
+        if (read(fd, &id, 1) == 1) {
+            sp.insert(i);
+        }
+        close(fd);
+    }
+    return found;
+}
+
+// reads the sfp presence with the _sfp_presence_command of the platform
+// returns true if success
+bool PonTrxBase::read_sfp_presence_from_command(set<int>& sp) {
     // command to read the sfp presence array
     // The sample output of the command looks like below
     // root@localhost:~# onlpdump -p
@@ -59,17 +92,15 @@ const set<int> PonTrxBase::read_sfp_presence_data() {
     int status_code = system((command + " > temp.txt").c_str());
     if (status_code != 0) {
         perror("error getting sfp presence array from ONL\n");
-        // return the current _sfp_presence_data
-        return _sfp_presence_data;
+        return false;
     }
     ifstream ifs("temp.txt");
     string res = {istreambuf_iterator<char>(ifs), istreambuf_iterator<char>()};
     ifs.close(); // must close the inout stream so the file can be cleaned up
-    // If there is issue reading the sfp presence array, print error and return existing data
+    // If there is issue reading the sfp presence array, print error and keep the existing data
     if (remove("temp.txt") != 0) {
         perror("Error deleting temporary file");
-        // return the current sfp presence array
-        return _sfp_presence_data;
+        return false;
     }
 
     // parse the output of sfp presence command and read which PON Trx are connected/disconnected now
@@ -90,6 +121,22 @@ const set<int> PonTrxBase::read_sfp_presence_data() {
         }
     }
 
+    return true;
+}
+
+// reads, updates and returns the _sfp_presence_data
+const set<int> PonTrxBase::read_sfp_presence_data() {
+    set<int> sp;
+    // Checking the EEPROM files is much cheaper than forking the platform
+    // command, which is only needed where the EEPROMs are not in sysfs.
+    if (!read_sfp_presence_from_sysfs(sp)) {
+        cout << "no pon trx eeprom in sysfs, reading sfp presence with " << _sfp_presence_command << endl;
+        if (!read_sfp_presence_from_command(sp)) {
+            // return the current sfp presence array
+            return _sfp_presence_data;
+        }
+    }
+
     // If the current _sfp_presence_data is not same the newly read data,
     // update local copy and also raise an event.
     if (sp != _sfp_presence_data) {
@@ -123,18 +170,10 @@ const set<int> PonTrxBase::read_sfp_presence_data() {
     return _sfp_presence_data;
 }
 
-// reads the EEPROM data. The sfp_index is the bus index corresponding to the PON Trx
+// builds and caches the EEPROM file path of the PON Trx in _eeprom_read_path
 // returns true if success
-bool PonTrxBase::read_eeprom_data_for_sfp(int sfp_index) {
-    ifstream is;
-    int len;
+bool PonTrxBase::resolve_eeprom_read_path(int sfp_index) {
     array<char, EEPROM_READ_PATH_SIZE> path{};
-    array<unsigned char, EEPROM_DATA_READ_SIZE> data{};
-
-    if (sfp_index >= TOTAL_PON_TRX_PORTS) {
-        perror("invalid pon trx index\n");
-        return false;
-    }
 
     if (_eeprom_read_path.count(sfp_index) == 0) {
         _eeprom_read_path[sfp_index] = path;
@@ -144,6 +183,7 @@ bool PonTrxBase::read_eeprom_data_for_sfp(int sfp_index) {
         if ((_eeprom_file_path_format.length() + _eeprom_file_name.length() + 4) > PON_TRX_BUS_FORMAT_SIZE) {
             cerr << "resultant eeprom file length too long\n";
             delete []tmp_place_holder;
+            _eeprom_read_path.erase(sfp_index);
             return false;
         }
         strcpy(tmp_place_holder, _eeprom_file_path_format.c_str());
@@ -151,32 +191,127 @@ bool PonTrxBase::read_eeprom_data_for_sfp(int sfp_index) {
         memcpy(&_eeprom_read_path[sfp_index][0], file_name, PON_TRX_BUS_FORMAT_SIZE);
         delete []tmp_place_holder;
     }
+    return true;
+}
+
+// reads up to EEPROM_DATA_READ_SIZE bytes of the EEPROM file in as few reads as
+// the driver allows. Returns the number of bytes read, -1 if it cannot be opened
+static int read_eeprom_file(const char* path, array<unsigned char, EEPROM_DATA_READ_SIZE>& data) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    int cnt = 0;
+    while (cnt < EEPROM_DATA_READ_SIZE) {
+        ssize_t n = read(fd, data.data() + cnt, EEPROM_DATA_READ_SIZE - cnt);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        cnt += n;
+    }
+    close(fd);
+    return cnt;
+}
+
+// reads the EEPROM data. The sfp_index is the bus index corresponding to the PON Trx
+// returns true if success
+bool PonTrxBase::read_eeprom_data_for_sfp(int sfp_index) {
+    array<unsigned char, EEPROM_DATA_READ_SIZE> data{};
+
+    if (sfp_index >= TOTAL_PON_TRX_PORTS) {
+        perror("invalid pon trx index\n");
+        return false;
+    }
+
+    if (!resolve_eeprom_read_path(sfp_index)) {
+        return false;
+    }
     cout << "eeprom file to read is: " << _eeprom_read_path[sfp_index].data() << "for sfp " << sfp_index << endl;
-    FILE* fp = fopen(_eeprom_read_path[sfp_index].data(), "rb");
-    if (!fp) {
+    int cnt = read_eeprom_file(_eeprom_read_path[sfp_index].data(), data);
+    if (cnt < 0) {
         perror("failed to open file");
         _eeprom_read_path.erase(sfp_index);
         return false;
     }
-    _eeprom_data[sfp_index] = data;
-    int val, cnt = 0;
-
-    // Populate EEPROM data
-    while ((val = fgetc(fp)) != EOF && cnt < EEPROM_DATA_READ_SIZE) {
-        _eeprom_data[sfp_index][cnt] = (unsigned char)val;
-        cnt++;
-    }
-    fclose(fp);
     if (cnt != EEPROM_DATA_READ_SIZE) {
         cerr << "invalid length of data read:" << cnt << endl;
         _eeprom_read_path.erase(sfp_index);
         _eeprom_data.erase(sfp_index);
         return false;
     }
+    _eeprom_data[sfp_index] = data;
 
     return true;
 }
 
+// reads and decodes the EEPROM data of all the given PON Trx. Each PON Trx sits
+// on its own I2C bus, so the EEPROMs are read concurrently, one thread per PON
+// Trx, and then decoded one after the other. The read time of every PON Trx is
+// reported along with the time the whole read took.
+// returns true if success
+bool PonTrxBase::read_and_decode_eeprom_data(const set<int>& sfp_ids) {
+    struct eeprom_read {
+        int sfp_index;
+        array<char, EEPROM_READ_PATH_SIZE> path;
+        array<unsigned char, EEPROM_DATA_READ_SIZE> data;
+        int cnt;
+        long read_us;
+    };
+    vector<eeprom_read> reads;
+    vector<thread> readers;
+
+    // The path cache is only filled here, the reader threads get their own copy
+    for (int sfp_index : sfp_ids) {
+        if (sfp_index >= TOTAL_PON_TRX_PORTS) {
+            cerr << "invalid pon trx index: " << sfp_index << endl;
+            return false;
+        }
+        if (!resolve_eeprom_read_path(sfp_index)) {
+            return false;
+        }
+        reads.push_back({sfp_index, _eeprom_read_path[sfp_index], {}, 0, 0});
+    }
+
+    auto begin = chrono::steady_clock::now();
+    for (auto& r : reads) {
+        readers.emplace_back([&r]() {
+            auto read_begin = chrono::steady_clock::now();
+            r.cnt = read_eeprom_file(r.path.data(), r.data);
+            r.read_us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - read_begin).count();
+        });
+    }
+    for (auto& t : readers) {
+        t.join();
+    }
+    long total_us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - begin).count();
+
+    long sum_us = 0;
+    bool ret = true;
+    for (auto& r : reads) {
+        cout << "[" << r.sfp_index << "]" << " eeprom " << r.path.data() << " read in " << r.read_us / 1000.0 << " ms\n";
+        sum_us += r.read_us;
+        if (r.cnt != EEPROM_DATA_READ_SIZE) {
+            cerr << "eeprom data for sfp could not be read: " << r.sfp_index << ", length " << r.cnt << endl;
+            _eeprom_read_path.erase(r.sfp_index);
+            _eeprom_data.erase(r.sfp_index);
+            ret = false;
+            continue;
+        }
+        _eeprom_data[r.sfp_index] = r.data;
+        if (!decode_eeprom_data(r.sfp_index)) {
+            cerr << "eeprom data for sfp could not be decoded: " << r.sfp_index << endl;
+            ret = false;
+        }
+    }
+    cout << "eeprom read of " << reads.size() << " sfps took " << total_us / 1000.0
+         << " ms, " << sum_us / 1000.0 << " ms if read one after the other" << endl;
+
+    return ret;
+}
+
 // decodes the EEPROM data. The sfp_index is the bus index corresponding to the PON Trx
 // returns true if success
 bool PonTrxBase::decode_eeprom_data(int sfp_index) {
@@ -26,6 +26,7 @@
 #include <new>
 #include <set>
 #include <map>
+#include <array>
 
 extern "C"
 {
@@ -95,6 +96,10 @@ class PonTrxBase {
         // returns true if success
         bool read_eeprom_data_for_sfp(int sfp_index);
 
+        // Reads the EEPROM data of all the given PON Trx concurrently and decodes it
+        // returns true if success
+        bool read_and_decode_eeprom_data(const set<int>& sfp_ids);
+
         // Decodes the EEPROM data. The sfp_index is the bus index corresponding to the PON Trx
         // returns true if success
         bool decode_eeprom_data(int sfp_index);
@@ -114,6 +119,15 @@ class PonTrxBase {
         ~PonTrxBase();
 
     protected:
+        // Reads the sfp presence from the EEPROM files, returns false if there are none
+        bool read_sfp_presence_from_sysfs(set<int>& sp);
+
+        // Reads the sfp presence with the _sfp_presence_command, returns true if success
+        bool read_sfp_presence_from_command(set<int>& sp);
+
+        // Builds the EEPROM file path of the PON Trx into _eeprom_read_path, returns true if success
+        bool resolve_eeprom_read_path(int sfp_index);
+
         set<int> _sfp_presence_data;
         set<trx_data*> _t_data;
         map<int, array<char, EEPROM_READ_PATH_SIZE>> _eeprom_read_path;
@@ -37,8 +37,6 @@
 #define MAX_FLOW_ID 65535
 #define INVALID_FLOW_ID 0
 
-#define MAC_DEVICE_ACTIVATION_DELAY 200000 // in microseconds
-
 #define DEFAULT_MAC_SYSTEM_MODE BCMOLT_SYSTEM_MODE_GPON__16_X
 //#define DEFAULT_MAC_SYSTEM_MODE BCMOLT_SYSTEM_MODE_XGS__2_X
 #define DEFAULT_PON_MODE BCMOLT_PON_TYPE_GPON
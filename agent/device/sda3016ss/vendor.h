@@ -45,7 +45,6 @@
 #define MAX_FLOW_ID FLOW_ID_END
 #define INVALID_FLOW_ID 0
 
-#define MAC_DEVICE_ACTIVATION_DELAY 200000 // in microseconds
 ///////////////////////////////////////////////////////
 // Constants relevant for decoding PON Trx EEPROM Data
 
@@ -0,0 +1,257 @@
+/*
+ * Copyright 2018-present Open Networking Foundation
+
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "async_log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "core.h"
+#include "core_data.h"
+
+/* Written by the producer and read by the log thread. The positions only
+   grow, the offset in buf is the position modulo ASYNC_LOG_RING_SIZE. */
+typedef struct {
+    alignas(64) std::atomic<uint64_t> head; // written by the producer
+    alignas(64) std::atomic<uint64_t> tail; // written by the log thread
+    alignas(64) uint64_t cached_tail; // producer only
+    uint64_t next_head; // producer only, head once the reserved record is committed
+    std::atomic<bool> closed; // the producer thread has exited
+    alignas(8) char buf[ASYNC_LOG_RING_SIZE];
+} async_log_ring;
+
+std::atomic<bool> async_log_running(false);
+
+static std::atomic<uint64_t> async_log_dropped(0);
+static std::atomic<uint64_t> async_log_written(0);
+
+static std::vector<async_log_ring*> async_log_rings;
+static std::mutex async_log_rings_lock;
+// one consumer at a time, the log thread or async_log_flush
+static std::mutex async_log_drain_lock;
+
+static std::mutex async_log_lock;
+static std::condition_variable async_log_cond;
+static bool async_log_stopping = false;
+static std::thread async_log_thread;
+
+/* Owns the ring of a thread. The ring is freed by the log thread once the
+   thread has exited and the ring is drained. */
+struct async_log_ring_owner {
+    async_log_ring* ring = NULL;
+
+    ~async_log_ring_owner() {
+        if (ring != NULL) {
+            ring->closed.store(true, std::memory_order_release);
+        }
+    }
+};
+
+static thread_local async_log_ring_owner this_thread_ring;
+
+static async_log_ring* get_this_thread_ring() {
+    if (this_thread_ring.ring == NULL) {
+        async_log_ring* ring = new (std::nothrow) async_log_ring;
+        if (ring == NULL) {
+            return NULL;
+        }
+        ring->head.store(0, std::memory_order_relaxed);
+        ring->tail.store(0, std::memory_order_relaxed);
+        ring->cached_tail = 0;
+        ring->next_head = 0;
+        ring->closed.store(false, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(async_log_rings_lock);
+        async_log_rings.push_back(ring);
+        this_thread_ring.ring = ring;
+    }
+    return this_thread_ring.ring;
+}
+
+uint32_t async_log_strlen(const char* s) {
+    if (s == NULL) {
+        return 0;
+    }
+    return strnlen(s, ASYNC_LOG_MAX_STRING - 1) + 1;
+}
+
+char* async_log_reserve(uint32_t size) {
+    if (size > ASYNC_LOG_RING_SIZE / 4) {
+        async_log_dropped.fetch_add(1, std::memory_order_relaxed);
+        return NULL;
+    }
+    async_log_ring* ring = get_this_thread_ring();
+    if (ring == NULL) {
+        async_log_dropped.fetch_add(1, std::memory_order_relaxed);
+        return NULL;
+    }
+
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    uint32_t offset = head % ASYNC_LOG_RING_SIZE;
+    // a record does not wrap, the end of the ring is skipped instead
+    uint32_t skip = (ASYNC_LOG_RING_SIZE - offset < size) ? ASYNC_LOG_RING_SIZE - offset : 0;
+    if (head + skip + size - ring->cached_tail > ASYNC_LOG_RING_SIZE) {
+        ring->cached_tail = ring->tail.load(std::memory_order_acquire);
+        if (head + skip + size - ring->cached_tail > ASYNC_LOG_RING_SIZE) {
+            async_log_dropped.fetch_add(1, std::memory_order_relaxed);
+            return NULL;
+        }
+    }
+    if (skip) {
+        ((async_log_record*)(ring->buf + offset))->size = 0;
+        offset = 0;
+    }
+    ring->next_head = head + skip + size;
+    return ring->buf + offset;
+}
+
+void async_log_commit() {
+    async_log_ring* ring = this_thread_ring.ring;
+    ring->head.store(ring->next_head, std::memory_order_release);
+    /* The caller may have seen the log running just before stop_async_log
+       wrote the last messages. Pairs with the fence in stop_async_log: either
+       the final flush sees this record or this thread sees the log stopped. */
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!async_log_running.load(std::memory_order_relaxed)) {
+        async_log_flush_this_thread();
+    }
+}
+
+static uint32_t drain_async_log_ring(async_log_ring* ring) {
+    char line[ASYNC_LOG_LINE_SIZE];
+    uint32_t written = 0;
+    uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+
+    while (tail != head) {
+        uint32_t offset = tail % ASYNC_LOG_RING_SIZE;
+        async_log_record* rec = (async_log_record*)(ring->buf + offset);
+        if (rec->size == 0) {
+            tail += ASYNC_LOG_RING_SIZE - offset;
+            continue;
+        }
+        rec->format(line, sizeof(line), rec->fmt, ring->buf + offset + sizeof(async_log_record));
+        bcm_dev_log_log(rec->id, rec->level, 0, "%s", line);
+        tail += rec->size;
+        written++;
+        // give the space back as soon as possible, the producer never waits
+        ring->tail.store(tail, std::memory_order_release);
+    }
+    return written;
+}
+
+uint32_t async_log_flush() {
+    std::lock_guard<std::mutex> drain_lock(async_log_drain_lock);
+    std::vector<async_log_ring*> rings;
+    std::vector<async_log_ring*> closed;
+    uint32_t written = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(async_log_rings_lock);
+        rings = async_log_rings;
+    }
+    for (auto ring : rings) {
+        // closed is read before draining, so nothing is written after the last drain
+        bool ring_closed = ring->closed.load(std::memory_order_acquire);
+        written += drain_async_log_ring(ring);
+        if (ring_closed) {
+            closed.push_back(ring);
+        }
+    }
+    if (!closed.empty()) {
+        std::lock_guard<std::mutex> lock(async_log_rings_lock);
+        for (auto ring : closed) {
+            async_log_rings.erase(std::find(async_log_rings.begin(), async_log_rings.end(), ring));
+            delete ring;
+        }
+    }
+    async_log_written.fetch_add(written, std::memory_order_relaxed);
+    return written;
+}
+
+uint32_t async_log_flush_this_thread() {
+    async_log_ring* ring = this_thread_ring.ring;
+    if (ring == NULL) {
+        return 0;
+    }
+    // the ring is only freed once this thread has exited
+    std::lock_guard<std::mutex> drain_lock(async_log_drain_lock);
+    uint32_t written = drain_async_log_ring(ring);
+    async_log_written.fetch_add(written, std::memory_order_relaxed);
+    return written;
+}
+
+static void async_log_loop() {
+    uint64_t dropped_reported = async_log_dropped.load(std::memory_order_relaxed);
+    auto last_report = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(async_log_lock);
+    while (!async_log_stopping) {
+        lock.unlock();
+        uint32_t written = async_log_flush();
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_report >= std::chrono::seconds(ASYNC_LOG_DROP_REPORT_INTERVAL)) {
+            uint64_t dropped = async_log_dropped.load(std::memory_order_relaxed);
+            if (dropped != dropped_reported) {
+                BCM_LOG(WARNING, openolt_log_id, "%lu log messages dropped in the last %d seconds, %lu in total\n",
+                    dropped - dropped_reported, ASYNC_LOG_DROP_REPORT_INTERVAL, dropped);
+                dropped_reported = dropped;
+            }
+            last_report = now;
+        }
+        lock.lock();
+        // the producers do not wake the log thread up, it polls while idle
+        if (written == 0) {
+            async_log_cond.wait_for(lock, std::chrono::milliseconds(ASYNC_LOG_POLL_INTERVAL),
+                [] { return async_log_stopping; });
+        }
+    }
+}
+
+void start_async_log() {
+    std::lock_guard<std::mutex> lock(async_log_lock);
+    if (async_log_thread.joinable()) {
+        return;
+    }
+    async_log_stopping = false;
+    async_log_thread = std::thread(async_log_loop);
+    async_log_running.store(true, std::memory_order_relaxed);
+}
+
+void stop_async_log() {
+    {
+        std::lock_guard<std::mutex> lock(async_log_lock);
+        if (!async_log_thread.joinable()) {
+            return;
+        }
+        // the messages logged from now on are written synchronously
+        async_log_running.store(false, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        async_log_stopping = true;
+    }
+    async_log_cond.notify_all();
+    async_log_thread.join();
+    async_log_flush();
+}
+
+void get_async_log_stats(uint64_t* written, uint64_t* dropped) {
+    *written = async_log_written.load(std::memory_order_relaxed);
+    *dropped = async_log_dropped.load(std::memory_order_relaxed);
+}
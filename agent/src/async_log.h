@@ -0,0 +1,216 @@
+/*
+ * Copyright 2018-present Open Networking Foundation
+
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OPENOLT_ASYNC_LOG_H_
+#define OPENOLT_ASYNC_LOG_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+extern "C"
+{
+#include <bcmos_system.h>
+#include <bcm_dev_log.h>
+}
+
+/* While the asynchronous log is running, OPENOLT_LOG does not format the
+   message on the calling thread. It copies the format string pointer, which
+   identifies the message, and the raw arguments into a ring owned by the
+   thread. A background thread formats the messages and hands them to the BAL
+   logger. Each ring has a single producer, its thread, and a single consumer,
+   the log thread, so neither side takes a lock. When the ring of a thread is
+   full the message is dropped and counted. Messages below the level of their
+   log id are not queued.
+
+   Strings are copied into the ring, all other arguments must be scalars.
+   Messages with other arguments, ERROR and FATAL messages are logged
+   synchronously, so the last messages before a crash are not lost. The ring of
+   the calling thread is written first, the messages of a thread are written
+   in order. The messages of different threads are not ordered. */
+
+typedef int (*async_log_format_fn)(char* buf, size_t size, const char* fmt, const char* args);
+
+typedef struct {
+    uint32_t size; // of the record with its arguments, 0 marks a wrap to the start of the ring
+    bcm_dev_log_level level;
+    dev_log_id id;
+    const char* fmt;
+    async_log_format_fn format;
+} async_log_record;
+
+#define ASYNC_LOG_SLOT_SIZE 8 // bytes per argument, strings are stored after the slots
+
+extern std::atomic<bool> async_log_running;
+
+inline bool async_log_enabled() {
+    return async_log_running.load(std::memory_order_relaxed);
+}
+
+/* As BAL does before formatting, a message below the level of its log id is
+   not queued. The message is queued if the level cannot be read, BAL then
+   filters it when it is written. */
+inline bool async_log_level_enabled(dev_log_id id, bcm_dev_log_level level) {
+    bcm_dev_log_level level_print, level_save;
+    if (bcm_dev_log_id_get_level(id, &level_print, &level_save) != BCM_ERR_OK) {
+        return true;
+    }
+    return level <= level_print || level <= level_save;
+}
+
+/* Returns the space for a record of size bytes in the ring of the calling
+   thread, NULL if the record is dropped. */
+char* async_log_reserve(uint32_t size);
+/* Makes the record returned by the last async_log_reserve visible to the log thread */
+void async_log_commit();
+uint32_t async_log_strlen(const char* s);
+
+void start_async_log();
+/* Stops the log thread once all the queued messages are written */
+void stop_async_log();
+/* Writes the queued messages, returns the number written */
+uint32_t async_log_flush();
+/* Writes the queued messages of the calling thread, returns the number written */
+uint32_t async_log_flush_this_thread();
+void get_async_log_stats(uint64_t* written, uint64_t* dropped);
+
+/* Scalar arguments are copied into their slot. Other types are not supported,
+   OPENOLT_LOG logs them synchronously. */
+template <typename T, typename Enable = void>
+struct async_log_arg {
+    static const bool supported = false;
+    static uint32_t length(const T&) { return 0; }
+    static void put(char*, char*, const char*, const T&, uint32_t) {}
+    static int get(const char*, size_t) { return 0; }
+};
+
+template <typename T>
+struct async_log_arg<T, typename std::enable_if<std::is_arithmetic<T>::value || std::is_enum<T>::value ||
+        (std::is_pointer<T>::value && !std::is_same<typename std::remove_cv<typename std::remove_pointer<T>::type>::type, char>::value)>::type> {
+    static const bool supported = sizeof(T) <= ASYNC_LOG_SLOT_SIZE;
+    static uint32_t length(const T&) { return 0; }
+    static void put(char* slot, char*, const char*, const T& v, uint32_t) {
+        memcpy(slot, &v, sizeof(T));
+    }
+    static T get(const char* args, size_t i) {
+        T v;
+        memcpy(&v, args + i * ASYNC_LOG_SLOT_SIZE, sizeof(T));
+        return v;
+    }
+};
+
+/* The slot of a string holds its offset from the first slot, the characters
+   are copied after the slots. */
+template <typename T>
+struct async_log_arg<T, typename std::enable_if<std::is_pointer<T>::value &&
+        std::is_same<typename std::remove_cv<typename std::remove_pointer<T>::type>::type, char>::value>::type> {
+    static const bool supported = true;
+    static uint32_t length(const T& s) { return async_log_strlen(s); }
+    static void put(char* slot, char* str, const char* args, const T& s, uint32_t len) {
+        uint32_t offset = s ? str - args : UINT32_MAX;
+        memcpy(slot, &offset, sizeof(offset));
+        if (s) {
+            memcpy(str, s, len - 1);
+            str[len - 1] = '\0';
+        }
+    }
+    static const char* get(const char* args, size_t i) {
+        uint32_t offset;
+        memcpy(&offset, args + i * ASYNC_LOG_SLOT_SIZE, sizeof(offset));
+        return offset == UINT32_MAX ? NULL : args + offset;
+    }
+};
+
+template <typename... Args>
+struct async_log_args;
+
+template <>
+struct async_log_args<> {
+    static const bool supported = true;
+};
+
+template <typename T, typename... Args>
+struct async_log_args<T, Args...> {
+    static const bool supported = async_log_arg<T>::supported && async_log_args<Args...>::supported;
+};
+
+/* Only used in decltype, tells if the arguments can be logged asynchronously */
+template <typename... Args>
+std::integral_constant<bool, async_log_args<typename std::decay<Args>::type...>::supported> async_log_check(Args...);
+
+template <size_t... I>
+struct async_log_index {};
+
+template <size_t N, size_t... I>
+struct async_log_make_index : async_log_make_index<N - 1, N - 1, I...> {};
+
+template <size_t... I>
+struct async_log_make_index<0, I...> {
+    typedef async_log_index<I...> type;
+};
+
+/* Instantiated per argument list, formats the arguments of a record. This is
+   the only place where the message is formatted. */
+template <typename... Args>
+struct async_log_formatter {
+    template <size_t... I>
+    static int format(char* buf, size_t size, const char* fmt, const char* args, async_log_index<I...>) {
+        return snprintf(buf, size, fmt, async_log_arg<Args>::get(args, I)...);
+    }
+
+    static int format(char* buf, size_t size, const char* fmt, const char* args) {
+        return format(buf, size, fmt, args, typename async_log_make_index<sizeof...(Args)>::type());
+    }
+};
+
+/* Copies the message into the ring of the calling thread. Called by
+   OPENOLT_LOG, which makes sure async_log_check holds for the arguments. */
+template <typename... Args>
+void async_log(bcm_dev_log_level level, dev_log_id id, const char* fmt, Args... args) {
+    const size_t n = sizeof...(Args);
+    uint32_t lengths[n + 1] = {async_log_arg<typename std::decay<Args>::type>::length(args)...};
+    uint32_t size = sizeof(async_log_record) + n * ASYNC_LOG_SLOT_SIZE;
+
+    for (size_t i = 0; i < n; i++) {
+        size += lengths[i];
+    }
+    size = (size + 7) & ~7U;
+    char* rec = async_log_reserve(size);
+    if (rec == NULL) {
+        return;
+    }
+    async_log_record* hdr = (async_log_record*)rec;
+    hdr->size = size;
+    hdr->level = level;
+    hdr->id = id;
+    hdr->fmt = fmt;
+    hdr->format = &async_log_formatter<typename std::decay<Args>::type...>::format;
+
+    char* arg_slots = rec + sizeof(async_log_record);
+    char* slot = arg_slots;
+    char* str = arg_slots + n * ASYNC_LOG_SLOT_SIZE;
+    uint32_t* len = lengths;
+    // a braced list is evaluated in order
+    int unused[] = {0, (async_log_arg<typename std::decay<Args>::type>::put(slot, str, arg_slots, args, *len),
+        slot += ASYNC_LOG_SLOT_SIZE, str += *len++, 0)...};
+    (void)unused;
+    async_log_commit();
+}
+
+#endif
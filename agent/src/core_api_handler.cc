@@ -18,11 +18,14 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <cstdio>
+#include <fstream>
 
 #include "Queue.h"
 #include <sstream>
 #include <chrono>
 #include <thread>
+#include <vector>
 #include <bitset>
 #include <inttypes.h>
 #include <unistd.h>
@@ -35,9 +38,14 @@
 #include "core_data.h"
 #include "indications.h"
 #include "stats_collection.h"
+#include "stats_history.h"
+#include "threshold_alarms.h"
+#include "rssi_sweep.h"
 #include "error_format.h"
 #include "state.h"
 #include "core_utils.h"
+#include "warm_restart.h"
+#include "state_journal.h"
 
 extern "C"
 {
@@ -76,7 +84,6 @@ static bcmos_errno RemoveQueue(std::string direction, uint32_t access_intf_id, u
                                bcmolt_egress_qos_type qos_type, uint32_t priority, uint32_t gemport_id, uint32_t tech_profile_id);
 static bcmos_errno CreateDefaultSched(uint32_t intf_id, const std::string direction);
 static bcmos_errno CreateDefaultQueue(uint32_t intf_id, const std::string direction);
-static const std::chrono::milliseconds ONU_RSSI_COMPLETE_WAIT_TIMEOUT = std::chrono::seconds(10);
 
 inline const char *get_flow_acton_command(uint32_t command) {
     char actions[200] = { };
@@ -308,11 +315,86 @@ void reset_pon_device(bcmolt_odid dev)
     }
 }
 
+/* Connect a MAC device if it is not connected yet. Completion of the connect is
+   reported asynchronously through the device indications.
+   Returns BCM_ERR_ALREADY if the device was already connected and BCM_ERR_NOENT
+   if the device is skipped. */
+static bcmos_errno ConnectMacDevice(bcmolt_odid dev) {
+    bcmos_errno err;
+    bcmolt_device_cfg dev_cfg = { };
+    bcmolt_device_key dev_key = { };
+    dev_key.device_id = dev;
+    BCMOLT_CFG_INIT(&dev_cfg, device, dev_key);
+    BCMOLT_MSG_FIELD_GET(&dev_cfg, system_mode);
+
+    err = bcmolt_cfg_get(dev_id, &dev_cfg.hdr);
+    if (err != BCM_ERR_NOT_CONNECTED) {
+        return BCM_ERR_ALREADY;
+    }
+
+    bcmolt_device_key key = {.device_id = dev};
+    bcmolt_device_connect oper;
+    BCMOLT_OPER_INIT(&oper, device, connect, key);
+
+    /* BAL saves current state into dram_tune soc file and when dev_mgmt_daemon restarts
+    * it retains config from soc file. If openolt agent try to connect device without
+    * device reset device initialization fails hence doing device reset here. */
+    reset_pon_device(dev);
+    bcmolt_system_mode sm;
+    #ifdef DYNAMIC_PON_TRX_SUPPORT
+    auto sm_res = ponTrx.get_mac_system_mode(dev, ponTrx.get_sfp_presence_data());
+    if (!sm_res.second) {
+        OPENOLT_LOG(ERROR, openolt_log_id, "could not read mac system mode. dev_id = %d\n", dev);
+        return BCM_ERR_NOENT;
+    }
+    sm = sm_res.first;
+    #else
+    sm = DEFAULT_MAC_SYSTEM_MODE;
+    #endif
+    BCMOLT_MSG_FIELD_SET (&oper, system_mode, sm);
+    if (MODEL_ID == "asfvolt16") {
+        BCMOLT_MSG_FIELD_SET(&oper, inni_config.mode, BCMOLT_INNI_MODE_ALL_10_G_XFI);
+    } else if (MODEL_ID == "asgvolt64") {
+        BCMOLT_MSG_FIELD_SET(&oper, inni_config.mode, BCMOLT_INNI_MODE_ALL_10_G_XFI);
+        BCMOLT_MSG_FIELD_SET(&oper, inni_config.mux, BCMOLT_INNI_MUX_FOUR_TO_ONE);
+    } else if (MODEL_ID == "rlt-3200g-w" || MODEL_ID == "rlt-1600g-w") {
+        BCMOLT_MSG_FIELD_SET(&oper, inni_config.mux, BCMOLT_INNI_MUX_NONE);
+        if(dev == 1) {
+            BCMOLT_MSG_FIELD_SET(&oper, inni_config.mux, BCMOLT_INNI_MUX_FOUR_TO_ONE);
+        }
+        BCMOLT_MSG_FIELD_SET (&oper, ras_ddr_mode, BCMOLT_RAS_DDR_USAGE_MODE_TWO_DDRS);
+        BCMOLT_MSG_FIELD_SET(&oper, inni_config.mode, BCMOLT_INNI_MODE_ALL_10_G_XFI);
+    } else if (MODEL_ID == "rlt-1600x-w") {
+        BCMOLT_MSG_FIELD_SET(&oper, inni_config.mux, BCMOLT_INNI_MUX_NONE);
+        BCMOLT_MSG_FIELD_SET (&oper, ras_ddr_mode, BCMOLT_RAS_DDR_USAGE_MODE_TWO_DDRS);
+        BCMOLT_MSG_FIELD_SET(&oper, inni_config.mode, BCMOLT_INNI_MODE_ALL_10_G_XFI);
+    } else if (MODEL_ID == "sda3016ss") {
+        BCMOLT_MSG_FIELD_SET(&oper, inni_config.mode, BCMOLT_INNI_MODE_ALL_12_P_5_G);
+        BCMOLT_MSG_FIELD_SET(&oper, inni_config.mux, BCMOLT_INNI_MUX_TWO_TO_ONE);
+        BCMOLT_MSG_FIELD_SET (&oper, ras_ddr_mode, BCMOLT_RAS_DDR_USAGE_MODE_TWO_DDRS);
+    }
+
+    mac_device_connect_start(dev);
+    err = bcmolt_oper_submit(dev_id, &oper.hdr);
+    if (err) {
+        mac_device_connect_abort(dev);
+    }
+    return err;
+}
+
 Status Enable_(int argc, char *argv[]) {
     bcmos_errno err;
     bcmolt_host_init_parms init_parms = {};
     init_parms.transport.type = BCM_HOST_API_CONN_LOCAL;
     unsigned int failed_enable_device_cnt = 0;
+    bool warm_restart = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--warm-restart") == 0) {
+            warm_restart = true;
+            break;
+        }
+    }
 
     if (!state.is_activated()) {
 
@@ -356,6 +438,10 @@ Status Enable_(int argc, char *argv[]) {
         bcmos_fastlock_init(&acl_packet_trap_handler_lock, 0);
         bcmos_fastlock_init(&symmetric_datapath_flow_id_lock, 0);
         bcmos_fastlock_init(&pon_gem_to_onu_uni_map_lock, 0);
+        bcmos_fastlock_init(&mac_device_connect_lock, 0);
+        bcmos_fastlock_init(&onu_state_cache_lock, 0);
+        bcmos_fastlock_init(&onu_sn_index_lock, 0);
+        bcmos_fastlock_init(&onu_discovery_lock, 0);
 
 
         OPENOLT_LOG(INFO, openolt_log_id, "Enable OLT - %s-%s\n", VENDOR_ID, MODEL_ID);
@@ -382,82 +468,60 @@ Status Enable_(int argc, char *argv[]) {
         }
 
         {
-            bcmos_errno err;
-            bcmolt_odid dev;
+            bcmos_errno dev_err[BCM_MAX_DEVS_PER_LINE_CARD];
+            std::vector<std::thread> connect_threads;
             OPENOLT_LOG(INFO, openolt_log_id, "Enabling PON %d Devices ... \n", BCM_MAX_DEVS_PER_LINE_CARD);
-            for (dev = 0; dev < BCM_MAX_DEVS_PER_LINE_CARD; dev++) {
-                bcmolt_device_cfg dev_cfg = { };
-                bcmolt_device_key dev_key = { };
-                dev_key.device_id = dev;
-                BCMOLT_CFG_INIT(&dev_cfg, device, dev_key);
-                BCMOLT_MSG_FIELD_GET(&dev_cfg, system_mode);
-
+            // The MAC devices are connected concurrently, so the startup time is bounded by the
+            // slowest device. The OLT is activated from the device indications once all completed.
+            for (bcmolt_odid dev = 0; dev < BCM_MAX_DEVS_PER_LINE_CARD; dev++) {
+                dev_err[dev] = BCM_ERR_OK;
 		        /* FIXME: Single Phoenix BAL patch is prepared for all three variants of Radisys OLT
 		        * in which BCM_MAX_DEVS_PER_LINE_CARD macro need to be redefined as 1 incase of
 		        * "rlt-1600g-w" and "rlt-1600x-w", till then this workaround is required.*/
                 if (dev == 1 && (MODEL_ID == "rlt-1600g-w" || MODEL_ID == "rlt-1600x-w")) {
                     continue;
                 }
+                connect_threads.emplace_back([dev, &dev_err]() { dev_err[dev] = ConnectMacDevice(dev); });
+            }
+            for (auto& t : connect_threads) {
+                t.join();
+            }
 
-                err = bcmolt_cfg_get(dev_id, &dev_cfg.hdr);
-                if (err == BCM_ERR_NOT_CONNECTED) {
-                    bcmolt_device_key key = {.device_id = dev};
-                    bcmolt_device_connect oper;
-                    BCMOLT_OPER_INIT(&oper, device, connect, key);
-
-		            /* BAL saves current state into dram_tune soc file and when dev_mgmt_daemon restarts
-		            * it retains config from soc file. If openolt agent try to connect device without
-		            * device reset device initialization fails hence doing device reset here. */
-                    reset_pon_device(dev);
-                    bcmolt_system_mode sm;
-                    #ifdef DYNAMIC_PON_TRX_SUPPORT
-                    auto sm_res = ponTrx.get_mac_system_mode(dev, ponTrx.get_sfp_presence_data());
-                    if (!sm_res.second) {
-                        OPENOLT_LOG(ERROR, openolt_log_id, "could not read mac system mode. dev_id = %d\n", dev);
-                        continue;
-                    }
-                    sm = sm_res.first;
-                    #else
-                    sm = DEFAULT_MAC_SYSTEM_MODE;
-                    #endif
-                    BCMOLT_MSG_FIELD_SET (&oper, system_mode, sm);
-                    if (MODEL_ID == "asfvolt16") {
-                        BCMOLT_MSG_FIELD_SET(&oper, inni_config.mode, BCMOLT_INNI_MODE_ALL_10_G_XFI);
-                    } else if (MODEL_ID == "asgvolt64") {
-                        BCMOLT_MSG_FIELD_SET(&oper, inni_config.mode, BCMOLT_INNI_MODE_ALL_10_G_XFI);
-                        BCMOLT_MSG_FIELD_SET(&oper, inni_config.mux, BCMOLT_INNI_MUX_FOUR_TO_ONE);
-                    } else if (MODEL_ID == "rlt-3200g-w" || MODEL_ID == "rlt-1600g-w") {
-                        BCMOLT_MSG_FIELD_SET(&oper, inni_config.mux, BCMOLT_INNI_MUX_NONE);
-                        if(dev == 1) {
-                            BCMOLT_MSG_FIELD_SET(&oper, inni_config.mux, BCMOLT_INNI_MUX_FOUR_TO_ONE);
-                        }
-                        BCMOLT_MSG_FIELD_SET (&oper, ras_ddr_mode, BCMOLT_RAS_DDR_USAGE_MODE_TWO_DDRS);
-                        BCMOLT_MSG_FIELD_SET(&oper, inni_config.mode, BCMOLT_INNI_MODE_ALL_10_G_XFI);
-                    } else if (MODEL_ID == "rlt-1600x-w") {
-                        BCMOLT_MSG_FIELD_SET(&oper, inni_config.mux, BCMOLT_INNI_MUX_NONE);
-                        BCMOLT_MSG_FIELD_SET (&oper, ras_ddr_mode, BCMOLT_RAS_DDR_USAGE_MODE_TWO_DDRS);
-                        BCMOLT_MSG_FIELD_SET(&oper, inni_config.mode, BCMOLT_INNI_MODE_ALL_10_G_XFI);
-                    } else if (MODEL_ID == "sda3016ss") {
-                        BCMOLT_MSG_FIELD_SET(&oper, inni_config.mode, BCMOLT_INNI_MODE_ALL_12_P_5_G);
-                        BCMOLT_MSG_FIELD_SET(&oper, inni_config.mux, BCMOLT_INNI_MUX_TWO_TO_ONE);
-						BCMOLT_MSG_FIELD_SET (&oper, ras_ddr_mode, BCMOLT_RAS_DDR_USAGE_MODE_TWO_DDRS);
-                    }
-                    err = bcmolt_oper_submit(dev_id, &oper.hdr);
-                    if (err) {
-                        failed_enable_device_cnt ++;
-                        OPENOLT_LOG(ERROR, openolt_log_id, "Enable PON device %d failed, err = %s\n", dev, bcmos_strerror(err));
-                        if (failed_enable_device_cnt == BCM_MAX_DEVS_PER_LINE_CARD) {
-                            OPENOLT_LOG(ERROR, openolt_log_id, "Failed to enable all the pon ports, err = %s\n", bcmos_strerror(err));
-                            return Status(grpc::StatusCode::INTERNAL, "Failed to activate all PON ports");
-                        }
-                    }
-                    bcmos_usleep(MAC_DEVICE_ACTIVATION_DELAY);
-                }
-                else {
+            bool connect_submitted = false;
+            for (bcmolt_odid dev = 0; dev < BCM_MAX_DEVS_PER_LINE_CARD; dev++) {
+                if (dev_err[dev] == BCM_ERR_OK) {
+                    connect_submitted = true;
+                } else if (dev_err[dev] == BCM_ERR_ALREADY) {
                     OPENOLT_LOG(WARNING, openolt_log_id, "PON device %d already connected\n", dev);
+                    mac_device_connect_already(dev);
                     state.activate();
+                } else if (dev_err[dev] != BCM_ERR_OK && dev_err[dev] != BCM_ERR_NOENT) {
+                    failed_enable_device_cnt ++;
+                    OPENOLT_LOG(ERROR, openolt_log_id, "Enable PON device %d failed, err = %s\n", dev, bcmos_strerror(dev_err[dev]));
+                    if (failed_enable_device_cnt == BCM_MAX_DEVS_PER_LINE_CARD) {
+                        OPENOLT_LOG(ERROR, openolt_log_id, "Failed to enable all the pon ports, err = %s\n", bcmos_strerror(dev_err[dev]));
+                        return Status(grpc::StatusCode::INTERNAL, "Failed to activate all PON ports");
+                    }
                 }
             }
+            if (connect_submitted) {
+                mac_device_connect_arm();
+            }
+            // The devices kept their configuration only if none of them had to be connected
+            bool restore = warm_restart && !connect_submitted && state.is_activated();
+            if (warm_restart && !restore) {
+                OPENOLT_LOG(WARNING, openolt_log_id, "PON devices were not all connected, no state to rebuild\n");
+            }
+            // The journal restores the maps BAL knows nothing about, BAL is then
+            // scanned for what the journal missed. The scan completes before the
+            // gRPC server accepts a reconcile FlowAdd that could be handed an ID
+            // BAL still holds.
+            if (!state_journal_open(STATE_SNAPSHOT_FILE, STATE_JOURNAL_FILE, restore)) {
+                OPENOLT_LOG(ERROR, openolt_log_id, "State journal not restored, relying on BAL and VOLTHA reconcile\n");
+            }
+            if (restore) {
+                rebuild_state_from_bal();
+            }
             init_stats();
         }
     }
@@ -493,7 +557,7 @@ Status Disable_() {
         olt_ind->set_oper_state("down");
         ind.set_allocated_olt_ind(olt_ind);
         BCM_LOG(INFO, openolt_log_id, "Disable OLT, add an extra indication\n");
-        oltIndQ.push(ind);
+        oltIndQ.push(std::move(ind));
         return Status::OK;
     }
     if (failedCount ==NumPonIf_()) {
@@ -520,7 +584,7 @@ Status Reenable_() {
         olt_ind->set_oper_state("up");
         ind.set_allocated_olt_ind(olt_ind);
         BCM_LOG(INFO, openolt_log_id, "Reenable OLT, add an extra indication\n");
-        oltIndQ.push(ind);
+        oltIndQ.push(std::move(ind));
         return Status::OK;
     }
     if (failedCount ==NumPonIf_()) {
@@ -961,6 +1025,8 @@ Status EnablePonIf_(uint32_t intf_id) {
         OPENOLT_LOG(ERROR, openolt_log_id, "Failed to enable discovery onu, PON interface %d, err = %s\n", intf_id, bcmos_strerror(err));
         return bcm_to_grpc_err(err, "Failed to enable discovery onu");
     }
+    invalidate_pon_onu_state_cache(intf_id);
+    onu_discovery_forget_pon(intf_id);
     err = bcmolt_oper_submit(dev_id, &pon_interface_set_state.hdr);
     if (err != BCM_ERR_OK) {
         OPENOLT_LOG(ERROR, openolt_log_id, "Failed to enable PON interface: %d, err = %s\n", intf_id, bcmos_strerror(err));
@@ -976,6 +1042,104 @@ Status EnablePonIf_(uint32_t intf_id) {
     return Status::OK;
 }
 
+/* The device capabilities rarely change between restarts of the same box, so
+   they are kept in DEVICE_CAPABILITY_CACHE_FILE. The cache is only used if it
+   was written by the same cache version for the same fingerprint: the model,
+   the topology, the firmware version reported by the first MAC device and the
+   system mode of every MAC device, which gives the interface technologies. */
+static std::string device_capability_fingerprint(int devid, const std::string& bal_version) {
+    std::string fingerprint = std::string(MODEL_ID) + " nni " + std::to_string(num_of_nni_ports)
+        + " pon " + std::to_string(num_of_pon_ports)
+        + " devs " + std::to_string(BCM_MAX_DEVS_PER_LINE_CARD)
+        + " dev " + std::to_string(devid) + " BAL." + bal_version;
+
+    fingerprint += " modes";
+    for (int dev = 0; dev < BCM_MAX_DEVS_PER_LINE_CARD; dev++) {
+        #ifdef DYNAMIC_PON_TRX_SUPPORT
+        // the mode depends on the transceivers plugged in, see ConnectMacDevice
+        auto sm_res = ponTrx.get_mac_system_mode(dev, ponTrx.get_sfp_presence_data());
+        if (!sm_res.second) {
+            // never matches a cache, the capabilities are read from BAL
+            return "";
+        }
+        fingerprint += " " + std::to_string(sm_res.first);
+        #else
+        fingerprint += " " + std::to_string(DEFAULT_MAC_SYSTEM_MODE);
+        #endif
+    }
+    return fingerprint;
+}
+
+static bool load_device_capability_cache(const std::string& fingerprint) {
+    std::ifstream in_file(DEVICE_CAPABILITY_CACHE_FILE);
+    std::string key, value;
+    std::string technologies[MAX_SUPPORTED_PON];
+    std::string cached_board_technology, cached_chip_family, cached_firmware_version;
+    int version = 0;
+
+    if (!in_file.is_open()) {
+        return false;
+    }
+    if (!(in_file >> key >> version) || key != "version" || version != DEVICE_CAPABILITY_CACHE_VERSION) {
+        return false;
+    }
+    if (!(in_file >> key) || key != "fingerprint" || !std::getline(in_file >> std::ws, value) || value != fingerprint) {
+        OPENOLT_LOG(INFO, openolt_log_id, "device capability cache is stale\n");
+        return false;
+    }
+    while (in_file >> key) {
+        if (key == "intf_technology") {
+            int intf_id;
+            if (!(in_file >> intf_id >> value) || intf_id < 0 || intf_id >= MAX_SUPPORTED_PON) {
+                return false;
+            }
+            technologies[intf_id] = value;
+        } else if (std::getline(in_file >> std::ws, value)) {
+            if (key == "board_technology") {
+                cached_board_technology = value;
+            } else if (key == "chip_family") {
+                cached_chip_family = value;
+            } else if (key == "firmware_version") {
+                cached_firmware_version = value;
+            }
+        }
+    }
+    if (cached_board_technology.empty() || cached_chip_family.empty() || cached_firmware_version.empty()) {
+        return false;
+    }
+
+    board_technology = cached_board_technology;
+    chip_family = cached_chip_family;
+    firmware_version = cached_firmware_version;
+    for (int i = 0; i < MAX_SUPPORTED_PON; i++) {
+        if (!technologies[i].empty()) {
+            intf_technologies[i] = technologies[i];
+        }
+    }
+    return true;
+}
+
+static void save_device_capability_cache(const std::string& fingerprint) {
+    std::ostringstream content;
+    std::string tmp_file = std::string(DEVICE_CAPABILITY_CACHE_FILE) + ".tmp";
+
+    content << "version " << DEVICE_CAPABILITY_CACHE_VERSION << "\n";
+    content << "fingerprint " << fingerprint << "\n";
+    content << "board_technology " << board_technology << "\n";
+    content << "chip_family " << chip_family << "\n";
+    content << "firmware_version " << firmware_version << "\n";
+    for (int i = 0; i < MAX_SUPPORTED_PON; i++) {
+        if (!intf_technologies[i].empty() && intf_technologies[i] != UNKNOWN_TECH) {
+            content << "intf_technology " << i << " " << intf_technologies[i] << "\n";
+        }
+    }
+
+    // write then rename, so a restart never sees a partially written cache
+    if (!save_to_txt_file(tmp_file, content.str()) || rename(tmp_file.c_str(), DEVICE_CAPABILITY_CACHE_FILE)) {
+        OPENOLT_LOG(WARNING, openolt_log_id, "Failed to save device capability cache %s\n", DEVICE_CAPABILITY_CACHE_FILE);
+    }
+}
+
 Status ProbeDeviceCapabilities_() {
     bcmos_errno err;
     bcmolt_device_cfg dev_cfg = { };
@@ -1021,6 +1185,8 @@ Status ProbeDeviceCapabilities_() {
 
     uint32_t num_failed_cfg_gets = 0;
     static std::string openolt_version = firmware_version;
+    std::string fingerprint;
+    bool cache_checked = false;
     for (int devid = 0; devid < BCM_MAX_DEVS_PER_LINE_CARD; devid++) {
         dev_key.device_id = devid;
         BCMOLT_CFG_INIT(&dev_cfg, device, dev_key);
@@ -1040,6 +1206,16 @@ Status ProbeDeviceCapabilities_() {
                     + "." + std::to_string(dev_cfg.data.firmware_sw_version.revision);
         firmware_version = "BAL." + bal_version + "__" + openolt_version;
 
+        if (!cache_checked) {
+            cache_checked = true;
+            fingerprint = device_capability_fingerprint(devid, bal_version);
+            if (!fingerprint.empty() && load_device_capability_cache(fingerprint)) {
+                OPENOLT_LOG(INFO, openolt_log_id, "device capabilities loaded from %s, board_technology: %s\n",
+                    DEVICE_CAPABILITY_CACHE_FILE, board_technology.c_str());
+                return Status::OK;
+            }
+        }
+
         switch(dev_cfg.data.system_mode) {
             case 10: board_technology = "GPON"; FILL_ARRAY(intf_technologies,devid*4,(devid+1)*4,"GPON"); break;
             case 11: board_technology = "GPON"; FILL_ARRAY(intf_technologies,devid*8,(devid+1)*8,"GPON"); break;
@@ -1076,6 +1252,11 @@ Status ProbeDeviceCapabilities_() {
         return bcm_to_grpc_err(err, "device: All devices failed query");
     }
 
+    // only a complete probe is worth reusing
+    if (num_failed_cfg_gets == 0 && !fingerprint.empty()) {
+        save_device_capability_cache(fingerprint);
+    }
+
     return Status::OK;
 }
 
@@ -1156,10 +1337,18 @@ Status DisableOnuSerialNumber_(const ::openolt::InterfaceOnuSerialNumber* reques
      // 2. Set fields in BAL serial number object
     BCMOLT_FIELD_SET(&itu_serial_number, serial_number, vendor_id, itu_serial_number_vendor_id);
     BCMOLT_FIELD_SET(&itu_serial_number, serial_number, vendor_specific, itu_serial_number_vendor_specific);
+    std::string serial_number_str = serial_number_to_str(&itu_serial_number);
  
     OPENOLT_LOG(INFO, openolt_log_id, "Received disable request for ONU serial number %s with vendor_id: %s, vendor_specific: %s\n",
-        serial_number_to_str(&itu_serial_number).c_str(),
+        serial_number_str.c_str(),
                 ((request->onu_serial_number()).vendor_id()).c_str(), ((request->onu_serial_number()).vendor_specific()).c_str());
+    uint32_t sn_intf_id, sn_onu_id;
+    if (onu_sn_index_lookup(get_onu_sn_key(reinterpret_cast<const char *>(itu_serial_number_vendor_id.arr),
+            reinterpret_cast<const char *>(itu_serial_number_vendor_specific.arr)), &sn_intf_id, &sn_onu_id) &&
+        sn_intf_id != intf_id) {
+        OPENOLT_LOG(WARNING, openolt_log_id, "ONU serial number %s is known on PON %d (onu_id %d), not on PON %d\n",
+            serial_number_str.c_str(), sn_intf_id, sn_onu_id, intf_id);
+    }
 
     // 3. Prepare disable_serial_number operation on PON interface
     bcmolt_pon_interface_key intf_key = {.pon_ni = (bcmolt_interface)intf_id};
@@ -1176,11 +1365,11 @@ Status DisableOnuSerialNumber_(const ::openolt::InterfaceOnuSerialNumber* reques
     err = bcmolt_oper_submit(dev_id, &pon_interface_disable_sn.hdr);
     if(err != BCM_ERR_OK)
     {
-        OPENOLT_LOG(ERROR, openolt_log_id, "Failed to disable onu serial number %s on port: %d, bcm_err: %s, err_text: %s\n",serial_number_to_str(&itu_serial_number).c_str(), intf_id,
+        OPENOLT_LOG(ERROR, openolt_log_id, "Failed to disable onu serial number %s on port: %d, bcm_err: %s, err_text: %s\n",serial_number_str.c_str(), intf_id,
             bcmos_strerror(err), pon_interface_disable_sn.hdr.hdr.err_text);
         return bcm_to_grpc_err(err, "Failed to disable onu serialnumber");
     }
-    OPENOLT_LOG(INFO, openolt_log_id, "Successfully disabled Onu Serial number: %s , interface id %d\n",serial_number_to_str(&itu_serial_number).c_str(),intf_id);
+    OPENOLT_LOG(INFO, openolt_log_id, "Successfully disabled Onu Serial number: %s , interface id %d\n",serial_number_str.c_str(),intf_id);
     return Status::OK;
 }
 
@@ -1201,10 +1390,18 @@ Status EnableOnuSerialNumber_(const ::openolt::InterfaceOnuSerialNumber* request
      // 2. Set fields in BAL serial number object
     BCMOLT_FIELD_SET(&itu_serial_number, serial_number, vendor_id, itu_serial_number_vendor_id);
     BCMOLT_FIELD_SET(&itu_serial_number, serial_number, vendor_specific, itu_serial_number_vendor_specific);
+    std::string serial_number_str = serial_number_to_str(&itu_serial_number);
  
     OPENOLT_LOG(INFO, openolt_log_id, "Received enable request for ONU serial number %s with vendor_id: %s, vendor_specific: %s\n",
-        serial_number_to_str(&itu_serial_number).c_str(),
+        serial_number_str.c_str(),
                 ((request->onu_serial_number()).vendor_id()).c_str(), ((request->onu_serial_number()).vendor_specific()).c_str());
+    uint32_t sn_intf_id, sn_onu_id;
+    if (onu_sn_index_lookup(get_onu_sn_key(reinterpret_cast<const char *>(itu_serial_number_vendor_id.arr),
+            reinterpret_cast<const char *>(itu_serial_number_vendor_specific.arr)), &sn_intf_id, &sn_onu_id) &&
+        sn_intf_id != intf_id) {
+        OPENOLT_LOG(WARNING, openolt_log_id, "ONU serial number %s is known on PON %d (onu_id %d), not on PON %d\n",
+            serial_number_str.c_str(), sn_intf_id, sn_onu_id, intf_id);
+    }
     // 3. Prepare disable_serial_number operation on PON interface
     bcmolt_pon_interface_key intf_key = {.pon_ni = (bcmolt_interface)intf_id};
     bcmolt_pon_interface_disable_serial_number pon_interface_disable_sn;
@@ -1220,11 +1417,11 @@ Status EnableOnuSerialNumber_(const ::openolt::InterfaceOnuSerialNumber* request
     err = bcmolt_oper_submit(dev_id, &pon_interface_disable_sn.hdr);
     if(err != BCM_ERR_OK)
     {
-        OPENOLT_LOG(ERROR, openolt_log_id, "Failed to enable onu serial number %s on port: %d, bcm_err: %s, err_text: %s\n",serial_number_to_str(&itu_serial_number).c_str(), intf_id,
+        OPENOLT_LOG(ERROR, openolt_log_id, "Failed to enable onu serial number %s on port: %d, bcm_err: %s, err_text: %s\n",serial_number_str.c_str(), intf_id,
             bcmos_strerror(err), pon_interface_disable_sn.hdr.hdr.err_text);
         return bcm_to_grpc_err(err, "Failed to enable onu serialnumber");
     }
-    OPENOLT_LOG(INFO, openolt_log_id, "Successfully enabled Onu Serial number: %s , interface id %d\n",serial_number_to_str(&itu_serial_number).c_str(),intf_id);
+    OPENOLT_LOG(INFO, openolt_log_id, "Successfully enabled Onu Serial number: %s , interface id %d\n",serial_number_str.c_str(),intf_id);
     return Status::OK;
 }
 
@@ -1246,6 +1443,7 @@ Status DisableOnu_(const ::openolt::InterfaceOnuSerialNumberOnuId* request) {
     // 2. Set fields in BAL serial number object
     BCMOLT_FIELD_SET(&itu_serial_number, serial_number, vendor_id, itu_serial_number_vendor_id);
     BCMOLT_FIELD_SET(&itu_serial_number, serial_number, vendor_specific, itu_serial_number_vendor_specific);
+    std::string serial_number_str = serial_number_to_str(&itu_serial_number);
 
     bcmolt_onu_set_onu_state    onu_oper;
     bcmolt_onu_key              onu_key;
@@ -1256,14 +1454,15 @@ Status DisableOnu_(const ::openolt::InterfaceOnuSerialNumberOnuId* request) {
                 onu_state, BCMOLT_ONU_OPERATION_DISABLE);
  
     err = bcmolt_oper_submit(dev_id, &onu_oper.hdr);
+    invalidate_onu_state_cache(intf_id, onu_id);
     if (err != BCM_ERR_OK)
     {
         OPENOLT_LOG(ERROR, openolt_log_id,"Failed to set onu state to disabled.onu serial number=%s, intf_id=%d, onu_id=%d, bcm_err=%s\n",
-                serial_number_to_str(&itu_serial_number).c_str(),
+                serial_number_str.c_str(),
                 intf_id, onu_id,  bcmos_strerror(err));
         return bcm_to_grpc_err(err, "Failed to disable onu");
     }
-    OPENOLT_LOG(ERROR, openolt_log_id, "Successfully disabled Onu device with serial number %s ,id: %d , interface id %d\n",serial_number_to_str(&itu_serial_number).c_str(),onu_id,intf_id);
+    OPENOLT_LOG(ERROR, openolt_log_id, "Successfully disabled Onu device with serial number %s ,id: %d , interface id %d\n",serial_number_str.c_str(),onu_id,intf_id);
     return Status::OK;
 }
 
@@ -1285,6 +1484,7 @@ Status EnableOnu_(const ::openolt::InterfaceOnuSerialNumberOnuId* request) {
     // 2. Set fields in BAL serial number object
     BCMOLT_FIELD_SET(&itu_serial_number, serial_number, vendor_id, itu_serial_number_vendor_id);
     BCMOLT_FIELD_SET(&itu_serial_number, serial_number, vendor_specific, itu_serial_number_vendor_specific);
+    std::string serial_number_str = serial_number_to_str(&itu_serial_number);
 
     bcmolt_onu_set_onu_state    onu_oper;
     bcmolt_onu_key              onu_key;
@@ -1296,14 +1496,15 @@ Status EnableOnu_(const ::openolt::InterfaceOnuSerialNumberOnuId* request) {
                 onu_state, BCMOLT_ONU_OPERATION_ENABLE);
  
     err = bcmolt_oper_submit(dev_id, &onu_oper.hdr);
+    invalidate_onu_state_cache(intf_id, onu_id);
     if (err != BCM_ERR_OK)
     {
         OPENOLT_LOG(ERROR, openolt_log_id,"Failed to set onu state to enabled. Serial number=%s, intf_id=%d, onu_id=%d, bcm_err=%s\n",
-                serial_number_to_str(&itu_serial_number).c_str(),               
+                serial_number_str.c_str(),               
                 intf_id, onu_id,  bcmos_strerror(err));
         return bcm_to_grpc_err(err, "Failed to enable onu");
     }
-    OPENOLT_LOG(ERROR, openolt_log_id, "Successfully enabled Onu device with serial number %s, id: %d , interface id %d\n",serial_number_to_str(&itu_serial_number).c_str(),onu_id,intf_id);
+    OPENOLT_LOG(ERROR, openolt_log_id, "Successfully enabled Onu device with serial number %s, id: %d , interface id %d\n",serial_number_str.c_str(),onu_id,intf_id);
     return Status::OK;
 }
 
@@ -1339,6 +1540,8 @@ Status DisablePonIf_(uint32_t intf_id) {
     BCMOLT_FIELD_SET(&pon_interface_set_state.data, pon_interface_set_pon_interface_state_data,
     operation, BCMOLT_INTERFACE_OPERATION_INACTIVE);
 
+    invalidate_pon_onu_state_cache(intf_id);
+    onu_discovery_forget_pon(intf_id);
     err = bcmolt_oper_submit(dev_id, &pon_interface_set_state.hdr);
     if (err != BCM_ERR_OK) {
         OPENOLT_LOG(ERROR, openolt_log_id, "Failed to disable PON interface: %d\n , err %d\n", intf_id, err);
@@ -1380,6 +1583,7 @@ Status ActivateOnu_(uint32_t intf_id, uint32_t onu_id,
         if (onu_cfg.data.onu_state == BCMOLT_ONU_STATE_ACTIVE) {
             OPENOLT_LOG(INFO, openolt_log_id, "ONU is already in ACTIVE state, \
 not processing this request for pon_intf=%d onu_id=%d\n", intf_id, onu_id);
+            onu_sn_index_activated(intf_id, onu_id, get_onu_sn_key(vendor_id, vendor_specific));
             return Status::OK;
         } else if (onu_cfg.data.onu_state != BCMOLT_ONU_STATE_NOT_CONFIGURED &&
                 onu_cfg.data.onu_state != BCMOLT_ONU_STATE_INACTIVE) {
@@ -1448,6 +1652,7 @@ vendor specific %s, pir %d\n", onu_id, intf_id, vendor_id,
     BCMOLT_FIELD_SET(&onu_oper.data, onu_set_onu_state_data,
             onu_state, BCMOLT_ONU_OPERATION_ACTIVE);
     err = bcmolt_oper_submit(dev_id, &onu_oper.hdr);
+    invalidate_onu_state_cache(intf_id, onu_id);
     if (err != BCM_ERR_OK) {
         OPENOLT_LOG(ERROR, openolt_log_id, "Failed to activate ONU %d on PON %d, err = %s\n", onu_id, intf_id, bcmos_strerror(err));
         return bcm_to_grpc_err(err, "Failed to activate ONU");
@@ -1455,6 +1660,11 @@ vendor specific %s, pir %d\n", onu_id, intf_id, vendor_id,
     // ONU will eventually get activated after we have submitted the operation request. The adapter will receive an asynchronous
     // ONU_ACTIVATION_COMPLETED_INDICATION
 
+    if (!onu_sn_index_activated(intf_id, onu_id, get_onu_sn_key(vendor_id, vendor_specific))) {
+        OPENOLT_LOG(WARNING, openolt_log_id, "Serial number %s%s of onu_id %d on PON %d was already activated as another ONU\n",
+            std::string(vendor_id, 4).c_str(), vendor_specific_to_str(vendor_specific).c_str(), onu_id, intf_id);
+    }
+
     OPENOLT_LOG(INFO, openolt_log_id, "Activated ONU, onu_id %d on PON %d\n", onu_id, intf_id);
 
     return Status::OK;
@@ -1464,16 +1674,12 @@ Status DeactivateOnu_(uint32_t intf_id, uint32_t onu_id,
     const char *vendor_id, const char *vendor_specific) {
     bcmos_errno err = BCM_ERR_OK;
     bcmolt_onu_set_onu_state onu_oper; /* declare main API struct */
-    bcmolt_onu_cfg onu_cfg;
     bcmolt_onu_key onu_key; /**< Object key. */
     bcmolt_onu_state onu_state;
 
     onu_key.onu_id = onu_id;
     onu_key.pon_ni = intf_id;
-    BCMOLT_CFG_INIT(&onu_cfg, onu, onu_key);
-    BCMOLT_FIELD_SET_PRESENT(&onu_cfg.data, onu_cfg_data, onu_state);
-    err = bcmolt_cfg_get(dev_id, &onu_cfg.hdr);
-    onu_state = onu_cfg.data.onu_state;
+    err = get_onu_state((bcmolt_interface)intf_id, onu_id, &onu_state);
     if (err == BCM_ERR_OK) {
         switch (onu_state) {
             case BCMOLT_ONU_STATE_ACTIVE:
@@ -1481,6 +1687,7 @@ Status DeactivateOnu_(uint32_t intf_id, uint32_t onu_id,
                 BCMOLT_FIELD_SET(&onu_oper.data, onu_set_onu_state_data,
                     onu_state, BCMOLT_ONU_OPERATION_INACTIVE);
                 err = bcmolt_oper_submit(dev_id, &onu_oper.hdr);
+                invalidate_onu_state_cache(intf_id, onu_id);
                 if (err != BCM_ERR_OK) {
                     OPENOLT_LOG(ERROR, openolt_log_id, "Failed to deactivate ONU %d on PON %d, err = %s\n", onu_id, intf_id, bcmos_strerror(err));
                     return bcm_to_grpc_err(err, "Failed to deactivate ONU");
@@ -1545,22 +1752,37 @@ Status DeleteOnu_(uint32_t intf_id, uint32_t onu_id,
     BCMOLT_CFG_INIT(&cfg_obj, onu, key);
 
     err = bcmolt_cfg_clear(dev_id, &cfg_obj.hdr);
+    invalidate_onu_state_cache(intf_id, onu_id);
     if (err != BCM_ERR_OK)
     {
         OPENOLT_LOG(ERROR, openolt_log_id, "Failed to clear information for BAL onu_id %d, Interface ID %d, err = %s (%d)\n", onu_id, intf_id, cfg_obj.hdr.hdr.err_text, err);
         return Status(grpc::StatusCode::INTERNAL, "Failed to delete ONU");
     }
+    onu_sn_index_remove(intf_id, onu_id);
+    invalidate_onu_stats_cache(intf_id, onu_id);
+    clear_onu_stats_history(intf_id, onu_id);
+    clear_onu_thresholds(intf_id, onu_id);
+    invalidate_onu_rx_power_cache(intf_id, onu_id);
+    // VOLTHA expects the ONU to be discovered again
+    onu_discovery_forget(intf_id, get_onu_sn_key(vendor_id, vendor_specific));
 
     OPENOLT_LOG(INFO, openolt_log_id, "Deleted ONU, onu_id %d on PON %d\n", onu_id, intf_id);
     return Status::OK;
 }
 
-#define MAX_CHAR_LENGTH  20
-#define MAX_OMCI_MSG_LENGTH 44
-Status OmciMsgOut_(uint32_t intf_id, uint32_t onu_id, const std::string pkt) {
+/* Convert a single hex digit to its value, non hex characters decode as 0 */
+static inline uint8_t hex_nibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return 0;
+}
+
+Status OmciMsgOut_(uint32_t intf_id, uint32_t onu_id, const std::string& pkt) {
     bcmolt_bin_str buf = {};
     bcmolt_onu_cpu_packets omci_cpu_packets;
     bcmolt_onu_key key;
+    uint8_t arraySend[MAX_OMCI_MSG_LENGTH];
 
     key.pon_ni = intf_id;
     key.onu_id = onu_id;
@@ -1569,30 +1791,19 @@ Status OmciMsgOut_(uint32_t intf_id, uint32_t onu_id, const std::string pkt) {
     BCMOLT_MSG_FIELD_SET(&omci_cpu_packets, packet_type, BCMOLT_PACKET_TYPE_OMCI);
     BCMOLT_MSG_FIELD_SET(&omci_cpu_packets, calc_crc, BCMOS_TRUE);
 
-    // ???
+    // OMCI baseline messages are 44 bytes without CRC, anything longer is truncated
     if ((pkt.size()/2) > MAX_OMCI_MSG_LENGTH) {
         buf.len = MAX_OMCI_MSG_LENGTH;
     } else {
         buf.len = pkt.size()/2;
     }
 
-    /* Send the OMCI packet using the BAL remote proxy API */
-    uint16_t idx1 = 0;
-    uint16_t idx2 = 0;
-    uint8_t arraySend[buf.len];
-    char str1[MAX_CHAR_LENGTH];
-    char str2[MAX_CHAR_LENGTH];
-    memset(&arraySend, 0, buf.len);
-
-    for (idx1=0,idx2=0; idx1<((buf.len)*2); idx1++,idx2++) {
-       sprintf(str1,"%c", pkt[idx1]);
-       sprintf(str2,"%c", pkt[++idx1]);
-       strcat(str1,str2);
-       arraySend[idx2] = strtol(str1, NULL, 16);
+    /* Decode the hex string straight into the send buffer. This is on the path of
+       every OMCI message, so avoid the per byte formatting and heap allocation. */
+    for (uint16_t idx = 0; idx < buf.len; idx++) {
+        arraySend[idx] = (hex_nibble(pkt[2*idx]) << 4) | hex_nibble(pkt[2*idx + 1]);
     }
-
-    buf.arr = (uint8_t *)malloc((buf.len)*sizeof(uint8_t));
-    memcpy(buf.arr, (uint8_t *)arraySend, buf.len);
+    buf.arr = arraySend;
 
     BCMOLT_MSG_FIELD_SET(&omci_cpu_packets, number_of_packets, 1);
     BCMOLT_MSG_FIELD_SET(&omci_cpu_packets, packet_size, buf.len);
@@ -1606,12 +1817,11 @@ Status OmciMsgOut_(uint32_t intf_id, uint32_t onu_id, const std::string pkt) {
         OPENOLT_LOG(DEBUG, omci_log_id, "OMCI request msg of length %d sent to ONU %d on PON %d : %s\n",
             buf.len, onu_id, intf_id, pkt.c_str());
     }
-    free(buf.arr);
 
     return Status::OK;
 }
 
-Status OnuPacketOut_(uint32_t intf_id, uint32_t onu_id, uint32_t port_no, uint32_t gemport_id, const std::string pkt) {
+Status OnuPacketOut_(uint32_t intf_id, uint32_t onu_id, uint32_t port_no, uint32_t gemport_id, const std::string& pkt) {
     bcmolt_pon_interface_cpu_packets pon_interface_cpu_packets; /**< declare main API struct */
     bcmolt_pon_interface_key key = {.pon_ni = (bcmolt_interface)intf_id}; /**< declare key */
     bcmolt_bin_str buf = {};
@@ -1647,9 +1857,10 @@ Status OnuPacketOut_(uint32_t intf_id, uint32_t onu_id, uint32_t port_no, uint32
         gem_port_id_array[0] = gemport_id;
         gem_port_list.len = 1;
         gem_port_list.arr = gem_port_id_array;
+        // bcmolt_oper_submit serializes the buffer before returning, so the
+        // packet can be handed over without an intermediate copy.
         buf.len = pkt.size();
-        buf.arr = (uint8_t *)malloc((buf.len)*sizeof(uint8_t));
-        memcpy(buf.arr, (uint8_t *)pkt.data(), buf.len);
+        buf.arr = (uint8_t *)pkt.data();
 
         /* init the API struct */
         BCMOLT_OPER_INIT(&pon_interface_cpu_packets, pon_interface, cpu_packets, key);
@@ -1669,7 +1880,6 @@ Status OnuPacketOut_(uint32_t intf_id, uint32_t onu_id, uint32_t port_no, uint32
         OPENOLT_LOG(INFO, openolt_log_id, "port_no %d onu %d on pon %d\n",
             port_no, onu_id, intf_id);
     }
-    free(buf.arr);
 
     return Status::OK;
 }
@@ -1964,6 +2174,7 @@ Status FlowAddWrapper_(const ::openolt::Flow* request) {
         symmetric_datapath_flow_id_map_key key(access_intf_id, onu_id, uni_id, tech_profile_id, flow_type);
         bcmos_fastlock_lock(&symmetric_datapath_flow_id_lock);
         symmetric_datapath_flow_id_map[key] = voltha_flow_id;
+        state_journal_symmetric_flow_set(key, voltha_flow_id);
         bcmos_fastlock_unlock(&symmetric_datapath_flow_id_lock, 0);
     }
 
@@ -2396,7 +2607,9 @@ Status FlowRemoveWrapper_(const ::openolt::Flow* request) {
     symmetric_datapath_flow_id_map_key key(access_intf_id, onu_id, uni_id, tech_profile_id, flow_type);
     // Remove onu-uni mapping for the pon-gem key
     bcmos_fastlock_lock(&symmetric_datapath_flow_id_lock);
-    symmetric_datapath_flow_id_map.erase(key);
+    if (symmetric_datapath_flow_id_map.erase(key)) {
+        state_journal_symmetric_flow_erase(key);
+    }
     bcmos_fastlock_unlock(&symmetric_datapath_flow_id_lock, 0);
 
     return Status::OK;
@@ -2490,6 +2703,7 @@ Status FlowRemove_(uint32_t flow_id, const std::string flow_type) {
         OPENOLT_LOG(ERROR, openolt_log_id, "Error while removing %s flow, flow_id=%d, err = %s (%d)\n", flow_type.c_str(), flow_id, cfg.hdr.hdr.err_text, err);
         return Status(grpc::StatusCode::INTERNAL, "Failed to remove flow");
     }
+    invalidate_flow_stats_cache(flow_id, key.flow_type);
 
     bcmos_fastlock_lock(&data_lock);
     if (flow_id_counters != 0) {
@@ -3069,6 +3283,7 @@ sched_id %d, tm_q_set_id %d, intf_id %d, onu_id %d, uni_id %d, tech_profile_id %
             onu_uni ou(onu_id, uni_id);
             bcmos_fastlock_lock(&pon_gem_to_onu_uni_map_lock);
             pon_gem_to_onu_uni_map[pg] = ou;
+            state_journal_gem_set(pg, ou);
             bcmos_fastlock_unlock(&pon_gem_to_onu_uni_map_lock, 0);
         }
     }
@@ -3163,8 +3378,11 @@ bcmos_errno RemoveQueue(std::string direction, uint32_t access_intf_id, uint32_t
             // Remove the pon-gem to onu-uni mapping
             pon_gem pg(access_intf_id, gemport_id);
             bcmos_fastlock_lock(&pon_gem_to_onu_uni_map_lock);
-            pon_gem_to_onu_uni_map.erase(pg);
+            if (pon_gem_to_onu_uni_map.erase(pg)) {
+                state_journal_gem_erase(pg);
+            }
             bcmos_fastlock_unlock(&pon_gem_to_onu_uni_map_lock, 0);
+            invalidate_gem_stats_cache(access_intf_id, gemport_id);
         }
     }
 
@@ -3599,6 +3817,12 @@ Status GetLogicalOnuDistance_(uint32_t intf_id, uint32_t onu_id, ::openolt::OnuL
 Status GetOnuStatistics_(uint32_t intf_id, uint32_t onu_id, openolt::OnuStatistics* onu_stats) {
     bcmos_errno err;
 
+    // The counters of the last ONU statistics sweep are recent enough
+    if (get_cached_onu_statistics(intf_id, onu_id, onu_stats)) {
+        OPENOLT_LOG(DEBUG, openolt_log_id, "retrieved cached ONU statistics for PON ID = %d, ONU ID = %d\n", (int)intf_id, (int)onu_id);
+        return Status::OK;
+    }
+
     err = get_onu_statistics((bcmolt_interface_id)intf_id, (bcmolt_onu_id)onu_id, onu_stats);
 
     if (err != BCM_ERR_OK) {
@@ -3613,6 +3837,12 @@ Status GetOnuStatistics_(uint32_t intf_id, uint32_t onu_id, openolt::OnuStatisti
 Status GetGemPortStatistics_(uint32_t intf_id, uint32_t gemport_id, openolt::GemPortStatistics* gemport_stats) {
     bcmos_errno err;
 
+    // The counters of the last GEM port statistics sweep are recent enough
+    if (get_cached_gemport_statistics(intf_id, gemport_id, gemport_stats)) {
+        OPENOLT_LOG(DEBUG, openolt_log_id, "retrieved cached GEMPORT statistics for PON ID = %d, GEMPORT ID = %d\n", (int)intf_id, (int)gemport_id);
+        return Status::OK;
+    }
+
     err = get_gemport_statistics((bcmolt_interface_id)intf_id, (bcmolt_gem_port_id)gemport_id, gemport_stats);
 
     if (err != BCM_ERR_OK) {
@@ -3683,59 +3913,29 @@ Status GetPonRxPower_(uint32_t intf_id, uint32_t onu_id, openolt::PonRxPowerData
         return bcm_to_grpc_err(err, "invalid pon intf_id");
     }
 
-    bcmolt_onu_rssi_measurement onu_oper; /* declare main API struct */
-    bcmolt_onu_key onu_key; /**< Object key. */
-    onu_rssi_compltd_key key(intf_id, onu_id);
-    Queue<onu_rssi_complete_result> queue;
-
     OPENOLT_LOG(INFO, openolt_log_id, "GetPonRxPower - intf_id %d, onu_id %d\n", intf_id, onu_id);
 
-    onu_key.onu_id = onu_id;
-    onu_key.pon_ni = intf_id;
-    /* Initialize the API struct. */
-    BCMOLT_OPER_INIT(&onu_oper, onu, rssi_measurement, onu_key);
-    err = bcmolt_oper_submit(dev_id, &onu_oper.hdr);
-    if (err == BCM_ERR_OK) {
-        // initialize map
-        bcmos_fastlock_lock(&onu_rssi_wait_lock);
-        onu_rssi_compltd_map.insert({key, &queue});
-        bcmos_fastlock_unlock(&onu_rssi_wait_lock, 0);
-    } else {
-        OPENOLT_LOG(ERROR, openolt_log_id, "failed to measure rssi rx power - intf_id: %d, onu_id: %d, err = %s (%d): %s\n",
-            intf_id, onu_id, bcmos_strerror(err), err, onu_oper.hdr.hdr.err_text);
-        return bcm_to_grpc_err(err, "failed to measure rssi rx power");
-    }
-
     onu_rssi_complete_result completed{};
-    if (!queue.pop(completed, ONU_RSSI_COMPLETE_WAIT_TIMEOUT)) {
-        // invalidate the queue pointer
-        bcmos_fastlock_lock(&onu_rssi_wait_lock);
-        onu_rssi_compltd_map[key] = NULL;
-        bcmos_fastlock_unlock(&onu_rssi_wait_lock, 0);
-        err = BCM_ERR_TIMEOUT;
-        OPENOLT_LOG(ERROR, openolt_log_id, "timeout waiting for RSSI Measurement Completed indication intf_id %d, onu_id %d\n",
-                    intf_id, onu_id);
+    // The RSSI sweep measured the ONU recently enough
+    if (get_cached_onu_rx_power(intf_id, onu_id, &completed)) {
+        OPENOLT_LOG(DEBUG, openolt_log_id, "retrieved cached RSSI Rx power - intf_id: %d, onu_id: %d, rx_power_mean_dbm: %f\n",
+            intf_id, onu_id, completed.rx_power_mean_dbm);
     } else {
-        OPENOLT_LOG(INFO, openolt_log_id, "RSSI Rx power - intf_id: %d, onu_id: %d, status: %s, fail_reason: %d, rx_power_mean_dbm: %f\n",
-            completed.pon_intf_id, completed.onu_id, completed.status.c_str(), completed.reason, completed.rx_power_mean_dbm);
-
-        response->set_intf_id(completed.pon_intf_id);
-        response->set_onu_id(completed.onu_id);
-        response->set_status(completed.status);
-        response->set_fail_reason(static_cast<::openolt::PonRxPowerData_RssiMeasurementFailReason>(completed.reason));
-        response->set_rx_power_mean_dbm(completed.rx_power_mean_dbm);
+        err = measure_onu_rx_power(intf_id, onu_id, &completed);
+        if (err == BCM_ERR_TIMEOUT) {
+            return bcm_to_grpc_err(err, "timeout waiting for pon rssi measurement complete indication");
+        } else if (err != BCM_ERR_OK) {
+            return bcm_to_grpc_err(err, "failed to measure rssi rx power");
+        }
     }
 
-    // Remove entry from map
-    bcmos_fastlock_lock(&onu_rssi_wait_lock);
-    onu_rssi_compltd_map.erase(key);
-    bcmos_fastlock_unlock(&onu_rssi_wait_lock, 0);
+    response->set_intf_id(completed.pon_intf_id);
+    response->set_onu_id(completed.onu_id);
+    response->set_status(completed.status);
+    response->set_fail_reason(static_cast<::openolt::PonRxPowerData_RssiMeasurementFailReason>(completed.reason));
+    response->set_rx_power_mean_dbm(completed.rx_power_mean_dbm);
 
-    if (err == BCM_ERR_OK) {
-        return Status::OK;
-    } else {
-        return bcm_to_grpc_err(err, "timeout waiting for pon rssi measurement complete indication");
-    }
+    return Status::OK;
 }
 
 Status GetOnuInfo_(uint32_t intf_id, uint32_t onu_id, openolt::OnuInfo *response)
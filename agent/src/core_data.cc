@@ -149,6 +149,53 @@ std::map<onu_deact_compltd_key,  Queue<onu_deactivate_complete_result> *> onu_de
 // Lock to protect critical section data structure used for handling Onu Deactivation Completed Indication
 bcmos_fastlock onu_deactivate_wait_lock;
 
+// MAC devices whose connection was requested by Enable_ and is not completed yet. The value is
+// the time the connect was submitted. An entry is removed when the device connection complete
+// or connection failure indication is received, the OLT is activated once the map is empty.
+std::map<bcmolt_odid, std::chrono::steady_clock::time_point> mac_device_connect_map;
+// Set by Enable_ once the connect of every MAC device has been submitted
+bool mac_device_connect_armed = false;
+// Number of MAC devices which reported connection complete during startup
+uint32_t mac_device_connected_cnt = 0;
+// Lock to protect critical section data structure used for tracking MAC device connection
+bcmos_fastlock mac_device_connect_lock;
+
+// ONU state as reported by the ONU indications, see get_onu_state. An entry is only valid while
+// the generation of its PON is unchanged, the generation is bumped when the PON changes state.
+std::map<onu_state_cache_key, onu_state_cache_entry> onu_state_cache;
+uint32_t onu_state_cache_generation[MAX_SUPPORTED_PON];
+// Lock to protect critical section data structure used for caching the ONU state
+bcmos_fastlock onu_state_cache_lock;
+
+// Index of the ONUs by serial number, filled from the discovery indications and ONU activations.
+// onu_to_sn_map is the reverse map, (pon_intf_id, onu_id) to serial number, of the activated ONUs.
+std::unordered_map<onu_sn_key, onu_sn_entry> onu_sn_index;
+std::map<onu_state_cache_key, onu_sn_key> onu_to_sn_map;
+// Number of serial numbers seen on a PON while activated on another one
+uint64_t onu_sn_duplicate_count = 0;
+// Lock to protect critical section data structure used for the serial number index
+bcmos_fastlock onu_sn_index_lock;
+
+// Time of the last discovery forwarded to VOLTHA for a serial number on a PON. Discoveries of
+// the same ONU within onu_discovery_window seconds (0 disables it) are suppressed.
+std::map<onu_discovery_key, std::chrono::steady_clock::time_point> onu_discovery_map;
+uint32_t onu_discovery_window = ONU_DISCOVERY_WINDOW;
+uint64_t onu_discovery_forwarded_count[MAX_SUPPORTED_PON];
+uint64_t onu_discovery_suppressed_count[MAX_SUPPORTED_PON];
+// Lock to protect critical section data structure used for the ONU discovery de-duplication
+bcmos_fastlock onu_discovery_lock;
+
+// ONU statistics read per second by the ONU statistics sweep, 0 disables the sweep
+uint32_t onu_stats_sweep_rate = ONU_STATS_SWEEP_RATE;
+// GEM port statistics read per second by the statistics sweep, 0 disables it
+uint32_t gem_stats_sweep_rate = GEM_STATS_SWEEP_RATE;
+// Flow statistics read per collection period, in turn over all the flows, 0 disables them
+uint32_t flow_stats_budget = FLOW_STATS_BUDGET;
+// Seconds between two rx power measurements of an ONU by the RSSI sweep, 0 disables the sweep
+uint32_t rssi_sweep_interval = RSSI_SWEEP_INTERVAL;
+// Seconds between two reads of the diagnostics of the PON transceivers, 0 disables them
+uint32_t trx_ddm_poll_interval = TRX_DDM_POLL_INTERVAL;
+
 /*** ACL Handling related data start ***/
 
 std::map<acl_classifier_key, uint16_t> acl_classifier_to_acl_id_map;
@@ -17,9 +17,11 @@
 #define OPENOLT_CORE_DATA_H_
 
 #include <bitset>
+#include <unordered_map>
 
 #include "core.h"
 #include "Queue.h"
+#include "indications.h"
 #include "device.h"
 
 // pcapplusplus packet decoder include files
@@ -163,6 +165,26 @@ typedef std::tuple<uint32_t, uint32_t> gem_cfg_compltd_key;
 // key for map used for tracking Onu Deactivation Completed Indication
 typedef std::tuple<uint32_t, uint32_t> onu_deact_compltd_key;
 
+// key for map used for caching the ONU state, (pon_intf_id, onu_id)
+typedef std::tuple<uint32_t, uint32_t> onu_state_cache_key;
+
+typedef struct {
+    bcmolt_onu_state state;
+    uint32_t generation; // generation of the PON when the state was cached
+} onu_state_cache_entry;
+
+// Serial number packed in 8 bytes, the vendor_id in the upper 4 bytes and the
+// vendor_specific in the lower 4 bytes. Key of onu_sn_index.
+typedef uint64_t onu_sn_key;
+
+typedef struct {
+    uint32_t pon_intf_id;
+    uint32_t onu_id; // 0 while the ONU is only discovered, set once it is activated
+} onu_sn_entry;
+
+// key for map used for the ONU discovery de-duplication, (pon_intf_id, serial number)
+typedef std::tuple<uint32_t, onu_sn_key> onu_discovery_key;
+
 // The elements in this acl_classifier_key structure constitute key to
 // acl_classifier_to_acl_id_map.
 // Fill invalid values in the acl_classifier_key structure to -1.
@@ -305,6 +327,53 @@ extern bcmos_fastlock gem_cfg_wait_lock;
 // Lock to protect critical section data structure used for handling Onu deactivation completed Indication
 extern bcmos_fastlock onu_deactivate_wait_lock;
 
+// MAC devices whose connection was requested by Enable_ and is not completed yet. The value is
+// the time the connect was submitted. An entry is removed when the device connection complete
+// or connection failure indication is received, the OLT is activated once the map is empty.
+extern std::map<bcmolt_odid, std::chrono::steady_clock::time_point> mac_device_connect_map;
+// Set by Enable_ once the connect of every MAC device has been submitted
+extern bool mac_device_connect_armed;
+// Number of MAC devices which reported connection complete during startup or were already connected
+extern uint32_t mac_device_connected_cnt;
+// Lock to protect critical section data structure used for tracking MAC device connection
+extern bcmos_fastlock mac_device_connect_lock;
+
+// ONU state as reported by the ONU indications, see get_onu_state. An entry is only valid while
+// the generation of its PON is unchanged, the generation is bumped when the PON changes state.
+extern std::map<onu_state_cache_key, onu_state_cache_entry> onu_state_cache;
+extern uint32_t onu_state_cache_generation[MAX_SUPPORTED_PON];
+// Lock to protect critical section data structure used for caching the ONU state
+extern bcmos_fastlock onu_state_cache_lock;
+
+// Index of the ONUs by serial number, filled from the discovery indications and ONU activations.
+// onu_to_sn_map is the reverse map, (pon_intf_id, onu_id) to serial number, of the activated ONUs.
+extern std::unordered_map<onu_sn_key, onu_sn_entry> onu_sn_index;
+extern std::map<onu_state_cache_key, onu_sn_key> onu_to_sn_map;
+// Number of serial numbers seen on a PON while activated on another one
+extern uint64_t onu_sn_duplicate_count;
+// Lock to protect critical section data structure used for the serial number index
+extern bcmos_fastlock onu_sn_index_lock;
+
+// Time of the last discovery forwarded to VOLTHA for a serial number on a PON. Discoveries of
+// the same ONU within onu_discovery_window seconds (0 disables it) are suppressed.
+extern std::map<onu_discovery_key, std::chrono::steady_clock::time_point> onu_discovery_map;
+extern uint32_t onu_discovery_window;
+extern uint64_t onu_discovery_forwarded_count[MAX_SUPPORTED_PON];
+extern uint64_t onu_discovery_suppressed_count[MAX_SUPPORTED_PON];
+// Lock to protect critical section data structure used for the ONU discovery de-duplication
+extern bcmos_fastlock onu_discovery_lock;
+
+// ONU statistics read per second by the ONU statistics sweep, 0 disables the sweep
+extern uint32_t onu_stats_sweep_rate;
+// GEM port statistics read per second by the statistics sweep, 0 disables it
+extern uint32_t gem_stats_sweep_rate;
+// Flow statistics read per collection period, in turn over all the flows, 0 disables them
+extern uint32_t flow_stats_budget;
+// Seconds between two rx power measurements of an ONU by the RSSI sweep, 0 disables the sweep
+extern uint32_t rssi_sweep_interval;
+// Seconds between two reads of the diagnostics of the PON transceivers, 0 disables them
+extern uint32_t trx_ddm_poll_interval;
+
 
 /*** ACL Handling related data start ***/
 
@@ -396,7 +465,6 @@ extern bcmos_fastlock pon_gem_to_onu_uni_map_lock;
 // Lock to protect critical section around handling data associated with ACL trap packet handling
 extern bcmos_fastlock acl_packet_trap_handler_lock;
 
-extern Queue<openolt::Indication> oltIndQ;
 
 /*** ACL Handling related data end ***/
 
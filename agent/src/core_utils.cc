@@ -16,7 +16,12 @@
 
 #include <fstream>
 #include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <thread>
 #include "core_utils.h"
+#include "state_journal.h"
 
 // save the TLS option
 static std::string tls_option_arg{};
@@ -125,6 +130,7 @@ uint32_t get_tm_sched_id(int pon_intf_id, int onu_id, int uni_id, std::string di
 
     if (sched_id < MAX_TM_SCHED_ID) {
         sched_map[key] = sched_id;
+        state_journal_sched_set(key, sched_id);
         bcmos_fastlock_unlock(&tm_sched_bitset_lock, 0);
         return sched_id;
     } else {
@@ -151,6 +157,7 @@ void free_tm_sched_id(int pon_intf_id, int onu_id, int uni_id, std::string direc
     if (it != sched_map.end()) {
         tm_sched_bitset[it->second] = 0;
         sched_map.erase(it);
+        state_journal_sched_erase(key);
     }
     bcmos_fastlock_unlock(&tm_sched_bitset_lock, 0);
 }
@@ -256,7 +263,8 @@ void update_sched_qmp_id_map(uint32_t sched_id,uint32_t pon_intf_id, uint32_t on
                              uint32_t uni_id, int tm_qmp_id) {
    bcmos_fastlock_lock(&tm_qmp_bitset_lock);
    sched_qmp_id_map_key_tuple key(sched_id, pon_intf_id, onu_id, uni_id);
-   sched_qmp_id_map.insert(make_pair(key, tm_qmp_id));
+   auto res = sched_qmp_id_map.insert(make_pair(key, tm_qmp_id));
+   state_journal_sched_qmp_set(key, res.first->second);
    bcmos_fastlock_unlock(&tm_qmp_bitset_lock, 0);
 }
 
@@ -309,6 +317,7 @@ int get_tm_qmp_id(uint32_t sched_id,uint32_t pon_intf_id, uint32_t onu_id, uint3
 
     if (tm_qmp_id < MAX_TM_QMP_ID) {
         qmp_id_to_qmp_map.insert(make_pair(tm_qmp_id, tmq_map_profile));
+        state_journal_qmp_set(tm_qmp_id, tmq_map_profile);
         bcmos_fastlock_unlock(&tm_qmp_bitset_lock, 0);
         update_sched_qmp_id_map(sched_id, pon_intf_id, onu_id, uni_id, tm_qmp_id);
         return tm_qmp_id;
@@ -337,6 +346,7 @@ bool free_tm_qmp_id(uint32_t sched_id,uint32_t pon_intf_id, uint32_t onu_id, \
     bcmos_fastlock_lock(&tm_qmp_bitset_lock);
     if (it != sched_qmp_id_map.end()) {
         sched_qmp_id_map.erase(it);
+        state_journal_sched_qmp_erase(key);
     }
 
     uint32_t tm_qmp_ref_count = 0;
@@ -353,6 +363,7 @@ bool free_tm_qmp_id(uint32_t sched_id,uint32_t pon_intf_id, uint32_t onu_id, \
         if (it3 != qmp_id_to_qmp_map.end()) {
             tm_qmp_bitset[tm_qmp_id] = 0;
             qmp_id_to_qmp_map.erase(it3);
+            state_journal_qmp_erase(tm_qmp_id);
             OPENOLT_LOG(INFO, openolt_log_id, "Reference count for tm qmp profile id %d is : %d. So clearing it\n", \
                         tm_qmp_id, tm_qmp_ref_count);
             result = true;
@@ -752,6 +763,72 @@ bcmos_errno wait_for_onu_deactivate_complete(uint32_t intf_id, uint32_t onu_id)
     return err;
 }
 
+/* Activate the OLT once every MAC device connect submitted by Enable_ has completed.
+   mac_device_connect_lock must be held. */
+static void mac_device_connect_check_complete() {
+    if (!mac_device_connect_armed || !mac_device_connect_map.empty()) {
+        return;
+    }
+    mac_device_connect_armed = false;
+    if (mac_device_connected_cnt > 0) {
+        OPENOLT_LOG(INFO, openolt_log_id, "%u PON device(s) connected, activating OLT\n", mac_device_connected_cnt);
+        state.activate();
+    } else {
+        OPENOLT_LOG(ERROR, openolt_log_id, "no PON device connected\n");
+        state.deactivate();
+    }
+}
+
+// Called right before the connect of a MAC device is submitted
+void mac_device_connect_start(bcmolt_odid dev) {
+    bcmos_fastlock_lock(&mac_device_connect_lock);
+    mac_device_connect_map[dev] = std::chrono::steady_clock::now();
+    bcmos_fastlock_unlock(&mac_device_connect_lock, 0);
+}
+
+// Called when the connect of a MAC device could not be submitted
+void mac_device_connect_abort(bcmolt_odid dev) {
+    bcmos_fastlock_lock(&mac_device_connect_lock);
+    mac_device_connect_map.erase(dev);
+    mac_device_connect_check_complete();
+    bcmos_fastlock_unlock(&mac_device_connect_lock, 0);
+}
+
+// Called for a MAC device found already connected, it counts as connected for the activation
+void mac_device_connect_already(bcmolt_odid dev) {
+    bcmos_fastlock_lock(&mac_device_connect_lock);
+    mac_device_connected_cnt++;
+    bcmos_fastlock_unlock(&mac_device_connect_lock, 0);
+}
+
+// Called once the connect of every MAC device has been submitted
+void mac_device_connect_arm() {
+    bcmos_fastlock_lock(&mac_device_connect_lock);
+    mac_device_connect_armed = true;
+    mac_device_connect_check_complete();
+    bcmos_fastlock_unlock(&mac_device_connect_lock, 0);
+}
+
+/* Called from the device connection complete/failure indication.
+   Returns false if the connect of this device was not submitted by Enable_. */
+bool mac_device_connect_done(bcmolt_odid dev, bool connected) {
+    bcmos_fastlock_lock(&mac_device_connect_lock);
+    std::map<bcmolt_odid, std::chrono::steady_clock::time_point>::iterator it = mac_device_connect_map.find(dev);
+    if (it == mac_device_connect_map.end()) {
+        bcmos_fastlock_unlock(&mac_device_connect_lock, 0);
+        return false;
+    }
+    long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - it->second).count();
+    OPENOLT_LOG(INFO, openolt_log_id, "PON device %d connection %s after %ld ms\n", dev, connected ? "completed" : "failed", elapsed);
+    mac_device_connect_map.erase(it);
+    if (connected) {
+        mac_device_connected_cnt++;
+    }
+    mac_device_connect_check_complete();
+    bcmos_fastlock_unlock(&mac_device_connect_lock, 0);
+    return true;
+}
+
 char* openolt_read_sysinfo(const char* field_name, char* field_val)
 {
    FILE *fp;
@@ -788,7 +865,7 @@ Status pushOltOperInd(uint32_t intf_id, const char *type, const char *state, uin
     intf_oper_ind->set_oper_state(state);
     intf_oper_ind->set_speed(speed);
     ind.set_allocated_intf_oper_ind(intf_oper_ind);
-    oltIndQ.push(ind);
+    oltIndQ.push(std::move(ind));
     return Status::OK;
 }
 
@@ -877,7 +954,13 @@ bcmos_errno bcmolt_apiend_cli_init() {
     }
 }
 
+/* The state is taken from onu_state_cache when an ONU indication reported it since the last
+   state change of the PON, BAL is queried otherwise. */
 bcmos_errno get_onu_state(bcmolt_interface pon_ni, int onu_id, bcmolt_onu_state *onu_state) {
+    if (get_cached_onu_state(pon_ni, onu_id, onu_state)) {
+        return BCM_ERR_OK;
+    }
+
     bcmos_errno err;
     bcmolt_onu_cfg onu_cfg;
     bcmolt_onu_key onu_key;
@@ -891,6 +974,212 @@ bcmos_errno get_onu_state(bcmolt_interface pon_ni, int onu_id, bcmolt_onu_state
     return err;
 }
 
+bool get_cached_onu_state(uint32_t pon_intf_id, uint32_t onu_id, bcmolt_onu_state *onu_state) {
+    bool hit = false;
+
+    if (pon_intf_id >= MAX_SUPPORTED_PON) {
+        return false;
+    }
+    bcmos_fastlock_lock(&onu_state_cache_lock);
+    std::map<onu_state_cache_key, onu_state_cache_entry>::const_iterator it = onu_state_cache.find(onu_state_cache_key(pon_intf_id, onu_id));
+    if (it != onu_state_cache.end() && it->second.generation == onu_state_cache_generation[pon_intf_id]) {
+        *onu_state = it->second.state;
+        hit = true;
+    }
+    bcmos_fastlock_unlock(&onu_state_cache_lock, 0);
+    return hit;
+}
+
+void update_onu_state_cache(uint32_t pon_intf_id, uint32_t onu_id, bcmolt_onu_state onu_state) {
+    if (pon_intf_id >= MAX_SUPPORTED_PON) {
+        return;
+    }
+    bcmos_fastlock_lock(&onu_state_cache_lock);
+    onu_state_cache_entry& entry = onu_state_cache[onu_state_cache_key(pon_intf_id, onu_id)];
+    entry.state = onu_state;
+    entry.generation = onu_state_cache_generation[pon_intf_id];
+    bcmos_fastlock_unlock(&onu_state_cache_lock, 0);
+}
+
+/* Called when the ONU state is changed by the agent or reported without the new state,
+   the next get_onu_state queries BAL until an indication reports the state again. */
+void invalidate_onu_state_cache(uint32_t pon_intf_id, uint32_t onu_id) {
+    bcmos_fastlock_lock(&onu_state_cache_lock);
+    onu_state_cache.erase(onu_state_cache_key(pon_intf_id, onu_id));
+    bcmos_fastlock_unlock(&onu_state_cache_lock, 0);
+}
+
+void invalidate_pon_onu_state_cache(uint32_t pon_intf_id) {
+    if (pon_intf_id >= MAX_SUPPORTED_PON) {
+        return;
+    }
+    bcmos_fastlock_lock(&onu_state_cache_lock);
+    onu_state_cache_generation[pon_intf_id]++;
+    bcmos_fastlock_unlock(&onu_state_cache_lock, 0);
+}
+
+onu_sn_key get_onu_sn_key(const char *vendor_id, const char *vendor_specific) {
+    onu_sn_key sn = 0;
+
+    for (int i = 0; i < 4; i++) {
+        sn = (sn << 8) | (uint8_t)vendor_id[i];
+    }
+    for (int i = 0; i < 4; i++) {
+        sn = (sn << 8) | (uint8_t)vendor_specific[i];
+    }
+    return sn;
+}
+
+/* Returns false when the serial number is not known. The onu_id is 0 when the ONU
+   is only discovered. */
+bool onu_sn_index_lookup(onu_sn_key sn, uint32_t *pon_intf_id, uint32_t *onu_id) {
+    bool found = false;
+
+    bcmos_fastlock_lock(&onu_sn_index_lock);
+    std::unordered_map<onu_sn_key, onu_sn_entry>::const_iterator it = onu_sn_index.find(sn);
+    if (it != onu_sn_index.end()) {
+        *pon_intf_id = it->second.pon_intf_id;
+        *onu_id = it->second.onu_id;
+        found = true;
+    }
+    bcmos_fastlock_unlock(&onu_sn_index_lock, 0);
+    return found;
+}
+
+/* Records the discovery of a serial number on a PON. Returns true when the serial number
+   is activated on another PON, that is a cloned or rogue ONU, the activated ONU is kept
+   in the index then. */
+bool onu_sn_index_discovered(uint32_t pon_intf_id, onu_sn_key sn) {
+    bool duplicate = false;
+
+    bcmos_fastlock_lock(&onu_sn_index_lock);
+    std::unordered_map<onu_sn_key, onu_sn_entry>::iterator it = onu_sn_index.find(sn);
+    if (it == onu_sn_index.end()) {
+        onu_sn_entry entry = {pon_intf_id, 0};
+        onu_sn_index[sn] = entry;
+    } else if (it->second.onu_id == 0) {
+        it->second.pon_intf_id = pon_intf_id;
+    } else if (it->second.pon_intf_id != pon_intf_id) {
+        onu_sn_duplicate_count++;
+        duplicate = true;
+    }
+    bcmos_fastlock_unlock(&onu_sn_index_lock, 0);
+    return duplicate;
+}
+
+/* Records the activation of an ONU. Returns false when the serial number was activated
+   as another ONU, the index then points to the new ONU. */
+bool onu_sn_index_activated(uint32_t pon_intf_id, uint32_t onu_id, onu_sn_key sn) {
+    bool unique = true;
+    onu_sn_entry entry = {pon_intf_id, onu_id};
+    onu_state_cache_key key(pon_intf_id, onu_id);
+
+    bcmos_fastlock_lock(&onu_sn_index_lock);
+    std::unordered_map<onu_sn_key, onu_sn_entry>::iterator it = onu_sn_index.find(sn);
+    if (it != onu_sn_index.end() && it->second.onu_id != 0 &&
+        (it->second.pon_intf_id != pon_intf_id || it->second.onu_id != onu_id)) {
+        onu_to_sn_map.erase(onu_state_cache_key(it->second.pon_intf_id, it->second.onu_id));
+        onu_sn_duplicate_count++;
+        unique = false;
+    }
+    // the ONU ID may have been used by another serial number before
+    std::map<onu_state_cache_key, onu_sn_key>::iterator old = onu_to_sn_map.find(key);
+    if (old != onu_to_sn_map.end() && old->second != sn) {
+        onu_sn_index.erase(old->second);
+    }
+    onu_sn_index[sn] = entry;
+    onu_to_sn_map[key] = sn;
+    bcmos_fastlock_unlock(&onu_sn_index_lock, 0);
+    return unique;
+}
+
+void onu_sn_index_remove(uint32_t pon_intf_id, uint32_t onu_id) {
+    bcmos_fastlock_lock(&onu_sn_index_lock);
+    std::map<onu_state_cache_key, onu_sn_key>::iterator it = onu_to_sn_map.find(onu_state_cache_key(pon_intf_id, onu_id));
+    if (it != onu_to_sn_map.end()) {
+        onu_sn_index.erase(it->second);
+        onu_to_sn_map.erase(it);
+    }
+    bcmos_fastlock_unlock(&onu_sn_index_lock, 0);
+}
+
+/* Returns true when a discovery of the serial number was forwarded on the PON less than
+   onu_discovery_window seconds ago. The discovery is counted as suppressed then,
+   otherwise it is counted as forwarded and starts a new window. */
+bool onu_discovery_suppressed(uint32_t pon_intf_id, onu_sn_key sn) {
+    bool suppressed = false;
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    if (pon_intf_id >= MAX_SUPPORTED_PON) {
+        return false;
+    }
+    bcmos_fastlock_lock(&onu_discovery_lock);
+    std::map<onu_discovery_key, std::chrono::steady_clock::time_point>::iterator it =
+        onu_discovery_map.find(onu_discovery_key(pon_intf_id, sn));
+    if (it != onu_discovery_map.end() && now - it->second < std::chrono::seconds(onu_discovery_window)) {
+        onu_discovery_suppressed_count[pon_intf_id]++;
+        suppressed = true;
+    } else {
+        onu_discovery_map[onu_discovery_key(pon_intf_id, sn)] = now;
+        onu_discovery_forwarded_count[pon_intf_id]++;
+    }
+    bcmos_fastlock_unlock(&onu_discovery_lock, 0);
+    return suppressed;
+}
+
+/* The next discovery of the ONU is forwarded, e.g. once it is deleted */
+void onu_discovery_forget(uint32_t pon_intf_id, onu_sn_key sn) {
+    bcmos_fastlock_lock(&onu_discovery_lock);
+    onu_discovery_map.erase(onu_discovery_key(pon_intf_id, sn));
+    bcmos_fastlock_unlock(&onu_discovery_lock, 0);
+}
+
+void onu_discovery_forget_pon(uint32_t pon_intf_id) {
+    bcmos_fastlock_lock(&onu_discovery_lock);
+    onu_discovery_map.erase(onu_discovery_map.lower_bound(onu_discovery_key(pon_intf_id, 0)),
+        onu_discovery_map.lower_bound(onu_discovery_key(pon_intf_id + 1, 0)));
+    bcmos_fastlock_unlock(&onu_discovery_lock, 0);
+}
+
+/* Logs the discoveries forwarded and suppressed per PON since the last summary, at most
+   every ONU_DISCOVERY_SUMMARY_INTERVAL, and drops the expired windows. */
+void onu_discovery_summary() {
+    static std::chrono::steady_clock::time_point last_summary;
+    static uint64_t last_forwarded[MAX_SUPPORTED_PON];
+    static uint64_t last_suppressed[MAX_SUPPORTED_PON];
+    uint64_t forwarded[MAX_SUPPORTED_PON];
+    uint64_t suppressed[MAX_SUPPORTED_PON];
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    if (now - last_summary < std::chrono::seconds(ONU_DISCOVERY_SUMMARY_INTERVAL)) {
+        return;
+    }
+    last_summary = now;
+
+    bcmos_fastlock_lock(&onu_discovery_lock);
+    for (std::map<onu_discovery_key, std::chrono::steady_clock::time_point>::iterator it = onu_discovery_map.begin();
+         it != onu_discovery_map.end();) {
+        if (now - it->second >= std::chrono::seconds(onu_discovery_window)) {
+            it = onu_discovery_map.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    memcpy(forwarded, onu_discovery_forwarded_count, sizeof(forwarded));
+    memcpy(suppressed, onu_discovery_suppressed_count, sizeof(suppressed));
+    bcmos_fastlock_unlock(&onu_discovery_lock, 0);
+
+    for (int i = 0; i < MAX_SUPPORTED_PON; i++) {
+        if (suppressed[i] != last_suppressed[i]) {
+            OPENOLT_LOG(INFO, openolt_log_id, "onu discovery summary, pon_ni %d, forwarded %llu, suppressed %llu (total forwarded %llu, suppressed %llu)\n",
+                i, (unsigned long long)(forwarded[i] - last_forwarded[i]), (unsigned long long)(suppressed[i] - last_suppressed[i]),
+                (unsigned long long)forwarded[i], (unsigned long long)suppressed[i]);
+        }
+        last_forwarded[i] = forwarded[i];
+        last_suppressed[i] = suppressed[i];
+    }
+}
+
 bcmos_errno get_gpon_onu_info(bcmolt_interface pon_ni, int onu_id, bcmolt_onu_state *onu_state, bcmolt_status *losi, bcmolt_status *lofi, bcmolt_status *loami)
 {
 
@@ -1608,19 +1897,37 @@ Status handle_acl_rule_cleanup(int16_t acl_id, int32_t intf_id, const std::strin
     return Status::OK;
 }
 
+/* The BAL daemon connection and bal_state are not indicated to the host, so
+   they are probed: once right away, then with an interval doubling from
+   BAL_PROBE_MIN_INTERVAL up to BAL_PROBE_MAX_INTERVAL until timeout_sec.
+   Unlike a fixed tick this returns within a few ms of the transition when BAL
+   is already up or comes up quickly, while not hammering it when it is slow. */
+static bool probe_with_backoff(const std::function<bool()>& probe, int timeout_sec, const char* what) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(timeout_sec);
+    std::chrono::milliseconds interval(BAL_PROBE_MIN_INTERVAL);
+
+    if (probe()) {
+        return true;
+    }
+    OPENOLT_LOG(INFO, openolt_log_id, "waiting for %s ...\n", what);
+    while (std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(interval);
+        if (probe()) {
+            return true;
+        }
+        interval = std::min(interval * 2, std::chrono::milliseconds(BAL_PROBE_MAX_INTERVAL));
+    }
+    return false;
+}
+
 Status check_bal_ready() {
-    bcmos_errno err;
-    int maxTrials = 30;
     bcmolt_olt_cfg olt_cfg = { };
     bcmolt_olt_key olt_key = { };
 
     BCMOLT_CFG_INIT(&olt_cfg, olt, olt_key);
     BCMOLT_MSG_FIELD_GET(&olt_cfg, bal_state);
 
-    while (olt_cfg.data.bal_state != BCMOLT_BAL_STATE_BAL_AND_SWITCH_READY) {
-        if (--maxTrials == 0)
-            return grpc::Status(grpc::StatusCode::UNAVAILABLE, "check bal ready failed");
-        sleep(5);
+    bool ready = probe_with_backoff([&olt_cfg]() {
         #ifdef TEST_MODE
         // It is impossible to mock the setting of olt_cfg.data.bal_state because
         // the actual bcmolt_cfg_get passes the address of olt_cfg.hdr and we cannot
@@ -1631,10 +1938,12 @@ Status check_bal_ready() {
         #else
         if (bcmolt_cfg_get(dev_id, &olt_cfg.hdr)) {
         #endif
-            continue;
+            return false;
         }
-        else
-            OPENOLT_LOG(INFO, openolt_log_id, "waiting for BAL ready ...\n");
+        return olt_cfg.data.bal_state == BCMOLT_BAL_STATE_BAL_AND_SWITCH_READY;
+    }, BAL_READY_TIMEOUT, "BAL ready");
+    if (!ready) {
+        return grpc::Status(grpc::StatusCode::UNAVAILABLE, "check bal ready failed");
     }
 
     OPENOLT_LOG(INFO, openolt_log_id, "BAL is ready\n");
@@ -1642,13 +1951,11 @@ Status check_bal_ready() {
 }
 
 Status check_connection() {
-    int maxTrials = 60;
-    while (!bcmolt_api_conn_mgr_is_connected(dev_id)) {
-        sleep(1);
-        if (--maxTrials == 0)
-            return grpc::Status(grpc::StatusCode::UNAVAILABLE, "check connection failed");
-        else
-            OPENOLT_LOG(INFO, openolt_log_id, "waiting for daemon connection ...\n");
+    bool connected = probe_with_backoff([]() {
+        return bcmolt_api_conn_mgr_is_connected(dev_id) == BCMOS_TRUE;
+    }, BAL_CONNECT_TIMEOUT, "daemon connection");
+    if (!connected) {
+        return grpc::Status(grpc::StatusCode::UNAVAILABLE, "check connection failed");
     }
     OPENOLT_LOG(INFO, openolt_log_id, "daemon is connected\n");
     return Status::OK;
@@ -1758,6 +2065,7 @@ void update_voltha_flow_to_cache(uint64_t voltha_flow_id, device_flow dev_flow)
     OPENOLT_LOG(DEBUG, openolt_log_id, "updating voltha flow=%lu to cache\n", voltha_flow_id)
     bcmos_fastlock_lock(&voltha_flow_to_device_flow_lock);
     voltha_flow_to_device_flow[voltha_flow_id] = dev_flow;
+    state_journal_voltha_flow_set(voltha_flow_id, dev_flow);
     bcmos_fastlock_unlock(&voltha_flow_to_device_flow_lock, 0);
 }
 
@@ -1766,6 +2074,7 @@ void remove_voltha_flow_from_cache(uint64_t voltha_flow_id) {
     std::map<uint64_t, device_flow>::const_iterator it = voltha_flow_to_device_flow.find(voltha_flow_id);
     if (it != voltha_flow_to_device_flow.end()) {
         voltha_flow_to_device_flow.erase(it);
+        state_journal_voltha_flow_erase(voltha_flow_id);
     }
     bcmos_fastlock_unlock(&voltha_flow_to_device_flow_lock, 0);
 }
@@ -79,6 +79,11 @@ std::string GetDirection(int direction);
 bcmos_errno wait_for_alloc_action(uint32_t intf_id, uint32_t alloc_id, AllocCfgAction action);
 bcmos_errno wait_for_gem_action(uint32_t intf_id, uint32_t gem_port_id, GemCfgAction action);
 bcmos_errno wait_for_onu_deactivate_complete(uint32_t intf_id, uint32_t onu_id);
+void mac_device_connect_start(bcmolt_odid dev);
+void mac_device_connect_abort(bcmolt_odid dev);
+void mac_device_connect_already(bcmolt_odid dev);
+void mac_device_connect_arm();
+bool mac_device_connect_done(bcmolt_odid dev, bool connected);
 char* openolt_read_sysinfo(const char* field_name, char* field_val);
 Status pushOltOperInd(uint32_t intf_id, const char *type, const char *state);
 void openolt_cli_get_prompt_cb(bcmcli_session *session, char *buf, uint32_t max_len);
@@ -89,6 +94,19 @@ int get_status_bcm_cli_quit(void);
 bcmos_errno bcmolt_apiend_cli_init();
 bcmos_errno get_pon_interface_status(bcmolt_interface pon_ni, bcmolt_interface_state *state, bcmolt_status *los_status);
 bcmos_errno get_onu_state(bcmolt_interface pon_ni, int onu_id, bcmolt_onu_state *onu_state);
+bool get_cached_onu_state(uint32_t pon_intf_id, uint32_t onu_id, bcmolt_onu_state *onu_state);
+void update_onu_state_cache(uint32_t pon_intf_id, uint32_t onu_id, bcmolt_onu_state onu_state);
+void invalidate_onu_state_cache(uint32_t pon_intf_id, uint32_t onu_id);
+void invalidate_pon_onu_state_cache(uint32_t pon_intf_id);
+onu_sn_key get_onu_sn_key(const char *vendor_id, const char *vendor_specific);
+bool onu_sn_index_lookup(onu_sn_key sn, uint32_t *pon_intf_id, uint32_t *onu_id);
+bool onu_sn_index_discovered(uint32_t pon_intf_id, onu_sn_key sn);
+bool onu_sn_index_activated(uint32_t pon_intf_id, uint32_t onu_id, onu_sn_key sn);
+void onu_sn_index_remove(uint32_t pon_intf_id, uint32_t onu_id);
+bool onu_discovery_suppressed(uint32_t pon_intf_id, onu_sn_key sn);
+void onu_discovery_forget(uint32_t pon_intf_id, onu_sn_key sn);
+void onu_discovery_forget_pon(uint32_t pon_intf_id);
+void onu_discovery_summary();
 bcmos_errno get_gpon_onu_info(bcmolt_interface pon_ni, int onu_id, bcmolt_onu_state *onu_state, bcmolt_status *losi, bcmolt_status *lofi,bcmolt_status *loami);
 bcmos_errno bcmolt_cfg_get_mult_retry(bcmolt_oltid olt, bcmolt_cfg *cfg);
 unsigned NumNniIf_();
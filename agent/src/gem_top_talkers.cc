@@ -0,0 +1,104 @@
+/*
+ * Copyright 2018-present Open Networking Foundation
+
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gem_top_talkers.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <mutex>
+#include <string>
+
+#include "core_data.h"
+
+static bool more_bytes(const gem_top_talker& a, const gem_top_talker& b) {
+    return a.bytes > b.bytes;
+}
+
+/* A min-heap on bytes, ordered with more_bytes, the GEM port to replace is at the front */
+static std::vector<gem_top_talker> current_talkers[MAX_SUPPORTED_PON];
+static std::vector<gem_top_talker> last_talkers[MAX_SUPPORTED_PON];
+static std::mutex gem_top_talkers_lock;
+
+void gem_top_talkers_add(uint32_t intf_id, uint32_t gemport_id, uint32_t onu_id, uint32_t uni_id, uint64_t bytes) {
+    if (intf_id >= MAX_SUPPORTED_PON || bytes == 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(gem_top_talkers_lock);
+    std::vector<gem_top_talker>& heap = current_talkers[intf_id];
+    if (heap.size() == GEM_TOP_TALKERS) {
+        if (bytes <= heap.front().bytes) {
+            return;
+        }
+        std::pop_heap(heap.begin(), heap.end(), more_bytes);
+        heap.pop_back();
+    }
+    gem_top_talker talker = {gemport_id, onu_id, uni_id, bytes};
+    heap.push_back(talker);
+    std::push_heap(heap.begin(), heap.end(), more_bytes);
+}
+
+void gem_top_talkers_rotate() {
+    std::lock_guard<std::mutex> lock(gem_top_talkers_lock);
+    for (int i = 0; i < MAX_SUPPORTED_PON; i++) {
+        std::swap(last_talkers[i], current_talkers[i]);
+        current_talkers[i].clear();
+    }
+}
+
+void clear_gem_top_talkers(uint32_t intf_id) {
+    if (intf_id >= MAX_SUPPORTED_PON) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(gem_top_talkers_lock);
+    current_talkers[intf_id].clear();
+    last_talkers[intf_id].clear();
+}
+
+uint32_t get_gem_top_talkers(uint32_t intf_id, uint32_t num_talkers, std::vector<gem_top_talker>* talkers) {
+    std::vector<gem_top_talker> sorted;
+
+    if (intf_id >= MAX_SUPPORTED_PON) {
+        return 0;
+    }
+    {
+        std::lock_guard<std::mutex> lock(gem_top_talkers_lock);
+        sorted = last_talkers[intf_id];
+    }
+    num_talkers = std::min<uint32_t>(num_talkers, sorted.size());
+    std::partial_sort(sorted.begin(), sorted.begin() + num_talkers, sorted.end(), more_bytes);
+    talkers->insert(talkers->end(), sorted.begin(), sorted.begin() + num_talkers);
+    return num_talkers;
+}
+
+void log_gem_top_talkers(uint32_t intf_id) {
+    std::vector<gem_top_talker> talkers;
+    std::string line;
+    char talker_str[96];
+
+    if (get_gem_top_talkers(intf_id, GEM_TOP_TALKERS_LOGGED, &talkers) == 0) {
+        return;
+    }
+    for (std::vector<gem_top_talker>::const_iterator it = talkers.begin(); it != talkers.end(); ++it) {
+        snprintf(talker_str, sizeof(talker_str), " gemport_id %u (onu_id %u, uni_id %u) %" PRIu64 " bytes,",
+            it->gemport_id, it->onu_id, it->uni_id, it->bytes);
+        line += talker_str;
+    }
+    line.pop_back();
+    OPENOLT_LOG(INFO, openolt_log_id, "Top talkers of PON %u over the last statistics sweep:%s\n", intf_id, line.c_str());
+}
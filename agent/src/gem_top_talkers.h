@@ -0,0 +1,51 @@
+/*
+ * Copyright 2018-present Open Networking Foundation
+
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OPENOLT_GEM_TOP_TALKERS_H_
+#define OPENOLT_GEM_TOP_TALKERS_H_
+
+#include <vector>
+
+#include "core.h"
+
+/* The GEM ports of a PON carrying the most bytes are kept in a bounded
+   min-heap of GEM_TOP_TALKERS entries per PON, fed with the increase of the
+   counters of each GEM port read by the statistics sweep. The sweep reads each
+   GEM port once, so the counts are exact: a GEM port with fewer bytes than the
+   smallest entry of a full heap is not a top talker and is dropped, otherwise
+   it replaces that entry.
+
+   The heap is started over at the end of each sweep, the top talkers are
+   those of the last complete sweep. */
+
+typedef struct {
+    uint32_t gemport_id;
+    uint32_t onu_id;
+    uint32_t uni_id;
+    uint64_t bytes;  // rx and tx
+} gem_top_talker;
+
+/* Called once per GEM port and sweep */
+void gem_top_talkers_add(uint32_t intf_id, uint32_t gemport_id, uint32_t onu_id, uint32_t uni_id, uint64_t bytes);
+/* Makes the current summaries those returned by get_gem_top_talkers and starts new ones */
+void gem_top_talkers_rotate();
+void clear_gem_top_talkers(uint32_t intf_id);
+/* Appends the num_talkers GEM ports of a PON with the most bytes, most first, and
+   returns the number appended */
+uint32_t get_gem_top_talkers(uint32_t intf_id, uint32_t num_talkers, std::vector<gem_top_talker>* talkers);
+void log_gem_top_talkers(uint32_t intf_id);
+
+#endif
@@ -21,9 +21,12 @@
 #include "stats_collection.h"
 #include "translation.h"
 #include "state.h"
+#include "threshold_alarms.h"
 #include "trx_eeprom_reader.h"
 
 #include <string>
+#include <chrono>
+#include <thread>
 
 extern "C"
 {
@@ -180,11 +183,13 @@ static void OltOperIndication(bcmolt_devid olt, bcmolt_msg *msg) {
     openolt::Indication ind;
     openolt::OltIndication* olt_ind = new openolt::OltIndication;
     std::string admin_state;
+    bool startup_connect = false;
 
     switch (msg->subgroup) {
         case BCMOLT_DEVICE_AUTO_SUBGROUP_CONNECTION_COMPLETE:
             admin_state = "up";
             olt_ind->set_oper_state("up");
+            startup_connect = mac_device_connect_done(((bcmolt_device_connection_complete*)msg)->key.device_id, true);
             break;
         case BCMOLT_DEVICE_AUTO_SUBGROUP_DISCONNECTION_COMPLETE:
              admin_state = "down";
@@ -193,6 +198,7 @@ static void OltOperIndication(bcmolt_devid olt, bcmolt_msg *msg) {
         case BCMOLT_DEVICE_AUTO_SUBGROUP_CONNECTION_FAILURE:
              admin_state = "failure";
              olt_ind->set_oper_state("failure");
+            startup_connect = mac_device_connect_done(((bcmolt_device_connection_failure*)msg)->key.device_id, false);
             break;
     }
     ind.set_allocated_olt_ind(olt_ind);
@@ -207,13 +213,16 @@ static void OltOperIndication(bcmolt_devid olt, bcmolt_msg *msg) {
             rx_cfg.module = BCMOS_MODULE_ID_OMCI_TRANSPORT;
             bcmolt_ind_subscribe(current_device, &rx_cfg);
         }
-        state.activate();
+        // During startup the OLT is activated once all the MAC devices have connected
+        if (!startup_connect) {
+            state.activate();
+        }
     }
-    else {
+    else if (!startup_connect) {
         state.deactivate();
     }
 
-    oltIndQ.push(ind);
+    oltIndQ.push(std::move(ind));
     bcmolt_msg_free(msg);
 }
 
@@ -237,6 +246,7 @@ static void LosIndication(bcmolt_devid olt, bcmolt_msg *msg) {
 
                      los_ind->set_intf_id(intf_id);
                      los_ind->set_status(status);
+                     invalidate_pon_onu_state_cache(bcm_los_ind->key.pon_ni);
 
                      alarm_ind->set_allocated_los_ind(los_ind);
                      ind.set_allocated_alarm_ind(alarm_ind);
@@ -245,7 +255,7 @@ static void LosIndication(bcmolt_devid olt, bcmolt_msg *msg) {
             }
     }
 
-    oltIndQ.push(ind);
+    oltIndQ.push(std::move(ind));
     bcmolt_msg_free(msg);
 }
 
@@ -293,7 +303,7 @@ static void IfIndication(bcmolt_devid olt, bcmolt_msg *msg) {
             }
     }
 
-    oltIndQ.push(ind);
+    oltIndQ.push(std::move(ind));
     bcmolt_msg_free(msg);
 }
 
@@ -311,6 +321,7 @@ static void IfOperIndication(bcmolt_devid olt, bcmolt_msg *msg) {
                     intf_oper_ind->set_intf_id(key->pon_ni);
                     intf_oper_ind->set_type(bcmolt_to_grpc_intf_type(BCMOLT_INTERFACE_TYPE_PON));
                     SET_OPER_STATE(intf_oper_ind, data->new_state);
+                    invalidate_pon_onu_state_cache(key->pon_ni);
                     OPENOLT_LOG(INFO, openolt_log_id, "intf oper state indication, intf_type %s, intf_id %d, oper_state %s\n",
                         intf_oper_ind->type().c_str(), key->pon_ni, intf_oper_ind->oper_state().c_str());
                     ind.set_allocated_intf_oper_ind(intf_oper_ind);
@@ -336,7 +347,7 @@ static void IfOperIndication(bcmolt_devid olt, bcmolt_msg *msg) {
             }
     }
 
-    oltIndQ.push(ind);
+    oltIndQ.push(std::move(ind));
     bcmolt_msg_free(msg);
 }
 
@@ -363,6 +374,11 @@ static void OnuDisableIndication(bcmolt_devid olt, bcmolt_msg *msg) {
 
                     onu_disable_ind->set_intf_id(key->pon_ni);
                     onu_disable_ind->set_onu_id(key->onu_id);
+                    if (onu->data.status == BCMOLT_RESULT_SUCCESS) {
+                        update_onu_state_cache(key->pon_ni, key->onu_id, BCMOLT_ONU_STATE_DISABLED);
+                    } else {
+                        invalidate_onu_state_cache(key->pon_ni, key->onu_id);
+                    }
                     serial_number->set_vendor_id(reinterpret_cast<const char *>(in_serial_number->vendor_id.arr), 4);
                     serial_number->set_vendor_specific(reinterpret_cast<const char *>(in_serial_number->vendor_specific.arr), 8);
                     onu_disable_ind->set_allocated_serial_number(serial_number);
@@ -372,7 +388,7 @@ static void OnuDisableIndication(bcmolt_devid olt, bcmolt_msg *msg) {
             }
     }
 
-    oltIndQ.push(ind);
+    oltIndQ.push(std::move(ind));
     bcmolt_msg_free(msg);
 }
 
@@ -397,6 +413,8 @@ static void OnuEnableIndication(bcmolt_devid olt, bcmolt_msg *msg) {
 
                     onu_enable_ind->set_intf_id(key->pon_ni);
                     onu_enable_ind->set_onu_id(key->onu_id);
+                    // the ONU is activated again, its state is reported by the activation
+                    invalidate_onu_state_cache(key->pon_ni, key->onu_id);
                     serial_number->set_vendor_id(reinterpret_cast<const char *>(in_serial_number->vendor_id.arr), 4);
                     serial_number->set_vendor_specific(reinterpret_cast<const char *>(in_serial_number->vendor_specific.arr), 8);
                     onu_enable_ind->set_allocated_serial_number(serial_number);
@@ -407,7 +425,7 @@ static void OnuEnableIndication(bcmolt_devid olt, bcmolt_msg *msg) {
             }
     }
 
-    oltIndQ.push(ind);
+    oltIndQ.push(std::move(ind));
     bcmolt_msg_free(msg);
 }
 
@@ -454,7 +472,7 @@ static void OnuAlarmIndication(bcmolt_devid olt, bcmolt_msg *msg) {
         }
     }
 
-    oltIndQ.push(ind);
+    oltIndQ.push(std::move(ind));
     bcmolt_msg_free(msg);
 }
 
@@ -487,7 +505,7 @@ static void OnuDyingGaspIndication(bcmolt_devid olt, bcmolt_msg *msg) {
             }
     }
 
-    oltIndQ.push(ind);
+    oltIndQ.push(std::move(ind));
     bcmolt_msg_free(msg);
 }
 
@@ -515,8 +533,26 @@ static void OnuDiscoveryIndication(bcmolt_devid olt, bcmolt_msg *msg) {
 
                     bcmolt_serial_number *in_serial_number = &(data->serial_number);
 
+                    std::string serial_number_str = serial_number_to_str(in_serial_number);
+                    onu_sn_key sn = get_onu_sn_key(reinterpret_cast<const char *>(in_serial_number->vendor_id.arr),
+                        reinterpret_cast<const char *>(in_serial_number->vendor_specific.arr));
+                    if (onu_sn_index_discovered(key->pon_ni, sn)) {
+                        uint32_t pon_intf_id, onu_id;
+                        onu_sn_index_lookup(sn, &pon_intf_id, &onu_id);
+                        OPENOLT_LOG(WARNING, openolt_log_id, "duplicate serial number %s discovered on pon_ni %d, already active as onu_id %d on pon_ni %d\n",
+                            serial_number_str.c_str(), key->pon_ni, onu_id, pon_intf_id);
+                    }
+                    // An ONU that keeps ranging is only reported once per window
+                    if (onu_discovery_suppressed(key->pon_ni, sn)) {
+                        OPENOLT_LOG(DEBUG, openolt_log_id, "onu discover indication suppressed, pon_ni %d, serial_number %s\n",
+                            key->pon_ni, serial_number_str.c_str());
+                        delete onu_disc_ind;
+                        delete serial_number;
+                        bcmolt_msg_free(msg);
+                        return;
+                    }
                     OPENOLT_LOG(INFO, openolt_log_id, "onu discover indication, pon_ni %d, serial_number %s\n",
-                        key->pon_ni, serial_number_to_str(in_serial_number).c_str());
+                        key->pon_ni, serial_number_str.c_str());
 
                     onu_disc_ind->set_intf_id(key->pon_ni);
                     serial_number->set_vendor_id(reinterpret_cast<const char *>(in_serial_number->vendor_id.arr), 4);
@@ -528,7 +564,7 @@ static void OnuDiscoveryIndication(bcmolt_devid olt, bcmolt_msg *msg) {
         }
     }
 
-    oltIndQ.push(ind);
+    oltIndQ.push(std::move(ind));
     bcmolt_msg_free(msg);
 }
 
@@ -557,7 +593,7 @@ static void OmciIndication(bcmolt_devid olt, bcmolt_msg *msg) {
         }
     }
 
-    oltIndQ.push(ind);
+    omciIndQ.push(std::move(ind));
     bcmolt_msg_free(msg);
 }
 
@@ -617,7 +653,7 @@ static void PacketIndication(bcmolt_devid olt, bcmolt_msg *msg) {
             }
     }
 
-    oltIndQ.push(ind);
+    pktIndQ.push(std::move(ind));
     bcmolt_msg_free(msg);
 }
 
@@ -816,7 +852,7 @@ static void OnuStartupFailureIndication(bcmolt_devid olt, bcmolt_msg *msg) {
             }
     }
 
-    oltIndQ.push(ind);
+    oltIndQ.push(std::move(ind));
     bcmolt_msg_free(msg);
 }
 
@@ -835,6 +871,7 @@ static void OnuSignalDegradeIndication(bcmolt_devid olt, bcmolt_msg *msg) {
 
                     OPENOLT_LOG(WARNING, openolt_log_id, "onu signal degrade indication, intf_id %d, onu_id %d, alarm %d, BER %d\n",
                         key->pon_ni, key->onu_id, data->alarm_status, data->ber);
+                    set_onu_bal_signal_degrade(key->pon_ni, key->onu_id, data->alarm_status == BCMOLT_STATUS_ON);
 
                     sdi_ind->set_intf_id(key->pon_ni);
                     sdi_ind->set_onu_id(key->onu_id);
@@ -847,7 +884,7 @@ static void OnuSignalDegradeIndication(bcmolt_devid olt, bcmolt_msg *msg) {
             }
     }
 
-    oltIndQ.push(ind);
+    oltIndQ.push(std::move(ind));
     bcmolt_msg_free(msg);
 }
 
@@ -879,7 +916,7 @@ static void OnuDriftOfWindowIndication(bcmolt_devid olt, bcmolt_msg *msg) {
             }
     }
 
-    oltIndQ.push(ind);
+    oltIndQ.push(std::move(ind));
     bcmolt_msg_free(msg);
 }
 
@@ -909,7 +946,7 @@ static void OnuLossOfOmciChannelIndication(bcmolt_devid olt, bcmolt_msg *msg) {
             }
     }
 
-    oltIndQ.push(ind);
+    oltIndQ.push(std::move(ind));
     bcmolt_msg_free(msg);
 }
 
@@ -940,7 +977,7 @@ static void OnuSignalsFailureIndication(bcmolt_devid olt, bcmolt_msg *msg) {
             }
     }
 
-    oltIndQ.push(ind);
+    oltIndQ.push(std::move(ind));
     bcmolt_msg_free(msg);
 }
 
@@ -971,7 +1008,7 @@ static void OnuTransmissionInterferenceWarningIndication(bcmolt_devid olt, bcmol
             }
     }
 
-    oltIndQ.push(ind);
+    oltIndQ.push(std::move(ind));
     bcmolt_msg_free(msg);
 }
 
@@ -989,6 +1026,11 @@ static void OnuActivationCompletedIndication(bcmolt_devid olt, bcmolt_msg *msg)
 
                     onu_ind->set_intf_id(key->pon_ni);
                     onu_ind->set_onu_id(key->onu_id);
+                    if (ONU_ACTIVATION_COMPLETED_SUCCESS(data->status)) {
+                        update_onu_state_cache(key->pon_ni, key->onu_id, BCMOLT_ONU_STATE_ACTIVE);
+                    } else {
+                        invalidate_onu_state_cache(key->pon_ni, key->onu_id);
+                    }
                     if (ONU_ACTIVATION_COMPLETED_SUCCESS(data->status))
                         onu_ind->set_oper_state("up");
                     if (ONU_ACTIVATION_COMPLETED_FAIL(data->status))
@@ -1024,7 +1066,7 @@ static void OnuActivationCompletedIndication(bcmolt_devid olt, bcmolt_msg *msg)
             }
     }
 
-    oltIndQ.push(ind);
+    oltIndQ.push(std::move(ind));
     bcmolt_msg_free(msg);
 }
 
@@ -1054,7 +1096,7 @@ static void OnuLossOfKeySyncFailureIndication(bcmolt_devid olt, bcmolt_msg *msg)
             }
     }
 
-    oltIndQ.push(ind);
+    oltIndQ.push(std::move(ind));
     bcmolt_msg_free(msg);
 }
 
@@ -1105,7 +1147,7 @@ static void OnuItuPonStatsAlarmRaisedIndication(bcmolt_devid olt, bcmolt_msg *ms
             }
     }
 
-    oltIndQ.push(ind);
+    oltIndQ.push(std::move(ind));
     bcmolt_msg_free(msg);
 }
 
@@ -1158,7 +1200,7 @@ static void OnuItuPonStatsAlarmClearedIndication(bcmolt_devid olt, bcmolt_msg *m
             }
     }
 
-    oltIndQ.push(ind);
+    oltIndQ.push(std::move(ind));
     bcmolt_msg_free(msg);
 }
 
@@ -1184,6 +1226,11 @@ static void OnuDeactivationCompletedIndication(bcmolt_devid olt, bcmolt_msg *msg
                     onu_ind_data->set_onu_id(key->onu_id);
                     onu_ind_data->set_oper_state("down");
                     onu_ind_data->set_admin_state("down");
+                    if (data->status == BCMOLT_RESULT_SUCCESS) {
+                        update_onu_state_cache(key->pon_ni, key->onu_id, BCMOLT_ONU_STATE_INACTIVE);
+                    } else {
+                        invalidate_onu_state_cache(key->pon_ni, key->onu_id);
+                    }
                     onu_ind.set_allocated_onu_ind(onu_ind_data);
 
                     onu_deact_compltd_key onu_key((uint32_t)key->pon_ni, (uint32_t) key->onu_id);
@@ -1216,7 +1263,7 @@ static void OnuDeactivationCompletedIndication(bcmolt_devid olt, bcmolt_msg *msg
             }
     }
 
-    oltIndQ.push(onu_ind);
+    oltIndQ.push(std::move(onu_ind));
     bcmolt_msg_free(msg);
 }
 
@@ -1298,7 +1345,7 @@ bcmos_errno OnuProcessingErrorIndication(bcmbal_obj *obj) {
     alarm_ind->set_allocated_onu_processing_error_ind(onu_proc_error_ind);
     ind.set_allocated_alarm_ind(alarm_ind);
 
-    oltIndQ.push(ind);
+    oltIndQ.push(std::move(ind));
     return BCM_ERR_OK;
 }
 */
@@ -1325,6 +1372,85 @@ static void GroupIndication(bcmolt_devid olt, bcmolt_msg *msg) {
     bcmolt_msg_free(msg);
 }
 
+/* Port statistics, interface oper state and ONU oper state only matter in
+   their latest value, a newer one supersedes any still queued for the same
+   object. Everything else (OMCI, packet-in, alarms, ...) is an event and is
+   never conflated. */
+bool indication_conflation_key(const openolt::Indication& ind, indication_key* key) {
+    switch (ind.data_case()) {
+        case openolt::Indication::kPortStats:
+            *key = indication_key(ind.data_case(), ind.port_stats().intf_id());
+            return true;
+        case openolt::Indication::kIntfOperInd:
+            *key = indication_key(ind.data_case(),
+                ((uint64_t)(ind.intf_oper_ind().type() == "nni") << 32) | ind.intf_oper_ind().intf_id());
+            return true;
+        case openolt::Indication::kOnuInd:
+            *key = indication_key(ind.data_case(),
+                ((uint64_t)ind.onu_ind().intf_id() << 32) | ind.onu_ind().onu_id());
+            return true;
+        default:
+            return false;
+    }
+}
+
+/* On reconciliation the adapter learns the PON and ONU oper state from one
+   walk over BAL streamed as indications, instead of a GetOnuInfo per ONU.
+   The indications are queued a page at a time, so the walk keeps pace with
+   the stream and live indications are not held back behind it. Returns the
+   number of ONU indications queued. */
+uint32_t ReplayIndications(int32_t pon_filter) {
+    uint32_t num_onus = 0;
+    uint32_t page = 0;
+
+    for (uint32_t intf_id = 0; intf_id < num_of_pon_ports && state.is_connected(); intf_id++) {
+        if (pon_filter >= 0 && intf_id != (uint32_t)pon_filter) {
+            continue;
+        }
+
+        bcmolt_interface_state intf_state;
+        bcmolt_status los_status;
+        if (get_pon_interface_status((bcmolt_interface)intf_id, &intf_state, &los_status) != BCM_ERR_OK) {
+            continue;
+        }
+        openolt::Indication intf_ind;
+        openolt::IntfOperIndication* intf_oper_ind = new openolt::IntfOperIndication;
+        intf_oper_ind->set_intf_id(intf_id);
+        intf_oper_ind->set_type(bcmolt_to_grpc_intf_type(BCMOLT_INTERFACE_TYPE_PON));
+        SET_OPER_STATE(intf_oper_ind, intf_state);
+        intf_ind.set_allocated_intf_oper_ind(intf_oper_ind);
+        oltIndQ.push(std::move(intf_ind));
+        if (!INTERFACE_STATE_IF_UP(intf_state)) {
+            continue;
+        }
+
+        for (int onu_id = ONU_ID_START; onu_id <= ONU_ID_END; onu_id++) {
+            bcmolt_onu_state onu_state;
+            if (get_onu_state((bcmolt_interface)intf_id, onu_id, &onu_state) != BCM_ERR_OK ||
+                onu_state == BCMOLT_ONU_STATE_NOT_CONFIGURED) {
+                continue;
+            }
+            openolt::Indication ind;
+            openolt::OnuIndication* onu_ind = new openolt::OnuIndication;
+            onu_ind->set_intf_id(intf_id);
+            onu_ind->set_onu_id(onu_id);
+            onu_ind->set_oper_state(onu_state == BCMOLT_ONU_STATE_ACTIVE ? "up" : "down");
+            onu_ind->set_admin_state(onu_state == BCMOLT_ONU_STATE_DISABLED ? "down" : "up");
+            ind.set_allocated_onu_ind(onu_ind);
+            oltIndQ.push(std::move(ind));
+            num_onus++;
+
+            if (++page == RECONCILE_PAGE_SIZE) {
+                page = 0;
+                while (oltIndQ.size() > RECONCILE_PAGE_SIZE && state.is_connected()) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                }
+            }
+        }
+    }
+    return num_onus;
+}
+
 Status SubscribeIndication() {
     bcmolt_rx_cfg rx_cfg = {};
     bcmos_errno rc;
@@ -19,13 +19,21 @@
 #include <grpc++/grpc++.h>
 #include <voltha_protos/openolt.grpc.pb.h>
 #include "Queue.h"
+#include "ConflatingQueue.h"
 
 extern "C" {
     #include <bcm_dev_log_task.h>
 }
 
-extern Queue<openolt::Indication> oltIndQ;
+// Conflation key of a state-like indication, (indication type, object key)
+typedef std::pair<int, uint64_t> indication_key;
+extern bool indication_conflation_key(const openolt::Indication& ind, indication_key* key);
+
+extern ConflatingQueue<openolt::Indication, indication_key> oltIndQ;
+extern Queue<openolt::Indication> omciIndQ;
+extern Queue<openolt::Indication> pktIndQ;
 extern grpc::Status SubscribeIndication();
+extern uint32_t ReplayIndications(int32_t pon_filter);
 extern dev_log_id openolt_log_id;
 extern dev_log_id omci_log_id;
 
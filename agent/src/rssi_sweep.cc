@@ -0,0 +1,220 @@
+/*
+ * Copyright 2018-present Open Networking Foundation
+
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rssi_sweep.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "core_utils.h"
+#include "translation.h"
+
+static const std::chrono::milliseconds ONU_RSSI_COMPLETE_WAIT_TIMEOUT = std::chrono::seconds(10);
+
+typedef struct {
+    onu_rssi_complete_result result;
+    time_t timestamp;
+} onu_rx_power_entry;
+
+static std::map<onu_rssi_compltd_key, onu_rx_power_entry> onu_rx_power_cache;
+static std::mutex onu_rx_power_cache_lock;
+// one measurement at a time per PON
+static std::mutex onu_rssi_measure_lock[MAX_SUPPORTED_PON];
+
+static std::mutex rssi_sweep_lock;
+static std::condition_variable rssi_sweep_cond;
+static bool rssi_sweep_running = false;
+static std::thread rssi_sweep_thread;
+
+bcmos_errno measure_onu_rx_power(uint32_t intf_id, uint32_t onu_id, onu_rssi_complete_result* result) {
+    bcmos_errno err = BCM_ERR_OK;
+    bcmolt_onu_rssi_measurement onu_oper; /* declare main API struct */
+    bcmolt_onu_key onu_key; /**< Object key. */
+    onu_rssi_compltd_key key(intf_id, onu_id);
+    Queue<onu_rssi_complete_result> queue;
+
+    if (intf_id >= MAX_SUPPORTED_PON) {
+        return BCM_ERR_PARM;
+    }
+    std::lock_guard<std::mutex> measure_lock(onu_rssi_measure_lock[intf_id]);
+
+    onu_key.onu_id = onu_id;
+    onu_key.pon_ni = intf_id;
+    /* Initialize the API struct. */
+    BCMOLT_OPER_INIT(&onu_oper, onu, rssi_measurement, onu_key);
+    err = bcmolt_oper_submit(dev_id, &onu_oper.hdr);
+    if (err != BCM_ERR_OK) {
+        OPENOLT_LOG(ERROR, openolt_log_id, "failed to measure rssi rx power - intf_id: %d, onu_id: %d, err = %s (%d): %s\n",
+            intf_id, onu_id, bcmos_strerror(err), err, onu_oper.hdr.hdr.err_text);
+        return err;
+    }
+    // initialize map
+    bcmos_fastlock_lock(&onu_rssi_wait_lock);
+    onu_rssi_compltd_map.insert({key, &queue});
+    bcmos_fastlock_unlock(&onu_rssi_wait_lock, 0);
+
+    if (!queue.pop(*result, ONU_RSSI_COMPLETE_WAIT_TIMEOUT)) {
+        err = BCM_ERR_TIMEOUT;
+        OPENOLT_LOG(ERROR, openolt_log_id, "timeout waiting for RSSI Measurement Completed indication intf_id %d, onu_id %d\n",
+                    intf_id, onu_id);
+    } else {
+        OPENOLT_LOG(INFO, openolt_log_id, "RSSI Rx power - intf_id: %d, onu_id: %d, status: %s, fail_reason: %d, rx_power_mean_dbm: %f\n",
+            result->pon_intf_id, result->onu_id, result->status.c_str(), result->reason, result->rx_power_mean_dbm);
+        if (result->status == bcmolt_result_to_string(BCMOLT_RESULT_SUCCESS)) {
+            update_onu_rx_power_cache(*result, time(NULL));
+        }
+    }
+
+    // Remove entry from map
+    bcmos_fastlock_lock(&onu_rssi_wait_lock);
+    onu_rssi_compltd_map.erase(key);
+    bcmos_fastlock_unlock(&onu_rssi_wait_lock, 0);
+
+    return err;
+}
+
+void update_onu_rx_power_cache(const onu_rssi_complete_result& result, time_t timestamp) {
+    onu_rx_power_entry entry;
+    entry.result = result;
+    entry.timestamp = timestamp;
+
+    std::lock_guard<std::mutex> lock(onu_rx_power_cache_lock);
+    onu_rx_power_cache[onu_rssi_compltd_key(result.pon_intf_id, result.onu_id)] = entry;
+}
+
+void invalidate_onu_rx_power_cache(uint32_t intf_id, uint32_t onu_id) {
+    std::lock_guard<std::mutex> lock(onu_rx_power_cache_lock);
+    onu_rx_power_cache.erase(onu_rssi_compltd_key(intf_id, onu_id));
+}
+
+static bool onu_rx_power_fresh(const onu_rx_power_entry& entry, time_t now) {
+    return rssi_sweep_interval > 0 && now - entry.timestamp <= (time_t)rssi_sweep_interval;
+}
+
+bool get_cached_onu_rx_power(uint32_t intf_id, uint32_t onu_id, onu_rssi_complete_result* result) {
+    time_t now = time(NULL);
+
+    std::lock_guard<std::mutex> lock(onu_rx_power_cache_lock);
+    std::map<onu_rssi_compltd_key, onu_rx_power_entry>::const_iterator it =
+        onu_rx_power_cache.find(onu_rssi_compltd_key(intf_id, onu_id));
+    if (it == onu_rx_power_cache.end() || !onu_rx_power_fresh(it->second, now)) {
+        return false;
+    }
+    *result = it->second.result;
+    return true;
+}
+
+uint32_t get_cached_pon_rx_power(uint32_t intf_id, std::vector<onu_rssi_complete_result>* results) {
+    uint32_t num_onus = 0;
+    time_t now = time(NULL);
+
+    std::lock_guard<std::mutex> lock(onu_rx_power_cache_lock);
+    std::map<onu_rssi_compltd_key, onu_rx_power_entry>::const_iterator it =
+        onu_rx_power_cache.lower_bound(onu_rssi_compltd_key(intf_id, 0));
+    for (; it != onu_rx_power_cache.end() && std::get<0>(it->first) == intf_id; ++it) {
+        if (onu_rx_power_fresh(it->second, now)) {
+            results->push_back(it->second.result);
+            num_onus++;
+        }
+    }
+    return num_onus;
+}
+
+static bool rssi_sweep_is_running() {
+    std::lock_guard<std::mutex> lock(rssi_sweep_lock);
+    return rssi_sweep_running;
+}
+
+/* Measures the rx power of the active ONUs of a PON one after the other.
+   Returns the number of ONUs measured. */
+uint32_t sweep_pon_rx_power(uint32_t intf_id) {
+    uint32_t num_onus = 0;
+    double min_dbm = 0.0;
+    double max_dbm = 0.0;
+
+    for (uint32_t onu_id = ONU_ID_START; onu_id <= ONU_ID_END && rssi_sweep_is_running(); onu_id++) {
+        bcmolt_onu_state onu_state;
+        if (get_onu_state((bcmolt_interface)intf_id, onu_id, &onu_state) != BCM_ERR_OK ||
+            onu_state != BCMOLT_ONU_STATE_ACTIVE) {
+            invalidate_onu_rx_power_cache(intf_id, onu_id);
+            continue;
+        }
+        onu_rssi_complete_result result{};
+        if (measure_onu_rx_power(intf_id, onu_id, &result) != BCM_ERR_OK ||
+            result.status != bcmolt_result_to_string(BCMOLT_RESULT_SUCCESS)) {
+            continue;
+        }
+        if (num_onus == 0 || result.rx_power_mean_dbm < min_dbm) {
+            min_dbm = result.rx_power_mean_dbm;
+        }
+        if (num_onus == 0 || result.rx_power_mean_dbm > max_dbm) {
+            max_dbm = result.rx_power_mean_dbm;
+        }
+        num_onus++;
+    }
+    if (num_onus > 0) {
+        OPENOLT_LOG(INFO, openolt_log_id, "Measured rx power of %u ONUs on PON %u, from %f to %f dBm\n",
+            num_onus, intf_id, min_dbm, max_dbm);
+    }
+    return num_onus;
+}
+
+static void rssi_sweep_loop() {
+    while (true) {
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+        if (state.is_activated()) {
+            std::vector<std::thread> pon_sweeps;
+            for (uint32_t i = 0; i < NumPonIf_(); i++) {
+                pon_sweeps.push_back(std::thread(sweep_pon_rx_power, i));
+            }
+            for (std::vector<std::thread>::iterator it = pon_sweeps.begin(); it != pon_sweeps.end(); ++it) {
+                it->join();
+            }
+            OPENOLT_LOG(DEBUG, openolt_log_id, "Swept rx power of %u PONs in %ld ms\n", NumPonIf_(),
+                (long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count());
+        }
+
+        std::unique_lock<std::mutex> lock(rssi_sweep_lock);
+        rssi_sweep_cond.wait_until(lock, begin + std::chrono::seconds(rssi_sweep_interval), []() { return !rssi_sweep_running; });
+        if (!rssi_sweep_running) {
+            break;
+        }
+    }
+}
+
+void start_rssi_sweep() {
+    std::lock_guard<std::mutex> lock(rssi_sweep_lock);
+    if (rssi_sweep_running || rssi_sweep_interval == 0) {
+        return;
+    }
+    rssi_sweep_running = true;
+    rssi_sweep_thread = std::thread(rssi_sweep_loop);
+}
+
+void stop_rssi_sweep() {
+    {
+        std::lock_guard<std::mutex> lock(rssi_sweep_lock);
+        if (!rssi_sweep_running) {
+            return;
+        }
+        rssi_sweep_running = false;
+    }
+    rssi_sweep_cond.notify_all();
+    rssi_sweep_thread.join();
+}
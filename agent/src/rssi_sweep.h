@@ -0,0 +1,44 @@
+/*
+ * Copyright 2018-present Open Networking Foundation
+
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OPENOLT_RSSI_SWEEP_H_
+#define OPENOLT_RSSI_SWEEP_H_
+
+#include <vector>
+
+#include "core.h"
+#include "core_data.h"
+
+/* The rx power of the active ONUs is measured in the background every
+   rssi_sweep_interval seconds. The PONs are swept in parallel, the ONUs of a
+   PON one at a time since the MAC measures one ONU of a PON at a time. The
+   measurements are cached, GetPonRxPower returns them while they are not older
+   than the interval. */
+
+/* Measures the rx power of an ONU, waiting for the RSSI measurement completed
+   indication. The measurements of a PON are serialized. */
+bcmos_errno measure_onu_rx_power(uint32_t intf_id, uint32_t onu_id, onu_rssi_complete_result* result);
+uint32_t sweep_pon_rx_power(uint32_t intf_id);
+void start_rssi_sweep();
+void stop_rssi_sweep();
+
+void update_onu_rx_power_cache(const onu_rssi_complete_result& result, time_t timestamp);
+void invalidate_onu_rx_power_cache(uint32_t intf_id, uint32_t onu_id);
+bool get_cached_onu_rx_power(uint32_t intf_id, uint32_t onu_id, onu_rssi_complete_result* result);
+/* Appends the cached measurements of the ONUs of a PON and returns the number appended */
+uint32_t get_cached_pon_rx_power(uint32_t intf_id, std::vector<onu_rssi_complete_result>* results);
+
+#endif
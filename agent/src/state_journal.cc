@@ -0,0 +1,618 @@
+/*
+ * Copyright 2018-present Open Networking Foundation
+
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "state_journal.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "core_utils.h"
+
+/* A record is a line "<checksum of the payload, 8 hex digits> <payload>\n".
+   The journal file is zero filled past the last record, so the replay stops at
+   the first zero byte or at the first record with a wrong checksum, which is
+   where a torn write would be.
+
+   Both the snapshot and the journal start with a "gen" record. A compaction
+   writes the snapshot with the next generation before it empties the journal,
+   so a journal of another generation than the snapshot is already part of it. */
+
+static std::mutex journal_lock;
+static std::condition_variable journal_cond;
+static std::atomic<bool> journal_open(false);
+static int journal_fd = -1;
+static char *journal_base = NULL;
+static size_t journal_offset = 0;      // end of the last record
+static size_t journal_synced = 0;      // journal_offset at the last msync
+static uint32_t journal_compactions = 0;
+static bool journal_full = false;
+static bool journal_compacting = false;
+static std::string journal_pending;    // records appended while compacting
+static uint64_t journal_gen = 0;
+static std::string journal_snapshot_file;
+static bool journal_running = false;
+static std::thread journal_sync_thread;
+// serializes the compactions of the sync thread with the ones of the callers
+static std::mutex compact_lock;
+
+static uint32_t record_checksum(const char *data, size_t len) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static std::string make_record(const std::string& payload) {
+    char checksum[10];
+    snprintf(checksum, sizeof(checksum), "%08x ", record_checksum(payload.data(), payload.size()));
+    return checksum + payload + "\n";
+}
+
+/* Returns the length of the record at data, or 0 if there is no valid record */
+static size_t parse_record(const char *data, size_t avail, std::string *payload) {
+    if (avail == 0 || data[0] == '\0') {
+        return 0;
+    }
+    const char *end = (const char *)memchr(data, '\n', avail);
+    if (end == NULL || end - data < 9 || data[8] != ' ') {
+        return 0;
+    }
+    char checksum[9];
+    char *checksum_end;
+    memcpy(checksum, data, 8);
+    checksum[8] = '\0';
+    unsigned long expected = strtoul(checksum, &checksum_end, 16);
+    if (checksum_end != checksum + 8) {
+        return 0;
+    }
+    payload->assign(data + 9, end - data - 9);
+    if (record_checksum(payload->data(), payload->size()) != expected) {
+        return 0;
+    }
+    return end - data + 1;
+}
+
+static std::string sched_record(const sched_map_key_tuple& key) {
+    std::ostringstream r;
+    r << std::get<0>(key) << " " << std::get<1>(key) << " " << std::get<2>(key) << " " << std::get<3>(key) << " " << std::get<4>(key);
+    return r.str();
+}
+
+static std::string qmp_record(int tm_qmp_id, const std::vector<uint32_t>& tmq_map_profile) {
+    std::ostringstream r;
+    r << tm_qmp_id;
+    for (uint32_t i = 0; i < TMQ_MAP_PROFILE_SIZE; i++) {
+        r << " " << tmq_map_profile[i];
+    }
+    return r.str();
+}
+
+static std::string sched_qmp_record(const sched_qmp_id_map_key_tuple& key) {
+    std::ostringstream r;
+    r << std::get<0>(key) << " " << std::get<1>(key) << " " << std::get<2>(key) << " " << std::get<3>(key);
+    return r.str();
+}
+
+static std::string gem_record(const pon_gem& pg) {
+    std::ostringstream r;
+    r << std::get<0>(pg) << " " << std::get<1>(pg);
+    return r.str();
+}
+
+static std::string onu_uni_record(const onu_uni& ou) {
+    std::ostringstream r;
+    r << std::get<0>(ou) << " " << std::get<1>(ou);
+    return r.str();
+}
+
+static std::string symmetric_flow_record(const symmetric_datapath_flow_id_map_key& key) {
+    std::ostringstream r;
+    r << std::get<0>(key) << " " << std::get<1>(key) << " " << std::get<2>(key) << " " << std::get<3>(key) << " " << std::get<4>(key);
+    return r.str();
+}
+
+/* Only the params of the replicated flows are relevant, params[0] otherwise */
+static std::string voltha_flow_record(uint64_t voltha_flow_id, const device_flow& dev_flow) {
+    std::ostringstream r;
+    int num_params = dev_flow.is_flow_replicated ? dev_flow.total_replicated_flows : 1;
+    r << voltha_flow_id << " " << dev_flow.symmetric_voltha_flow_id << " " << dev_flow.flow_type
+      << " " << (dev_flow.is_flow_replicated ? 1 : 0) << " " << (uint32_t)dev_flow.total_replicated_flows << " " << num_params;
+    for (int i = 0; i < num_params; i++) {
+        r << " " << dev_flow.params[i].flow_id << " " << dev_flow.params[i].gemport_id << " " << (uint32_t)dev_flow.params[i].pbit;
+    }
+    return r.str();
+}
+
+/* The maps are restored before the gRPC server is started, so nothing else
+   accesses them yet. */
+static bool apply_record(const std::string& payload, uint64_t *gen) {
+    std::istringstream in(payload);
+    std::string op;
+    uint32_t pon, onu, uni, tp, sched_id, gem;
+    int32_t spon, sonu, suni;
+    int id;
+    uint64_t voltha_flow_id;
+    std::string direction;
+
+    in >> op;
+    if (op == "gen") {
+        in >> *gen;
+    } else if (op == "sched") {
+        in >> pon >> onu >> uni >> direction >> tp >> id;
+        sched_map[sched_map_key_tuple(pon, onu, uni, direction, tp)] = id;
+    } else if (op == "-sched") {
+        in >> pon >> onu >> uni >> direction >> tp;
+        sched_map.erase(sched_map_key_tuple(pon, onu, uni, direction, tp));
+    } else if (op == "qmp") {
+        std::vector<uint32_t> tmq_map_profile(TMQ_MAP_PROFILE_SIZE, 0);
+        in >> id;
+        for (uint32_t i = 0; i < TMQ_MAP_PROFILE_SIZE; i++) {
+            in >> tmq_map_profile[i];
+        }
+        qmp_id_to_qmp_map[id] = tmq_map_profile;
+    } else if (op == "-qmp") {
+        in >> id;
+        qmp_id_to_qmp_map.erase(id);
+    } else if (op == "schedqmp") {
+        in >> sched_id >> pon >> onu >> uni >> id;
+        sched_qmp_id_map[sched_qmp_id_map_key_tuple(sched_id, pon, onu, uni)] = id;
+    } else if (op == "-schedqmp") {
+        in >> sched_id >> pon >> onu >> uni;
+        sched_qmp_id_map.erase(sched_qmp_id_map_key_tuple(sched_id, pon, onu, uni));
+    } else if (op == "gem") {
+        in >> pon >> gem >> onu >> uni;
+        pon_gem_to_onu_uni_map[pon_gem(pon, gem)] = onu_uni(onu, uni);
+    } else if (op == "-gem") {
+        in >> pon >> gem;
+        pon_gem_to_onu_uni_map.erase(pon_gem(pon, gem));
+    } else if (op == "symflow") {
+        in >> spon >> sonu >> suni >> tp >> direction >> voltha_flow_id;
+        symmetric_datapath_flow_id_map[symmetric_datapath_flow_id_map_key(spon, sonu, suni, tp, direction)] = voltha_flow_id;
+    } else if (op == "-symflow") {
+        in >> spon >> sonu >> suni >> tp >> direction;
+        symmetric_datapath_flow_id_map.erase(symmetric_datapath_flow_id_map_key(spon, sonu, suni, tp, direction));
+    } else if (op == "vflow") {
+        device_flow dev_fl = device_flow();
+        uint32_t replicated, total, num_params;
+        in >> voltha_flow_id >> dev_fl.symmetric_voltha_flow_id >> dev_fl.flow_type >> replicated >> total >> num_params;
+        if (in.fail() || num_params > MAX_NUMBER_OF_REPLICATED_FLOWS) {
+            return false;
+        }
+        dev_fl.voltha_flow_id = voltha_flow_id;
+        dev_fl.is_flow_replicated = replicated;
+        dev_fl.total_replicated_flows = total;
+        for (uint32_t i = 0; i < num_params; i++) {
+            uint32_t flow_id, pbit;
+            in >> flow_id >> dev_fl.params[i].gemport_id >> pbit;
+            dev_fl.params[i].flow_id = flow_id;
+            dev_fl.params[i].pbit = pbit;
+        }
+        if (in.fail()) {
+            return false;
+        }
+        voltha_flow_to_device_flow[voltha_flow_id] = dev_fl;
+    } else if (op == "-vflow") {
+        in >> voltha_flow_id;
+        voltha_flow_to_device_flow.erase(voltha_flow_id);
+    } else {
+        return false;
+    }
+    return !in.fail();
+}
+
+/* Applies the records in data, returns the length of the valid ones */
+static size_t replay_records(const char *data, size_t len, uint64_t *gen, uint32_t *num_records) {
+    size_t offset = 0;
+    std::string payload;
+
+    for (;;) {
+        size_t record_len = parse_record(data + offset, len - offset, &payload);
+        if (record_len == 0 || !apply_record(payload, gen)) {
+            break;
+        }
+        offset += record_len;
+        (*num_records)++;
+    }
+    return offset;
+}
+
+/* The IDs referenced by the restored maps are taken again. Flow IDs are
+   allocated before the flow is cached, the ones of a FlowAdd that did not
+   complete are found by rebuild_state_from_bal(). */
+static void restore_allocators() {
+    bcmos_fastlock_lock(&tm_sched_bitset_lock);
+    for (auto it = sched_map.begin(); it != sched_map.end(); ++it) {
+        if (it->second >= 0 && it->second < MAX_TM_SCHED_ID) {
+            tm_sched_bitset[it->second] = 1;
+        }
+    }
+    bcmos_fastlock_unlock(&tm_sched_bitset_lock, 0);
+
+    bcmos_fastlock_lock(&tm_qmp_bitset_lock);
+    for (auto it = qmp_id_to_qmp_map.begin(); it != qmp_id_to_qmp_map.end(); ++it) {
+        if (it->first >= 0 && it->first < MAX_TM_QMP_ID) {
+            tm_qmp_bitset[it->first] = 1;
+        }
+    }
+    bcmos_fastlock_unlock(&tm_qmp_bitset_lock, 0);
+
+    bcmos_fastlock_lock(&flow_id_bitset_lock);
+    for (auto it = voltha_flow_to_device_flow.begin(); it != voltha_flow_to_device_flow.end(); ++it) {
+        int num_params = it->second.is_flow_replicated ? it->second.total_replicated_flows : 1;
+        for (int i = 0; i < num_params; i++) {
+            if (it->second.params[i].flow_id < MAX_FLOW_ID) {
+                flow_id_bitset[it->second.params[i].flow_id] = 1;
+            }
+        }
+    }
+    bcmos_fastlock_unlock(&flow_id_bitset_lock, 0);
+}
+
+static std::string snapshot_records() {
+    std::string records;
+
+    bcmos_fastlock_lock(&tm_sched_bitset_lock);
+    for (auto it = sched_map.begin(); it != sched_map.end(); ++it) {
+        records += make_record("sched " + sched_record(it->first) + " " + std::to_string(it->second));
+    }
+    bcmos_fastlock_unlock(&tm_sched_bitset_lock, 0);
+
+    bcmos_fastlock_lock(&tm_qmp_bitset_lock);
+    for (auto it = qmp_id_to_qmp_map.begin(); it != qmp_id_to_qmp_map.end(); ++it) {
+        records += make_record("qmp " + qmp_record(it->first, it->second));
+    }
+    for (auto it = sched_qmp_id_map.begin(); it != sched_qmp_id_map.end(); ++it) {
+        records += make_record("schedqmp " + sched_qmp_record(it->first) + " " + std::to_string(it->second));
+    }
+    bcmos_fastlock_unlock(&tm_qmp_bitset_lock, 0);
+
+    bcmos_fastlock_lock(&pon_gem_to_onu_uni_map_lock);
+    for (auto it = pon_gem_to_onu_uni_map.begin(); it != pon_gem_to_onu_uni_map.end(); ++it) {
+        records += make_record("gem " + gem_record(it->first) + " " + onu_uni_record(it->second));
+    }
+    bcmos_fastlock_unlock(&pon_gem_to_onu_uni_map_lock, 0);
+
+    bcmos_fastlock_lock(&symmetric_datapath_flow_id_lock);
+    for (auto it = symmetric_datapath_flow_id_map.begin(); it != symmetric_datapath_flow_id_map.end(); ++it) {
+        records += make_record("symflow " + symmetric_flow_record(it->first) + " " + std::to_string(it->second));
+    }
+    bcmos_fastlock_unlock(&symmetric_datapath_flow_id_lock, 0);
+
+    bcmos_fastlock_lock(&voltha_flow_to_device_flow_lock);
+    for (auto it = voltha_flow_to_device_flow.begin(); it != voltha_flow_to_device_flow.end(); ++it) {
+        records += make_record("vflow " + voltha_flow_record(it->first, it->second));
+    }
+    bcmos_fastlock_unlock(&voltha_flow_to_device_flow_lock, 0);
+
+    return records;
+}
+
+/* The snapshot replaces the previous one only once it is completely on disk */
+static bool write_snapshot(const std::string& file_name, const std::string& content) {
+    std::string tmp_file_name = file_name + ".tmp";
+    int fd = open(tmp_file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    size_t written = 0;
+    while (written < content.size()) {
+        ssize_t n = write(fd, content.data() + written, content.size() - written);
+        if (n <= 0) {
+            close(fd);
+            std::remove(tmp_file_name.c_str());
+            return false;
+        }
+        written += n;
+    }
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    if (!ok || std::rename(tmp_file_name.c_str(), file_name.c_str()) != 0) {
+        std::remove(tmp_file_name.c_str());
+        return false;
+    }
+    return true;
+}
+
+static void sync_journal(size_t from, size_t to) {
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    size_t start = from & ~(page_size - 1);
+    msync(journal_base + start, to - start, MS_SYNC);
+}
+
+/* journal_lock must be held */
+static void write_journal_record(const std::string& record) {
+    memcpy(journal_base + journal_offset, record.data(), record.size());
+    journal_offset += record.size();
+}
+
+static void journal_sync_loop() {
+    std::unique_lock<std::mutex> lock(journal_lock);
+
+    while (journal_running) {
+        journal_cond.wait_for(lock, std::chrono::milliseconds(STATE_JOURNAL_SYNC_INTERVAL));
+        size_t from = journal_synced;
+        size_t to = journal_offset;
+        uint32_t compactions = journal_compactions;
+        bool compact = journal_full || journal_offset > STATE_JOURNAL_SIZE / 2;
+
+        // the records are only appended past journal_offset meanwhile
+        lock.unlock();
+        if (to > from) {
+            sync_journal(from, to);
+        }
+        if (compact) {
+            state_journal_compact();
+        }
+        lock.lock();
+        if (compactions == journal_compactions) {
+            journal_synced = to;
+        }
+    }
+}
+
+static void journal_append(const std::string& payload) {
+    if (!journal_open) {
+        return;
+    }
+    std::string record = make_record(payload);
+
+    std::lock_guard<std::mutex> lock(journal_lock);
+    if (journal_base == NULL) {
+        return;
+    }
+    if (journal_compacting) {
+        journal_pending += record;
+    }
+    if (journal_offset + record.size() > STATE_JOURNAL_SIZE) {
+        // the change is in the snapshot of the compaction that is due
+        if (!journal_full) {
+            OPENOLT_LOG(WARNING, openolt_log_id, "State journal is full, waiting for compaction\n");
+        }
+        journal_full = true;
+        journal_cond.notify_one();
+        return;
+    }
+    write_journal_record(record);
+    if (journal_offset > STATE_JOURNAL_SIZE / 2) {
+        journal_cond.notify_one();
+    }
+}
+
+static bool restore_state(const std::string& snapshot_file, uint64_t *gen, uint32_t *num_records) {
+    std::ifstream in(snapshot_file.c_str(), std::ios::binary);
+
+    *gen = 0;
+    if (!in.is_open()) {
+        // nothing was compacted yet
+        return true;
+    }
+    std::string snapshot((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (replay_records(snapshot.data(), snapshot.size(), gen, num_records) != snapshot.size()) {
+        OPENOLT_LOG(ERROR, openolt_log_id, "State snapshot %s is corrupted, not restoring it\n", snapshot_file.c_str());
+        sched_map.clear();
+        qmp_id_to_qmp_map.clear();
+        sched_qmp_id_map.clear();
+        pon_gem_to_onu_uni_map.clear();
+        symmetric_datapath_flow_id_map.clear();
+        voltha_flow_to_device_flow.clear();
+        std::remove(snapshot_file.c_str());
+        *gen = 0;
+        return false;
+    }
+    return true;
+}
+
+/* journal_lock must be held */
+static void reset_journal(uint64_t gen) {
+    memset(journal_base, 0, journal_offset);
+    journal_offset = 0;
+    write_journal_record(make_record("gen " + std::to_string(gen)));
+    journal_gen = gen;
+}
+
+bool state_journal_open(const std::string& snapshot_file, const std::string& journal_file, bool restore) {
+    auto start = std::chrono::steady_clock::now();
+    uint64_t snapshot_gen = 0;
+    uint32_t num_records = 0;
+    bool restored = false;
+
+    state_journal_close();
+
+    if (restore) {
+        restored = restore_state(snapshot_file, &snapshot_gen, &num_records);
+    } else {
+        std::remove(snapshot_file.c_str());
+    }
+
+    int fd = open(journal_file.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        OPENOLT_LOG(ERROR, openolt_log_id, "Failed to open state journal %s\n", journal_file.c_str());
+        return false;
+    }
+    // a cold start drops the records, the file is zero filled again
+    if ((!restore && ftruncate(fd, 0) != 0) || ftruncate(fd, STATE_JOURNAL_SIZE) != 0) {
+        OPENOLT_LOG(ERROR, openolt_log_id, "Failed to size state journal %s\n", journal_file.c_str());
+        close(fd);
+        return false;
+    }
+    char *base = (char *)mmap(NULL, STATE_JOURNAL_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        OPENOLT_LOG(ERROR, openolt_log_id, "Failed to map state journal %s\n", journal_file.c_str());
+        close(fd);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(journal_lock);
+    journal_fd = fd;
+    journal_base = base;
+    journal_snapshot_file = snapshot_file;
+    journal_offset = 0;
+    journal_full = false;
+    journal_compacting = false;
+    journal_pending.clear();
+
+    uint64_t gen = snapshot_gen;
+    std::string payload;
+    size_t header_len = parse_record(journal_base, STATE_JOURNAL_SIZE, &payload);
+    if (restored && header_len > 0 && payload.compare(0, 4, "gen ") == 0 && apply_record(payload, &gen) && gen == snapshot_gen) {
+        journal_offset = header_len + replay_records(journal_base + header_len, STATE_JOURNAL_SIZE - header_len, &gen, &num_records);
+        // drop what is left of a torn record
+        memset(journal_base + journal_offset, 0, STATE_JOURNAL_SIZE - journal_offset);
+    } else {
+        // the journal is empty, or older than the snapshot and part of it
+        journal_offset = STATE_JOURNAL_SIZE;
+        reset_journal(snapshot_gen);
+    }
+    journal_gen = snapshot_gen;
+    msync(journal_base, STATE_JOURNAL_SIZE, MS_SYNC);
+    journal_synced = journal_offset;
+
+    if (restored) {
+        restore_allocators();
+        OPENOLT_LOG(INFO, openolt_log_id, "Restored state from %u journal records in %ld ms, %lu voltha flows, %lu schedulers, %lu gem ports\n",
+            num_records, (long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count(),
+            voltha_flow_to_device_flow.size(), sched_map.size(), pon_gem_to_onu_uni_map.size());
+    }
+
+    journal_running = true;
+    journal_sync_thread = std::thread(journal_sync_loop);
+    journal_open = true;
+    return !restore || restored;
+}
+
+void state_journal_close() {
+    std::unique_lock<std::mutex> lock(journal_lock);
+    if (journal_base == NULL) {
+        return;
+    }
+    journal_open = false;
+    journal_running = false;
+    lock.unlock();
+    journal_cond.notify_one();
+    journal_sync_thread.join();
+
+    lock.lock();
+    msync(journal_base, STATE_JOURNAL_SIZE, MS_SYNC);
+    munmap(journal_base, STATE_JOURNAL_SIZE);
+    close(journal_fd);
+    journal_base = NULL;
+    journal_fd = -1;
+}
+
+bool state_journal_is_open() {
+    return journal_open;
+}
+
+bool state_journal_compact() {
+    std::lock_guard<std::mutex> compact(compact_lock);
+    std::unique_lock<std::mutex> lock(journal_lock);
+    if (journal_base == NULL) {
+        return false;
+    }
+    uint64_t gen = journal_gen + 1;
+    std::string snapshot_file = journal_snapshot_file;
+    journal_compacting = true;
+    journal_pending.clear();
+    lock.unlock();
+
+    // the map locks are not taken with journal_lock held, the records are appended with them held
+    std::string snapshot = make_record("gen " + std::to_string(gen)) + snapshot_records();
+    bool ok = write_snapshot(snapshot_file, snapshot);
+
+    lock.lock();
+    journal_compacting = false;
+    if (!ok) {
+        OPENOLT_LOG(ERROR, openolt_log_id, "Failed to write state snapshot %s\n", snapshot_file.c_str());
+        journal_pending.clear();
+        return false;
+    }
+    // The records appended since the maps were read may be missing in the snapshot
+    size_t old_offset = journal_offset;
+    reset_journal(gen);
+    if (journal_offset + journal_pending.size() <= STATE_JOURNAL_SIZE) {
+        write_journal_record(journal_pending);
+        journal_full = false;
+    }
+    journal_pending.clear();
+    msync(journal_base, std::max(old_offset, journal_offset), MS_SYNC);
+    journal_synced = journal_offset;
+    journal_compactions++;
+    return true;
+}
+
+void state_journal_sched_set(const sched_map_key_tuple& key, int sched_id) {
+    journal_append("sched " + sched_record(key) + " " + std::to_string(sched_id));
+}
+
+void state_journal_sched_erase(const sched_map_key_tuple& key) {
+    journal_append("-sched " + sched_record(key));
+}
+
+void state_journal_qmp_set(int tm_qmp_id, const std::vector<uint32_t>& tmq_map_profile) {
+    journal_append("qmp " + qmp_record(tm_qmp_id, tmq_map_profile));
+}
+
+void state_journal_qmp_erase(int tm_qmp_id) {
+    journal_append("-qmp " + std::to_string(tm_qmp_id));
+}
+
+void state_journal_sched_qmp_set(const sched_qmp_id_map_key_tuple& key, int tm_qmp_id) {
+    journal_append("schedqmp " + sched_qmp_record(key) + " " + std::to_string(tm_qmp_id));
+}
+
+void state_journal_sched_qmp_erase(const sched_qmp_id_map_key_tuple& key) {
+    journal_append("-schedqmp " + sched_qmp_record(key));
+}
+
+void state_journal_gem_set(const pon_gem& pg, const onu_uni& ou) {
+    journal_append("gem " + gem_record(pg) + " " + onu_uni_record(ou));
+}
+
+void state_journal_gem_erase(const pon_gem& pg) {
+    journal_append("-gem " + gem_record(pg));
+}
+
+void state_journal_symmetric_flow_set(const symmetric_datapath_flow_id_map_key& key, uint64_t voltha_flow_id) {
+    journal_append("symflow " + symmetric_flow_record(key) + " " + std::to_string(voltha_flow_id));
+}
+
+void state_journal_symmetric_flow_erase(const symmetric_datapath_flow_id_map_key& key) {
+    journal_append("-symflow " + symmetric_flow_record(key));
+}
+
+void state_journal_voltha_flow_set(uint64_t voltha_flow_id, const device_flow& dev_flow) {
+    journal_append("vflow " + voltha_flow_record(voltha_flow_id, dev_flow));
+}
+
+void state_journal_voltha_flow_erase(uint64_t voltha_flow_id) {
+    journal_append("-vflow " + std::to_string(voltha_flow_id));
+}
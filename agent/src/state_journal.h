@@ -0,0 +1,57 @@
+/*
+ * Copyright 2018-present Open Networking Foundation
+
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OPENOLT_STATE_JOURNAL_H_
+#define OPENOLT_STATE_JOURNAL_H_
+
+#include <string>
+#include <vector>
+
+#include "core.h"
+#include "core_data.h"
+
+/* The journal keeps the agent state that is not stored in BAL (the maps keyed
+   by UNI, tech profile and VOLTHA flow IDs) across an agent restart. Every
+   change is appended to a memory mapped journal file, which is synced to disk
+   every STATE_JOURNAL_SYNC_INTERVAL and compacted into a snapshot file once
+   half full.
+
+   The records are absolute (set or erase a key), so replaying them is
+   idempotent. They are appended while the lock of the changed map is held, so
+   the records of a key are in the same order as the changes. */
+
+/* Opens the journal. With restore the maps are loaded from the snapshot and
+   the journal, otherwise the state of a previous run is discarded. */
+bool state_journal_open(const std::string& snapshot_file, const std::string& journal_file, bool restore);
+void state_journal_close();
+bool state_journal_is_open();
+/* Writes all the journalled maps into a new snapshot and empties the journal */
+bool state_journal_compact();
+
+void state_journal_sched_set(const sched_map_key_tuple& key, int sched_id);
+void state_journal_sched_erase(const sched_map_key_tuple& key);
+void state_journal_qmp_set(int tm_qmp_id, const std::vector<uint32_t>& tmq_map_profile);
+void state_journal_qmp_erase(int tm_qmp_id);
+void state_journal_sched_qmp_set(const sched_qmp_id_map_key_tuple& key, int tm_qmp_id);
+void state_journal_sched_qmp_erase(const sched_qmp_id_map_key_tuple& key);
+void state_journal_gem_set(const pon_gem& pg, const onu_uni& ou);
+void state_journal_gem_erase(const pon_gem& pg);
+void state_journal_symmetric_flow_set(const symmetric_datapath_flow_id_map_key& key, uint64_t voltha_flow_id);
+void state_journal_symmetric_flow_erase(const symmetric_datapath_flow_id_map_key& key);
+void state_journal_voltha_flow_set(uint64_t voltha_flow_id, const device_flow& dev_flow);
+void state_journal_voltha_flow_erase(uint64_t voltha_flow_id);
+
+#endif
@@ -17,11 +17,19 @@
 #include "stats_collection.h"
 
 #include <unistd.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 #include "indications.h"
 #include "core.h"
 #include "core_data.h"
 #include "translation.h"
+#include "core_utils.h"
+#include "stats_history.h"
+#include "threshold_alarms.h"
+#include "gem_top_talkers.h"
 
 extern "C"
 {
@@ -30,15 +38,51 @@ extern "C"
 #include <bcmolt_api_model_api_structs.h>
 }
 
-//FIXME
-#define FLOWS_COUNT 100
 #define ALLOC_STATS_GET_INTERVAL 10
 
-bcmolt_flow_key* flows_keys = new bcmolt_flow_key[FLOWS_COUNT];
 bcmolt_odid device_id = 0;
 
+static pon_onu_stats onu_stats_cache[MAX_SUPPORTED_PON];
+static std::mutex onu_stats_cache_lock;
+
+/* Counters of the GEM ports collected by the statistics sweep, with the ONU and UNI
+   of the GEM port at the time of the sweep */
+typedef struct {
+    uint32_t onu_id;
+    uint32_t uni_id;
+    uint64_t rx_packets;
+    uint64_t rx_bytes;
+    uint64_t tx_packets;
+    uint64_t tx_bytes;
+    time_t timestamp;
+} gem_stats_entry;
+
+static std::map<pon_gem, gem_stats_entry> gem_stats_cache;
+static std::mutex gem_stats_cache_lock;
+
+/* Counters of the BAL flows read by the statistics collection */
+typedef struct {
+    uint64_t rx_packets;
+    uint64_t rx_bytes;
+    uint64_t tx_packets;
+    uint64_t tx_bytes;
+    time_t timestamp;
+} flow_stats_entry;
+
+static std::map<flow_pair, flow_stats_entry> flow_stats_cache;
+// VOLTHA flow after which the next flows are read, so that all the flows are read in turn
+static uint64_t flow_stats_cursor = 0;
+static std::mutex flow_stats_cache_lock;
+
+static std::mutex stats_sweep_lock;
+static std::condition_variable stats_sweep_cond;
+static bool stats_sweep_running = false;
+static std::thread stats_sweep_thread;
+
 void init_stats() {
-    memset(flows_keys, 0, FLOWS_COUNT * sizeof(bcmolt_flow_key));
+    std::lock_guard<std::mutex> lock(flow_stats_cache_lock);
+    flow_stats_cache.clear();
+    flow_stats_cursor = 0;
 }
 
 common::PortStatistics* get_default_port_statistics() {
@@ -161,19 +205,6 @@ openolt::OnuAllocIdStatistics get_default_alloc_statistics() {
     return alloc_stats;
 }
 
-#if 0
-openolt::FlowStatistics* get_default_flow_statistics() {
-    openolt::FlowStatistics* flow_stats = new openolt::FlowStatistics;
-    flow_stats->set_flow_id(-1);
-    flow_stats->set_rx_bytes(-1);
-    flow_stats->set_rx_packets(-1);
-    flow_stats->set_tx_bytes(-1);
-    flow_stats->set_tx_packets(-1);
-
-    return flow_stats;
-}
-#endif
-
 common::PortStatistics* collectPortStatistics(bcmolt_intf_ref intf_ref) {
 
     common::PortStatistics* port_stats = get_default_port_statistics();
@@ -606,6 +637,161 @@ bcmos_errno get_onu_statistics(bcmolt_interface_id intf_id, bcmolt_onu_id onu_id
     return err;
 }
 
+static bool valid_onu_stats_index(uint32_t intf_id, uint32_t onu_id) {
+    return intf_id < MAX_SUPPORTED_PON && onu_id >= ONU_ID_START && onu_id <= ONU_ID_END;
+}
+
+void update_onu_stats_cache(const openolt::OnuStatistics& onu_stats) {
+    uint32_t intf_id = onu_stats.intf_id();
+    uint32_t onu_id = onu_stats.onu_id();
+
+    if (!valid_onu_stats_index(intf_id, onu_id)) {
+        return;
+    }
+    pon_onu_stats& pon_stats = onu_stats_cache[intf_id];
+    int i = onu_id - ONU_ID_START;
+
+    std::lock_guard<std::mutex> lock(onu_stats_cache_lock);
+#define ONU_STATS_STORE(name) pon_stats.name[i] = onu_stats.name();
+    ONU_ITU_PON_STATS(ONU_STATS_STORE)
+#undef ONU_STATS_STORE
+    pon_stats.timestamp[i] = onu_stats.timestamp();
+}
+
+void invalidate_onu_stats_cache(uint32_t intf_id, uint32_t onu_id) {
+    if (!valid_onu_stats_index(intf_id, onu_id)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(onu_stats_cache_lock);
+    onu_stats_cache[intf_id].timestamp[onu_id - ONU_ID_START] = 0;
+}
+
+/* Returns the counters of the last sweep, unless they are older than two sweep intervals */
+bool get_cached_onu_statistics(uint32_t intf_id, uint32_t onu_id, openolt::OnuStatistics* onu_stats) {
+    if (!valid_onu_stats_index(intf_id, onu_id)) {
+        return false;
+    }
+    const pon_onu_stats& pon_stats = onu_stats_cache[intf_id];
+    int i = onu_id - ONU_ID_START;
+    time_t now;
+    time(&now);
+
+    std::lock_guard<std::mutex> lock(onu_stats_cache_lock);
+    if (pon_stats.timestamp[i] == 0 || now - pon_stats.timestamp[i] > 2 * STATS_SWEEP_INTERVAL) {
+        return false;
+    }
+#define ONU_STATS_LOAD(name) onu_stats->set_##name(pon_stats.name[i]);
+    ONU_ITU_PON_STATS(ONU_STATS_LOAD)
+#undef ONU_STATS_LOAD
+    onu_stats->set_intf_id(intf_id);
+    onu_stats->set_onu_id(onu_id);
+    onu_stats->set_timestamp(pon_stats.timestamp[i]);
+    return true;
+}
+
+/* Copies the counters of all the ONUs of a PON */
+bool get_onu_stats_snapshot(uint32_t intf_id, pon_onu_stats* snapshot) {
+    if (intf_id >= MAX_SUPPORTED_PON) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(onu_stats_cache_lock);
+    memcpy(snapshot, &onu_stats_cache[intf_id], sizeof(pon_onu_stats));
+    return true;
+}
+
+/* Waits for the next BAL read of the sweep. Returns false when the sweep is stopped. */
+static bool stats_sweep_wait(std::chrono::steady_clock::time_point until) {
+    std::unique_lock<std::mutex> lock(stats_sweep_lock);
+    stats_sweep_cond.wait_until(lock, until, []() { return !stats_sweep_running; });
+    return stats_sweep_running;
+}
+
+/* Reads the counters of the active ONUs of a PON into the cache, at most
+   onu_stats_sweep_rate ONUs per second. Returns the number of ONUs read. */
+uint32_t sweep_onu_statistics(uint32_t intf_id) {
+    uint32_t num_onus = 0;
+    std::chrono::steady_clock::time_point next_read = std::chrono::steady_clock::now();
+
+    for (uint32_t onu_id = ONU_ID_START; onu_id <= ONU_ID_END; onu_id++) {
+        bcmolt_onu_state onu_state;
+        if (get_onu_state((bcmolt_interface)intf_id, onu_id, &onu_state) != BCM_ERR_OK ||
+            onu_state != BCMOLT_ONU_STATE_ACTIVE) {
+            invalidate_onu_stats_cache(intf_id, onu_id);
+            continue;
+        }
+        if (onu_stats_sweep_rate == 0 || !stats_sweep_wait(next_read)) {
+            break;
+        }
+        next_read += std::chrono::microseconds(1000000 / onu_stats_sweep_rate);
+
+        openolt::OnuStatistics onu_stats;
+        if (get_onu_statistics((bcmolt_interface_id)intf_id, (bcmolt_onu_id)onu_id, &onu_stats) == BCM_ERR_OK) {
+            update_onu_stats_cache(onu_stats);
+            uint64_t counters[STATS_HISTORY_NUM_COUNTERS];
+            counters[STATS_HISTORY_RX_BYTES] = onu_stats.rx_bytes();
+            counters[STATS_HISTORY_RX_PACKETS] = onu_stats.rx_packets();
+            counters[STATS_HISTORY_TX_BYTES] = onu_stats.tx_bytes();
+            counters[STATS_HISTORY_TX_PACKETS] = onu_stats.tx_packets();
+            counters[STATS_HISTORY_ERRORS] = onu_stats.bip_errors();
+            record_onu_stats_history(intf_id, onu_id, onu_stats.timestamp(), counters);
+            num_onus++;
+        } else {
+            invalidate_onu_stats_cache(intf_id, onu_id);
+        }
+    }
+    return num_onus;
+}
+
+static void stats_sweep_loop() {
+    static pon_onu_stats onu_stats_snapshot;
+
+    while (true) {
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+        if (state.is_activated() && onu_stats_sweep_rate > 0) {
+            uint32_t num_onus = 0;
+            for (uint32_t i = 0; i < NumPonIf_(); i++) {
+                num_onus += sweep_onu_statistics(i);
+                if (get_onu_stats_snapshot(i, &onu_stats_snapshot)) {
+                    evaluate_onu_thresholds(i, onu_stats_snapshot, time(NULL));
+                }
+            }
+            OPENOLT_LOG(DEBUG, openolt_log_id, "Swept statistics of %u ONUs in %ld ms\n", num_onus,
+                (long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count());
+        }
+        if (state.is_activated() && gem_stats_sweep_rate > 0) {
+            std::chrono::steady_clock::time_point gem_begin = std::chrono::steady_clock::now();
+            uint32_t num_gems = sweep_gem_statistics();
+            OPENOLT_LOG(DEBUG, openolt_log_id, "Swept statistics of %u GEM ports in %ld ms\n", num_gems,
+                (long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - gem_begin).count());
+        }
+        if (!stats_sweep_wait(begin + std::chrono::seconds(STATS_SWEEP_INTERVAL))) {
+            break;
+        }
+    }
+}
+
+void start_stats_sweep() {
+    std::lock_guard<std::mutex> lock(stats_sweep_lock);
+    if (stats_sweep_running) {
+        return;
+    }
+    stats_sweep_running = true;
+    stats_sweep_thread = std::thread(stats_sweep_loop);
+}
+
+void stop_stats_sweep() {
+    {
+        std::lock_guard<std::mutex> lock(stats_sweep_lock);
+        if (!stats_sweep_running) {
+            return;
+        }
+        stats_sweep_running = false;
+    }
+    stats_sweep_cond.notify_all();
+    stats_sweep_thread.join();
+}
+
 bcmos_errno get_gemport_statistics(bcmolt_interface_id intf_id, bcmolt_gem_port_id gemport_id, openolt::GemPortStatistics* gemport_stats) {
     bcmos_errno err = BCM_ERR_OK;
 
@@ -649,6 +835,117 @@ bcmos_errno get_gemport_statistics(bcmolt_interface_id intf_id, bcmolt_gem_port_
     return err;
 }
 
+void update_gem_stats_cache(uint32_t onu_id, uint32_t uni_id, const openolt::GemPortStatistics& gemport_stats) {
+    gem_stats_entry entry;
+    uint64_t bytes = 0;
+
+    entry.onu_id = onu_id;
+    entry.uni_id = uni_id;
+    entry.rx_packets = gemport_stats.rx_packets();
+    entry.rx_bytes = gemport_stats.rx_bytes();
+    entry.tx_packets = gemport_stats.tx_packets();
+    entry.tx_bytes = gemport_stats.tx_bytes();
+    entry.timestamp = gemport_stats.timestamp();
+
+    {
+        std::lock_guard<std::mutex> lock(gem_stats_cache_lock);
+        gem_stats_entry& cached = gem_stats_cache[pon_gem(gemport_stats.intf_id(), gemport_stats.gemport_id())];
+        // a GEM port given to another subscriber counts from its new counters
+        if (cached.timestamp != 0 && cached.onu_id == onu_id && cached.uni_id == uni_id) {
+            bytes = stats_history_delta(cached.rx_bytes, entry.rx_bytes) + stats_history_delta(cached.tx_bytes, entry.tx_bytes);
+        }
+        cached = entry;
+    }
+    gem_top_talkers_add(gemport_stats.intf_id(), gemport_stats.gemport_id(), onu_id, uni_id, bytes);
+}
+
+void invalidate_gem_stats_cache(uint32_t intf_id, uint32_t gemport_id) {
+    std::lock_guard<std::mutex> lock(gem_stats_cache_lock);
+    gem_stats_cache.erase(pon_gem(intf_id, gemport_id));
+}
+
+static bool gem_stats_fresh(const gem_stats_entry& entry, time_t now) {
+    return now - entry.timestamp <= 2 * STATS_SWEEP_INTERVAL;
+}
+
+static void set_gemport_statistics(uint32_t intf_id, uint32_t gemport_id, const gem_stats_entry& entry,
+    openolt::GemPortStatistics* gemport_stats) {
+    gemport_stats->set_intf_id(intf_id);
+    gemport_stats->set_gemport_id(gemport_id);
+    gemport_stats->set_rx_packets(entry.rx_packets);
+    gemport_stats->set_rx_bytes(entry.rx_bytes);
+    gemport_stats->set_tx_packets(entry.tx_packets);
+    gemport_stats->set_tx_bytes(entry.tx_bytes);
+    gemport_stats->set_timestamp(entry.timestamp);
+}
+
+/* Returns the counters of the last sweep, unless they are older than two sweep intervals */
+bool get_cached_gemport_statistics(uint32_t intf_id, uint32_t gemport_id, openolt::GemPortStatistics* gemport_stats) {
+    time_t now;
+    time(&now);
+
+    std::lock_guard<std::mutex> lock(gem_stats_cache_lock);
+    std::map<pon_gem, gem_stats_entry>::const_iterator it = gem_stats_cache.find(pon_gem(intf_id, gemport_id));
+    if (it == gem_stats_cache.end() || !gem_stats_fresh(it->second, now)) {
+        return false;
+    }
+    set_gemport_statistics(intf_id, gemport_id, it->second, gemport_stats);
+    return true;
+}
+
+/* Reads the counters of the GEM ports in pon_gem_to_onu_uni_map into the cache, at most
+   gem_stats_sweep_rate GEM ports per second, and drops the GEM ports that are gone.
+   Returns the number of GEM ports read. */
+uint32_t sweep_gem_statistics() {
+    uint32_t num_gems = 0;
+    std::vector<std::pair<pon_gem, onu_uni> > gems;
+    std::chrono::steady_clock::time_point next_read = std::chrono::steady_clock::now();
+
+    bcmos_fastlock_lock(&pon_gem_to_onu_uni_map_lock);
+    gems.assign(pon_gem_to_onu_uni_map.begin(), pon_gem_to_onu_uni_map.end());
+    bcmos_fastlock_unlock(&pon_gem_to_onu_uni_map_lock, 0);
+
+    {
+        // both are sorted by (PON, GEM port)
+        std::lock_guard<std::mutex> lock(gem_stats_cache_lock);
+        std::vector<std::pair<pon_gem, onu_uni> >::const_iterator g = gems.begin();
+        for (std::map<pon_gem, gem_stats_entry>::iterator it = gem_stats_cache.begin(); it != gem_stats_cache.end();) {
+            while (g != gems.end() && g->first < it->first) {
+                ++g;
+            }
+            if (g == gems.end() || g->first != it->first) {
+                it = gem_stats_cache.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    for (std::vector<std::pair<pon_gem, onu_uni> >::const_iterator g = gems.begin(); g != gems.end(); ++g) {
+        if (gem_stats_sweep_rate == 0 || !stats_sweep_wait(next_read)) {
+            break;
+        }
+        next_read += std::chrono::microseconds(1000000 / gem_stats_sweep_rate);
+
+        openolt::GemPortStatistics gemport_stats;
+        uint32_t intf_id = std::get<0>(g->first);
+        uint32_t gemport_id = std::get<1>(g->first);
+        if (get_gemport_statistics((bcmolt_interface_id)intf_id, (bcmolt_gem_port_id)gemport_id, &gemport_stats) == BCM_ERR_OK) {
+            update_gem_stats_cache(std::get<0>(g->second), std::get<1>(g->second), gemport_stats);
+            num_gems++;
+        } else {
+            invalidate_gem_stats_cache(intf_id, gemport_id);
+        }
+    }
+    if (gem_stats_sweep_rate != 0) {
+        gem_top_talkers_rotate();
+        for (uint32_t i = 0; i < NumPonIf_(); i++) {
+            log_gem_top_talkers(i);
+        }
+    }
+    return num_gems;
+}
+
 bcmos_errno set_collect_alloc_stats(bcmolt_interface_id intf_id, bcmolt_alloc_id alloc_id, bcmos_bool collect_stats) {
     bcmos_errno err = BCM_ERR_OK;
     bcmolt_itupon_alloc_cfg cfg;
@@ -717,45 +1014,161 @@ bcmos_errno get_alloc_statistics(bcmolt_interface_id intf_id, bcmolt_alloc_id al
     return err;
 }
 
-#if 0
-openolt::FlowStatistics* collectFlowStatistics(bcmbal_flow_id flow_id, bcmbal_flow_type flow_type) {
-
-    bcmos_errno err;
-    bcmbal_flow_stat stat;     /**< declare main API struct */
-    bcmbal_flow_key key = { }; /**< declare key */
-    bcmos_bool clear_on_read = false;
+bcmos_errno get_flow_statistics(uint16_t flow_id, bcmolt_flow_type flow_type, openolt::FlowStatistics* flow_stats) {
+    bcmos_errno err = BCM_ERR_OK;
 
-    openolt::FlowStatistics* flow_stats = get_default_flow_statistics();
-    //Key
+#ifndef TEST_MODE
+    bcmolt_stat_flags clear_on_read = BCMOLT_STAT_FLAGS_NONE;
+    bcmolt_flow_stats stats;
+    bcmolt_flow_key key;
     key.flow_id = flow_id;
     key.flow_type = flow_type;
 
-    /* init the API struct */
-    BCMBAL_STAT_INIT(&stat, flow, key);
-    BCMBAL_STAT_PROP_GET(&stat, flow, all_properties);
+    BCMOLT_STAT_INIT(&stats, flow, stats, key);
+    BCMOLT_MSG_FIELD_GET(&stats, rx_packets);
+    BCMOLT_MSG_FIELD_GET(&stats, rx_bytes);
+    BCMOLT_MSG_FIELD_GET(&stats, tx_packets);
+    BCMOLT_MSG_FIELD_GET(&stats, tx_bytes);
+
+    err = bcmolt_stat_get((bcmolt_oltid)device_id, &stats.hdr, clear_on_read);
+    if (err != BCM_ERR_OK) {
+        // the flows of the trap to host rules are ACLs, not BAL flows
+        OPENOLT_LOG(DEBUG, openolt_log_id, "Failed to retrieve flow statistics, flow_id %d, flow_type %d, err no: %d - %s\n",
+            (int)flow_id, (int)flow_type, err, bcmos_strerror(err));
+        return err;
+    }
+    flow_stats->set_rx_packets(stats.data.rx_packets);
+    flow_stats->set_rx_bytes(stats.data.rx_bytes);
+    flow_stats->set_tx_packets(stats.data.tx_packets);
+    flow_stats->set_tx_bytes(stats.data.tx_bytes);
+#endif
+
+    flow_stats->set_flow_id(flow_id);
+    time_t now;
+    time(&now);
+    flow_stats->set_timestamp((int)now);
+
+    return err;
+}
 
-    err = bcmbal_stat_get(DEFAULT_ATERM_ID, &stat.hdr, clear_on_read);
+/* Appends the next BAL flows to read, taking whole VOLTHA flows after the last one read
+   until the budget is used or all the flows are taken. Returns the number appended. */
+uint32_t next_flow_stats_batch(uint32_t budget, std::vector<flow_pair>* batch) {
+    uint32_t num_flows = 0;
+    uint64_t cursor;
 
-    if (err == BCM_ERR_OK)
     {
-        std::cout << "Flow statistics retrieved"
-                  << " flow_id:" << flow_id
-                  << " flow_type:" << flow_type << std::endl;
+        std::lock_guard<std::mutex> lock(flow_stats_cache_lock);
+        cursor = flow_stats_cursor;
+    }
+
+    bcmos_fastlock_lock(&voltha_flow_to_device_flow_lock);
+    std::map<uint64_t, device_flow>::const_iterator it = voltha_flow_to_device_flow.upper_bound(cursor);
+    for (size_t n = 0; n < voltha_flow_to_device_flow.size(); n++, ++it) {
+        if (it == voltha_flow_to_device_flow.end()) {
+            it = voltha_flow_to_device_flow.begin();
+        }
+        const device_flow& dev_fl = it->second;
+        uint32_t num_replicated = dev_fl.is_flow_replicated ? dev_fl.total_replicated_flows : 1;
+        if (num_flows + num_replicated > budget && num_replicated <= budget) {
+            break;
+        }
+        cursor = it->first;
+        if (num_replicated > budget) {
+            // never read rather than over the budget
+            continue;
+        }
+        // BAL 3.1 supports statistics only for unicast flows.
+        bcmolt_flow_type flow_type;
+        if (dev_fl.flow_type == upstream) {
+            flow_type = BCMOLT_FLOW_TYPE_UPSTREAM;
+        } else if (dev_fl.flow_type == downstream) {
+            flow_type = BCMOLT_FLOW_TYPE_DOWNSTREAM;
+        } else {
+            continue;
+        }
+        for (uint32_t i = 0; i < num_replicated; i++) {
+            batch->push_back(flow_pair(dev_fl.params[i].flow_id, flow_type));
+        }
+        num_flows += num_replicated;
+    }
+    bcmos_fastlock_unlock(&voltha_flow_to_device_flow_lock, 0);
 
-        flow_stats->set_rx_bytes(stat.data.rx_bytes);
-        flow_stats->set_rx_packets(stat.data.rx_packets);
-        flow_stats->set_tx_bytes(stat.data.tx_bytes);
-        flow_stats->set_tx_packets(stat.data.tx_packets);
+    std::lock_guard<std::mutex> lock(flow_stats_cache_lock);
+    flow_stats_cursor = cursor;
+    return num_flows;
+}
 
-    } else {
-        std::cout   << "ERROR: Failed to retrieve flow statistics"
-                    << " flow_id:" << flow_id
-                    << " flow_type:" << flow_type << std::endl;
+static void update_flow_stats_cache(bcmolt_flow_type flow_type, const openolt::FlowStatistics& flow_stats) {
+    flow_stats_entry entry;
+
+    entry.rx_packets = flow_stats.rx_packets();
+    entry.rx_bytes = flow_stats.rx_bytes();
+    entry.tx_packets = flow_stats.tx_packets();
+    entry.tx_bytes = flow_stats.tx_bytes();
+    entry.timestamp = flow_stats.timestamp();
+
+    std::lock_guard<std::mutex> lock(flow_stats_cache_lock);
+    flow_stats_cache[flow_pair(flow_stats.flow_id(), flow_type)] = entry;
+}
+
+void invalidate_flow_stats_cache(uint16_t flow_id, bcmolt_flow_type flow_type) {
+    std::lock_guard<std::mutex> lock(flow_stats_cache_lock);
+    flow_stats_cache.erase(flow_pair(flow_id, flow_type));
+}
+
+bool get_cached_flow_statistics(uint16_t flow_id, bcmolt_flow_type flow_type, openolt::FlowStatistics* flow_stats) {
+    std::lock_guard<std::mutex> lock(flow_stats_cache_lock);
+    std::map<flow_pair, flow_stats_entry>::const_iterator it = flow_stats_cache.find(flow_pair(flow_id, flow_type));
+    if (it == flow_stats_cache.end()) {
+        return false;
     }
+    flow_stats->set_flow_id(flow_id);
+    flow_stats->set_rx_packets(it->second.rx_packets);
+    flow_stats->set_rx_bytes(it->second.rx_bytes);
+    flow_stats->set_tx_packets(it->second.tx_packets);
+    flow_stats->set_tx_bytes(it->second.tx_bytes);
+    flow_stats->set_timestamp((int)it->second.timestamp);
+    return true;
+}
 
-    return flow_stats;
+/* Reads the counters of the next flow_stats_budget BAL flows and sends them to VOLTHA.
+   Returns the number of flows read. */
+uint32_t collect_flow_statistics() {
+    std::vector<flow_pair> batch;
+    uint32_t num_flows = 0;
+
+    next_flow_stats_batch(flow_stats_budget, &batch);
+    for (std::vector<flow_pair>::const_iterator it = batch.begin(); it != batch.end(); ++it) {
+        openolt::FlowStatistics* flow_stats = new openolt::FlowStatistics;
+        if (get_flow_statistics(it->first, (bcmolt_flow_type)it->second, flow_stats) != BCM_ERR_OK) {
+            invalidate_flow_stats_cache(it->first, (bcmolt_flow_type)it->second);
+            delete flow_stats;
+            continue;
+        }
+        update_flow_stats_cache((bcmolt_flow_type)it->second, *flow_stats);
+
+        ::openolt::Indication ind;
+        ind.set_allocated_flow_stats(flow_stats);
+        oltIndQ.push(std::move(ind));
+        num_flows++;
+    }
+    return num_flows;
+}
+
+static void record_port_history(bcmolt_intf_ref intf_ref, const common::PortStatistics* port_stats) {
+    // the counters that could not be read are left at -1
+    if (port_stats->rx_bytes() == (uint64_t)-1 || port_stats->tx_bytes() == (uint64_t)-1) {
+        return;
+    }
+    uint64_t counters[STATS_HISTORY_NUM_COUNTERS];
+    counters[STATS_HISTORY_RX_BYTES] = port_stats->rx_bytes();
+    counters[STATS_HISTORY_RX_PACKETS] = port_stats->rx_packets();
+    counters[STATS_HISTORY_TX_BYTES] = port_stats->tx_bytes();
+    counters[STATS_HISTORY_TX_PACKETS] = port_stats->tx_packets();
+    counters[STATS_HISTORY_ERRORS] = port_stats->rx_error_packets();
+    record_port_stats_history(intf_ref.intf_type, intf_ref.intf_id, port_stats->timestamp(), counters);
 }
-#endif
 
 void stats_collection() {
 
@@ -770,6 +1183,8 @@ void stats_collection() {
 
     OPENOLT_LOG(DEBUG, openolt_log_id, "Collecting statistics\n");
 
+    onu_discovery_summary();
+
     //Ports statistics
 
     //Uplink ports
@@ -780,10 +1195,11 @@ void stats_collection() {
 
         common::PortStatistics* port_stats =
             collectPortStatistics(intf_ref);
+        record_port_history(intf_ref, port_stats);
 
         ::openolt::Indication ind;
         ind.set_allocated_port_stats(port_stats);
-        oltIndQ.push(ind);
+        oltIndQ.push(std::move(ind));
     }
     //Pon ports
     for (int i = 0; i < NumPonIf_(); i++) {
@@ -793,52 +1209,29 @@ void stats_collection() {
 
         common::PortStatistics* port_stats =
             collectPortStatistics(intf_ref);
+        record_port_history(intf_ref, port_stats);
 
         ::openolt::Indication ind;
         ind.set_allocated_port_stats(port_stats);
-        oltIndQ.push(ind);
+        oltIndQ.push(std::move(ind));
+    }
+
+    // the rates change slowly, they are not logged with every collection
+    static time_t last_rates_log = 0;
+    time_t now = time(NULL);
+    if (now - last_rates_log >= STATS_RATES_LOG_PERIOD) {
+        last_rates_log = now;
+        for (int i = 0; i < NumNniIf_(); i++) {
+            log_port_stats_rates(BCMOLT_INTERFACE_TYPE_NNI, i);
+        }
+        for (int i = 0; i < NumPonIf_(); i++) {
+            log_port_stats_rates(BCMOLT_INTERFACE_TYPE_PON, i);
+        }
     }
 
     //Flows statistics
-    // flow_inst *current_entry = NULL;
-    //
-    // TAILQ_FOREACH(current_entry,
-    //               &FLOW_FSM_FLOW_LIST_CTX_PTR->active_flow_list,
-    //               flow_inst_next) {
-    // int flows_measurements = 0;
-    //
-    // for (int i = 0; i < FLOWS_COUNT; i++) {
-    //
-    //     // bcmbal_flow_id flow_id = current_entry->api_req_flow_info.key.flow_id;
-    //     // bcmbal_flow_type flow_type = current_entry->api_req_flow_info.key.flow_type;
-    //
-    //     if (flows_keys[i].flow_id != 0) {
-    //         openolt::FlowStatistics* flow_stats = collectFlowStatistics(flows_keys[i].flow_id, flows_keys[i].flow_type);
-    //         if (flow_stats->rx_packets() == -1) {
-    //             //It Failed
-    //             flows_keys[i].flow_id = 0;
-    //         } else {
-    //             flow_stats->set_flow_id(flows_keys[i].flow_id);
-    //             time(&now);
-    //             flow_stats->set_timestamp((int)now);
-    //             openolt::Indication ind;
-    //             ind.set_allocated_flow_stats(flow_stats);
-    //             oltIndQ.push(ind);
-    //             flows_measurements ++;
-    //         }
-    //     }
-    //
-    // }
-    // std::cout << "Stats of " << flows_measurements << " flows retrieved" << std::endl;
-
-}
-
-/* Storing flow keys, temporary */
-// void register_new_flow(bcmbal_flow_key key) {
-//     for (int i = 0; i < FLOWS_COUNT; i++) {
-//         if (flows_keys[i].flow_id == 0) {
-//             flows_keys[i] = key;
-//             break;
-//         }
-//     }
-// }
+    if (flow_stats_budget > 0) {
+        uint32_t num_flows = collect_flow_statistics();
+        OPENOLT_LOG(DEBUG, openolt_log_id, "Stats of %u flows retrieved\n", num_flows);
+    }
+}
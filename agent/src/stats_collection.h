@@ -17,27 +17,78 @@
 #ifndef OPENOLT_STATS_COLLECTION_H_
 #define OPENOLT_STATS_COLLECTION_H_
 
+#include <vector>
 #include <voltha_protos/openolt.grpc.pb.h>
 #include <voltha_protos/common.grpc.pb.h>
 
+#include "core.h"
+#include "core_data.h"
+
 extern "C"
 {
 #include <bcmolt_api_model_supporting_structs.h>
 }
 
+/* The ITU PON counters of an ONU, as named in openolt::OnuStatistics */
+#define ONU_ITU_PON_STATS(X) \
+    X(positive_drift) \
+    X(negative_drift) \
+    X(delimiter_miss_detection) \
+    X(bip_errors) \
+    X(bip_units) \
+    X(fec_corrected_symbols) \
+    X(fec_codewords_corrected) \
+    X(fec_codewords_uncorrectable) \
+    X(fec_codewords) \
+    X(fec_corrected_units) \
+    X(xgem_key_errors) \
+    X(xgem_loss) \
+    X(rx_ploams_error) \
+    X(rx_ploams_non_idle) \
+    X(rx_omci) \
+    X(rx_omci_packets_crc_error) \
+    X(rx_bytes) \
+    X(rx_packets) \
+    X(tx_bytes) \
+    X(tx_packets) \
+    X(ber_reported) \
+    X(lcdg_errors) \
+    X(rdi_errors)
+
+/* Counters of the ONUs of a PON collected by the ONU statistics sweep. There is one
+   array per counter, indexed by onu_id - ONU_ID_START, so a counter of all the ONUs
+   of a PON is contiguous. */
+typedef struct {
+#define ONU_STATS_ARRAY(name) uint64_t name[MAX_ONUS_PER_PON];
+    ONU_ITU_PON_STATS(ONU_STATS_ARRAY)
+#undef ONU_STATS_ARRAY
+    time_t timestamp[MAX_ONUS_PER_PON]; // 0 when no counters are collected for the ONU
+} pon_onu_stats;
+
 void init_stats();
 void stop_collecting_statistics();
 common::PortStatistics* get_default_port_statistics();
 common::PortStatistics* collectPortStatistics(bcmolt_interface_id intf_id, bcmolt_interface_type intf_type);
 bcmos_errno get_onu_statistics(bcmolt_interface_id intf_id, bcmolt_onu_id onu_id, openolt::OnuStatistics* onu_stats);
+void start_stats_sweep();
+void stop_stats_sweep();
+uint32_t sweep_onu_statistics(uint32_t intf_id);
+void update_onu_stats_cache(const openolt::OnuStatistics& onu_stats);
+void invalidate_onu_stats_cache(uint32_t intf_id, uint32_t onu_id);
+bool get_cached_onu_statistics(uint32_t intf_id, uint32_t onu_id, openolt::OnuStatistics* onu_stats);
+bool get_onu_stats_snapshot(uint32_t intf_id, pon_onu_stats* snapshot);
+uint32_t sweep_gem_statistics();
+void update_gem_stats_cache(uint32_t onu_id, uint32_t uni_id, const openolt::GemPortStatistics& gemport_stats);
+void invalidate_gem_stats_cache(uint32_t intf_id, uint32_t gemport_id);
+bool get_cached_gemport_statistics(uint32_t intf_id, uint32_t gemport_id, openolt::GemPortStatistics* gemport_stats);
 bcmos_errno get_gemport_statistics(bcmolt_interface_id intf_id, bcmolt_gem_port_id gemport_id, openolt::GemPortStatistics* gemport_stats);
 bcmos_errno get_port_statistics(bcmolt_intf_ref intf_ref, common::PortStatistics* port_stats);
 bcmos_errno get_alloc_statistics(bcmolt_interface_id intf_id, bcmolt_alloc_id alloc_id, openolt::OnuAllocIdStatistics* alloc_stats);
-#if 0
-openolt::FlowStatistics* get_default_flow_statistics();
-openolt::FlowStatistics* collectFlowStatistics(bcmbal_flow_id flow_id, bcmbal_flow_type flow_type);
-void register_new_flow(bcmbal_flow_key key);
-#endif
+bcmos_errno get_flow_statistics(uint16_t flow_id, bcmolt_flow_type flow_type, openolt::FlowStatistics* flow_stats);
+uint32_t next_flow_stats_batch(uint32_t budget, std::vector<flow_pair>* batch);
+uint32_t collect_flow_statistics();
+void invalidate_flow_stats_cache(uint16_t flow_id, bcmolt_flow_type flow_type);
+bool get_cached_flow_statistics(uint16_t flow_id, bcmolt_flow_type flow_type, openolt::FlowStatistics* flow_stats);
 
 
 #endif
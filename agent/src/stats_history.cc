@@ -0,0 +1,220 @@
+/*
+ * Copyright 2018-present Open Networking Foundation
+
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "stats_history.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+
+#include "core_data.h"
+
+typedef struct {
+    uint64_t last[STATS_HISTORY_NUM_COUNTERS]; // counters of the previous sample
+    time_t last_timestamp;                     // 0 until the counters are read once
+    double rate[STATS_HISTORY_NUM_COUNTERS];   // smoothed, per second
+    uint32_t head;                             // next sample to write
+    uint32_t count;
+    stats_history_sample samples[STATS_HISTORY_DEPTH];
+} stats_history_ring;
+
+static stats_history_ring pon_history[MAX_SUPPORTED_PON];
+static stats_history_ring nni_history[STATS_HISTORY_NNI_PORTS];
+static stats_history_ring onu_history[MAX_SUPPORTED_PON][MAX_ONUS_PER_PON];
+static std::mutex stats_history_lock;
+
+uint64_t stats_history_delta(uint64_t last, uint64_t current) {
+    if (current >= last || last - current > UINT64_MAX / 2) {
+        // modulo 2^64, so the wrap comes out right
+        return current - last;
+    }
+    return current;
+}
+
+static stats_history_ring* port_ring(bcmolt_interface_type intf_type, uint32_t intf_id) {
+    if (intf_type == BCMOLT_INTERFACE_TYPE_PON && intf_id < MAX_SUPPORTED_PON) {
+        return &pon_history[intf_id];
+    }
+    if (intf_type == BCMOLT_INTERFACE_TYPE_NNI && intf_id < STATS_HISTORY_NNI_PORTS) {
+        return &nni_history[intf_id];
+    }
+    return NULL;
+}
+
+static stats_history_ring* onu_ring(uint32_t intf_id, uint32_t onu_id) {
+    if (intf_id < MAX_SUPPORTED_PON && onu_id >= ONU_ID_START && onu_id <= ONU_ID_END) {
+        return &onu_history[intf_id][onu_id - ONU_ID_START];
+    }
+    return NULL;
+}
+
+/* The first reading of the counters only sets the base of the next sample */
+static void record_sample(stats_history_ring* ring, time_t timestamp, const uint64_t counters[STATS_HISTORY_NUM_COUNTERS]) {
+    std::lock_guard<std::mutex> lock(stats_history_lock);
+
+    if (ring->last_timestamp != 0 && timestamp > ring->last_timestamp) {
+        stats_history_sample& sample = ring->samples[ring->head];
+        sample.timestamp = timestamp;
+        sample.interval = timestamp - ring->last_timestamp;
+        for (int i = 0; i < STATS_HISTORY_NUM_COUNTERS; i++) {
+            sample.delta[i] = stats_history_delta(ring->last[i], counters[i]);
+            double rate = (double)sample.delta[i] / sample.interval;
+            ring->rate[i] = ring->count == 0 ? rate :
+                STATS_HISTORY_EWMA_ALPHA * rate + (1 - STATS_HISTORY_EWMA_ALPHA) * ring->rate[i];
+        }
+        ring->head = (ring->head + 1) % STATS_HISTORY_DEPTH;
+        if (ring->count < STATS_HISTORY_DEPTH) {
+            ring->count++;
+        }
+    } else if (ring->last_timestamp != 0) {
+        // the same reading again, or the clock went back
+        return;
+    }
+    for (int i = 0; i < STATS_HISTORY_NUM_COUNTERS; i++) {
+        ring->last[i] = counters[i];
+    }
+    ring->last_timestamp = timestamp;
+}
+
+static uint32_t get_samples(const stats_history_ring* ring, uint32_t num_samples, std::vector<stats_history_sample>* samples) {
+    std::lock_guard<std::mutex> lock(stats_history_lock);
+
+    if (num_samples > ring->count) {
+        num_samples = ring->count;
+    }
+    uint32_t index = (ring->head + STATS_HISTORY_DEPTH - num_samples) % STATS_HISTORY_DEPTH;
+    for (uint32_t i = 0; i < num_samples; i++) {
+        samples->push_back(ring->samples[index]);
+        index = (index + 1) % STATS_HISTORY_DEPTH;
+    }
+    return num_samples;
+}
+
+static bool get_rates(const stats_history_ring* ring, double rates[STATS_HISTORY_NUM_COUNTERS]) {
+    std::lock_guard<std::mutex> lock(stats_history_lock);
+
+    if (ring->count == 0) {
+        return false;
+    }
+    for (int i = 0; i < STATS_HISTORY_NUM_COUNTERS; i++) {
+        rates[i] = ring->rate[i];
+    }
+    return true;
+}
+
+void record_port_stats_history(bcmolt_interface_type intf_type, uint32_t intf_id, time_t timestamp,
+    const uint64_t counters[STATS_HISTORY_NUM_COUNTERS]) {
+    stats_history_ring* ring = port_ring(intf_type, intf_id);
+    if (ring != NULL) {
+        record_sample(ring, timestamp, counters);
+    }
+}
+
+void record_onu_stats_history(uint32_t intf_id, uint32_t onu_id, time_t timestamp,
+    const uint64_t counters[STATS_HISTORY_NUM_COUNTERS]) {
+    stats_history_ring* ring = onu_ring(intf_id, onu_id);
+    if (ring != NULL) {
+        record_sample(ring, timestamp, counters);
+    }
+}
+
+/* The ONU ID can be given to another ONU, whose counters are not a continuation */
+void clear_onu_stats_history(uint32_t intf_id, uint32_t onu_id) {
+    stats_history_ring* ring = onu_ring(intf_id, onu_id);
+    if (ring != NULL) {
+        std::lock_guard<std::mutex> lock(stats_history_lock);
+        ring->last_timestamp = 0;
+        ring->head = 0;
+        ring->count = 0;
+    }
+}
+
+uint32_t get_port_stats_history(bcmolt_interface_type intf_type, uint32_t intf_id, uint32_t num_samples,
+    std::vector<stats_history_sample>* samples) {
+    stats_history_ring* ring = port_ring(intf_type, intf_id);
+    return ring == NULL ? 0 : get_samples(ring, num_samples, samples);
+}
+
+uint32_t get_onu_stats_history(uint32_t intf_id, uint32_t onu_id, uint32_t num_samples,
+    std::vector<stats_history_sample>* samples) {
+    stats_history_ring* ring = onu_ring(intf_id, onu_id);
+    return ring == NULL ? 0 : get_samples(ring, num_samples, samples);
+}
+
+bool get_port_stats_rates(bcmolt_interface_type intf_type, uint32_t intf_id, double rates[STATS_HISTORY_NUM_COUNTERS]) {
+    stats_history_ring* ring = port_ring(intf_type, intf_id);
+    return ring != NULL && get_rates(ring, rates);
+}
+
+bool get_onu_stats_rates(uint32_t intf_id, uint32_t onu_id, double rates[STATS_HISTORY_NUM_COUNTERS]) {
+    stats_history_ring* ring = onu_ring(intf_id, onu_id);
+    return ring != NULL && get_rates(ring, rates);
+}
+
+/* The highest rate of a counter over the samples, per second */
+static double peak_rate(const std::vector<stats_history_sample>& samples, stats_history_counter counter) {
+    double peak = 0;
+    for (std::vector<stats_history_sample>::const_iterator it = samples.begin(); it != samples.end(); ++it) {
+        peak = std::max(peak, (double)it->delta[counter] / it->interval);
+    }
+    return peak;
+}
+
+static double bytes_to_mbps(double bytes_per_second) {
+    return bytes_per_second * 8 / 1000000;
+}
+
+bool log_port_stats_rates(bcmolt_interface_type intf_type, uint32_t intf_id) {
+    double rates[STATS_HISTORY_NUM_COUNTERS];
+    std::vector<stats_history_sample> samples;
+    char onu_str[128] = "";
+
+    if (!get_port_stats_rates(intf_type, intf_id, rates)) {
+        return false;
+    }
+    get_port_stats_history(intf_type, intf_id, STATS_HISTORY_DEPTH, &samples);
+
+    if (intf_type == BCMOLT_INTERFACE_TYPE_PON) {
+        uint32_t busiest_onu_id = 0;
+        double busiest_rates[STATS_HISTORY_NUM_COUNTERS] = {0};
+        double onu_rates[STATS_HISTORY_NUM_COUNTERS];
+        for (uint32_t onu_id = ONU_ID_START; onu_id <= ONU_ID_END; onu_id++) {
+            if (get_onu_stats_rates(intf_id, onu_id, onu_rates) && (busiest_onu_id == 0 ||
+                onu_rates[STATS_HISTORY_RX_BYTES] + onu_rates[STATS_HISTORY_TX_BYTES] >
+                busiest_rates[STATS_HISTORY_RX_BYTES] + busiest_rates[STATS_HISTORY_TX_BYTES])) {
+                busiest_onu_id = onu_id;
+                std::copy(onu_rates, onu_rates + STATS_HISTORY_NUM_COUNTERS, busiest_rates);
+            }
+        }
+        if (busiest_onu_id != 0) {
+            std::vector<stats_history_sample> onu_samples;
+            get_onu_stats_history(intf_id, busiest_onu_id, STATS_HISTORY_DEPTH, &onu_samples);
+            snprintf(onu_str, sizeof(onu_str), ", busiest onu_id %u: rx %.1f Mbps (peak %.1f), tx %.1f Mbps (peak %.1f)",
+                busiest_onu_id, bytes_to_mbps(busiest_rates[STATS_HISTORY_RX_BYTES]),
+                bytes_to_mbps(peak_rate(onu_samples, STATS_HISTORY_RX_BYTES)),
+                bytes_to_mbps(busiest_rates[STATS_HISTORY_TX_BYTES]),
+                bytes_to_mbps(peak_rate(onu_samples, STATS_HISTORY_TX_BYTES)));
+        }
+    }
+
+    OPENOLT_LOG(INFO, openolt_log_id, "%s %u rates: rx %.1f Mbps (peak %.1f), tx %.1f Mbps (peak %.1f), %.1f errors/s%s\n",
+        intf_type == BCMOLT_INTERFACE_TYPE_PON ? "PON" : "NNI", intf_id,
+        bytes_to_mbps(rates[STATS_HISTORY_RX_BYTES]), bytes_to_mbps(peak_rate(samples, STATS_HISTORY_RX_BYTES)),
+        bytes_to_mbps(rates[STATS_HISTORY_TX_BYTES]), bytes_to_mbps(peak_rate(samples, STATS_HISTORY_TX_BYTES)),
+        rates[STATS_HISTORY_ERRORS], onu_str);
+    return true;
+}
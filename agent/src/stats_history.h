@@ -0,0 +1,71 @@
+/*
+ * Copyright 2018-present Open Networking Foundation
+
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OPENOLT_STATS_HISTORY_H_
+#define OPENOLT_STATS_HISTORY_H_
+
+#include <vector>
+
+#include "core.h"
+
+/* The history keeps the last STATS_HISTORY_DEPTH samples of the PON and NNI
+   ports and of the ONUs, in a ring per port and ONU allocated once for the
+   maximum number of ports and ONUs. A sample holds the increase of the
+   counters since the previous one, the rate of each counter is smoothed with
+   an exponentially weighted moving average. */
+
+enum stats_history_counter {
+    STATS_HISTORY_RX_BYTES,
+    STATS_HISTORY_RX_PACKETS,
+    STATS_HISTORY_TX_BYTES,
+    STATS_HISTORY_TX_PACKETS,
+    STATS_HISTORY_ERRORS, // rx_error_packets of a port, bip_errors of an ONU
+    STATS_HISTORY_NUM_COUNTERS
+};
+
+typedef struct {
+    time_t timestamp;
+    uint32_t interval; // in seconds since the previous sample
+    uint64_t delta[STATS_HISTORY_NUM_COUNTERS];
+} stats_history_sample;
+
+/* Returns the increase of a counter from last to current. A current value below
+   the last one is a wrap of the 64-bit counter when the last value was in the upper
+   half of the range, otherwise the counter was reset and counts from 0 again. */
+uint64_t stats_history_delta(uint64_t last, uint64_t current);
+
+void record_port_stats_history(bcmolt_interface_type intf_type, uint32_t intf_id, time_t timestamp,
+    const uint64_t counters[STATS_HISTORY_NUM_COUNTERS]);
+void record_onu_stats_history(uint32_t intf_id, uint32_t onu_id, time_t timestamp,
+    const uint64_t counters[STATS_HISTORY_NUM_COUNTERS]);
+void clear_onu_stats_history(uint32_t intf_id, uint32_t onu_id);
+
+/* Append the last num_samples samples, oldest first, and return the number appended */
+uint32_t get_port_stats_history(bcmolt_interface_type intf_type, uint32_t intf_id, uint32_t num_samples,
+    std::vector<stats_history_sample>* samples);
+uint32_t get_onu_stats_history(uint32_t intf_id, uint32_t onu_id, uint32_t num_samples,
+    std::vector<stats_history_sample>* samples);
+
+/* Return false while there is no sample, the rates are per second */
+bool get_port_stats_rates(bcmolt_interface_type intf_type, uint32_t intf_id, double rates[STATS_HISTORY_NUM_COUNTERS]);
+bool get_onu_stats_rates(uint32_t intf_id, uint32_t onu_id, double rates[STATS_HISTORY_NUM_COUNTERS]);
+
+/* Logs the smoothed rates of a port with their peak over the history and, for a
+   PON, those of the ONU with the highest smoothed rate. Returns false while the
+   port has no sample. */
+bool log_port_stats_rates(bcmolt_interface_type intf_type, uint32_t intf_id);
+
+#endif
@@ -0,0 +1,194 @@
+/*
+ * Copyright 2018-present Open Networking Foundation
+
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "threshold_alarms.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+
+#include "indications.h"
+#include "translation.h"
+
+typedef uint64_t (pon_onu_stats::*onu_counter)[MAX_ONUS_PER_PON];
+
+typedef struct {
+    const char *name;
+    onu_counter errors;
+    onu_counter units;
+    double threshold; // errors per unit over the window
+    uint32_t window;  // in seconds
+} onu_threshold_rule;
+
+static onu_threshold_rule onu_threshold_rules[NUM_ONU_THRESHOLD_RULES] = {
+    {"bip errors", &pon_onu_stats::bip_errors, &pon_onu_stats::bip_units,
+        THRESHOLD_BIP_ERROR_RATIO, THRESHOLD_WINDOW},
+    {"fec uncorrectable", &pon_onu_stats::fec_codewords_uncorrectable, &pon_onu_stats::fec_codewords,
+        THRESHOLD_FEC_UNCORRECTABLE_RATIO, THRESHOLD_WINDOW},
+};
+
+/* The counters at the start of the current window of a rule, for all the ONUs of a PON */
+typedef struct {
+    time_t start;                         // 0 before the first window
+    uint64_t errors[MAX_ONUS_PER_PON];
+    uint64_t units[MAX_ONUS_PER_PON];
+    time_t timestamp[MAX_ONUS_PER_PON];   // 0 when the ONU had no counters
+    uint8_t crossed[MAX_ONUS_PER_PON];
+    uint64_t errors_delta[MAX_ONUS_PER_PON]; // over the last window
+    uint64_t units_delta[MAX_ONUS_PER_PON];
+} onu_threshold_window;
+
+static onu_threshold_window onu_threshold_windows[MAX_SUPPORTED_PON][NUM_ONU_THRESHOLD_RULES];
+static uint8_t onu_degraded[MAX_SUPPORTED_PON][MAX_ONUS_PER_PON];
+static uint8_t onu_bal_degraded[MAX_SUPPORTED_PON][MAX_ONUS_PER_PON];
+static std::mutex onu_threshold_lock;
+
+void set_onu_threshold_rule(onu_threshold_rule_id rule, double threshold, uint32_t window) {
+    std::lock_guard<std::mutex> lock(onu_threshold_lock);
+    onu_threshold_rules[rule].threshold = threshold;
+    onu_threshold_rules[rule].window = window;
+}
+
+/* Compares the increase of the counters of all the ONUs since the start of the
+   window with the threshold, given as units per error, the thresholds being
+   ratios well below 1. The loop only subtracts, multiplies and compares 64-bit
+   integers, without a branch or a division, and the arguments do not alias, so
+   that it is vectorized at -O2 on targets with 64-bit vector compares (SSE4.2,
+   AVX2, NEON). */
+static void compare_onu_counters(onu_threshold_window* __restrict window, const uint64_t* __restrict errors,
+        const uint64_t* __restrict units, const time_t* __restrict timestamp, uint64_t units_per_error) {
+    for (int i = 0; i < MAX_ONUS_PER_PON; i++) {
+        uint64_t errors_delta = errors[i] - window->errors[i];
+        uint64_t units_delta = units[i] - window->units[i];
+        // a counter below the start of the window was reset, the ONU is skipped then
+        bool valid = (timestamp[i] != 0) & (window->timestamp[i] != 0) &
+            (errors[i] >= window->errors[i]) & (units[i] > window->units[i]);
+        window->crossed[i] = valid & (units_per_error != 0) & (errors_delta * units_per_error > units_delta);
+        window->errors_delta[i] = errors_delta;
+        window->units_delta[i] = units_delta;
+    }
+}
+
+static void evaluate_rule(const onu_threshold_rule& rule, onu_threshold_window& window, const pon_onu_stats& snapshot) {
+    const uint64_t *errors = snapshot.*rule.errors;
+    const uint64_t *units = snapshot.*rule.units;
+    uint64_t units_per_error = rule.threshold > 0 ? (uint64_t)llround(1 / rule.threshold) : 0;
+
+    compare_onu_counters(&window, errors, units, snapshot.timestamp, units_per_error);
+    memcpy(window.errors, errors, sizeof(window.errors));
+    memcpy(window.units, units, sizeof(window.units));
+    memcpy(window.timestamp, snapshot.timestamp, sizeof(window.timestamp));
+}
+
+static void push_signal_degrade_ind(uint32_t intf_id, uint32_t onu_id, bool degraded, uint32_t inverse_ratio) {
+    openolt::Indication ind;
+    openolt::AlarmIndication* alarm_ind = new openolt::AlarmIndication;
+    openolt::OnuSignalDegradeIndication* sdi_ind = new openolt::OnuSignalDegradeIndication;
+
+    sdi_ind->set_intf_id(intf_id);
+    sdi_ind->set_onu_id(onu_id);
+    sdi_ind->set_status(alarm_status_to_string(degraded ? BCMOLT_STATUS_ON : BCMOLT_STATUS_OFF));
+    sdi_ind->set_inverse_bit_error_rate(inverse_ratio);
+    alarm_ind->set_allocated_onu_signal_degrade_ind(sdi_ind);
+    ind.set_allocated_alarm_ind(alarm_ind);
+    oltIndQ.push(std::move(ind));
+}
+
+uint32_t evaluate_onu_thresholds(uint32_t intf_id, const pon_onu_stats& snapshot, time_t now) {
+    uint32_t num_changed = 0;
+    bool evaluated = false;
+
+    if (intf_id >= MAX_SUPPORTED_PON) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(onu_threshold_lock);
+    for (int r = 0; r < NUM_ONU_THRESHOLD_RULES; r++) {
+        onu_threshold_window& window = onu_threshold_windows[intf_id][r];
+        // a clock stepped back starts a new window
+        if (window.start != 0 && now >= window.start && now - window.start < onu_threshold_rules[r].window) {
+            continue;
+        }
+        evaluate_rule(onu_threshold_rules[r], window, snapshot);
+        window.start = now;
+        evaluated = true;
+    }
+    if (!evaluated) {
+        return 0;
+    }
+
+    for (int i = 0; i < MAX_ONUS_PER_PON; i++) {
+        int crossed_rule = -1;
+        for (int r = 0; r < NUM_ONU_THRESHOLD_RULES; r++) {
+            if (onu_threshold_windows[intf_id][r].crossed[i]) {
+                crossed_rule = r;
+                break;
+            }
+        }
+        bool degraded = crossed_rule >= 0;
+        // the alarm belongs to BAL until BAL clears it
+        if (onu_bal_degraded[intf_id][i] || degraded == (bool)onu_degraded[intf_id][i]) {
+            continue;
+        }
+        onu_degraded[intf_id][i] = degraded;
+        uint32_t onu_id = i + ONU_ID_START;
+        uint32_t inverse_ratio = 0;
+        if (degraded) {
+            // a crossed rule had errors over the window
+            const onu_threshold_window& window = onu_threshold_windows[intf_id][crossed_rule];
+            inverse_ratio = (uint32_t)std::min<uint64_t>(window.units_delta[i] / window.errors_delta[i], UINT32_MAX);
+        }
+        if (degraded) {
+            OPENOLT_LOG(WARNING, openolt_log_id, "onu %s threshold crossed, intf_id %d, onu_id %d, 1 error per %u\n",
+                onu_threshold_rules[crossed_rule].name, intf_id, onu_id, inverse_ratio);
+        } else {
+            OPENOLT_LOG(INFO, openolt_log_id, "onu back below the thresholds, intf_id %d, onu_id %d\n", intf_id, onu_id);
+        }
+        push_signal_degrade_ind(intf_id, onu_id, degraded, inverse_ratio);
+        num_changed++;
+    }
+    return num_changed;
+}
+
+/* The alarm of a deleted ONU is dropped without an indication */
+void clear_onu_thresholds(uint32_t intf_id, uint32_t onu_id) {
+    if (intf_id >= MAX_SUPPORTED_PON || onu_id < ONU_ID_START || onu_id > ONU_ID_END) {
+        return;
+    }
+    int i = onu_id - ONU_ID_START;
+
+    std::lock_guard<std::mutex> lock(onu_threshold_lock);
+    onu_degraded[intf_id][i] = 0;
+    onu_bal_degraded[intf_id][i] = 0;
+    for (int r = 0; r < NUM_ONU_THRESHOLD_RULES; r++) {
+        onu_threshold_windows[intf_id][r].timestamp[i] = 0;
+        onu_threshold_windows[intf_id][r].crossed[i] = 0;
+    }
+}
+
+/* Either way the alarm reported last is the one of BAL. Once BAL has cleared
+   it, the agent raises it again at the end of the next window if the ONU is
+   still above a threshold. */
+void set_onu_bal_signal_degrade(uint32_t intf_id, uint32_t onu_id, bool degraded) {
+    if (intf_id >= MAX_SUPPORTED_PON || onu_id < ONU_ID_START || onu_id > ONU_ID_END) {
+        return;
+    }
+    int i = onu_id - ONU_ID_START;
+
+    std::lock_guard<std::mutex> lock(onu_threshold_lock);
+    onu_bal_degraded[intf_id][i] = degraded;
+    onu_degraded[intf_id][i] = 0;
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright 2018-present Open Networking Foundation
+
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OPENOLT_THRESHOLD_ALARMS_H_
+#define OPENOLT_THRESHOLD_ALARMS_H_
+
+#include "stats_collection.h"
+
+/* The counters of the ONUs swept by the statistics sweep are compared to
+   thresholds on the agent. A rule compares the ratio of an error counter to the
+   counter it is part of (e.g. bip_errors per bip_units) over a window with a
+   threshold. An ONU crossing the threshold of any rule raises a signal degrade
+   alarm, which is cleared once the ONU is below the thresholds of all the rules
+   for a window. BAL raises the same alarm from its own BER monitoring. While
+   BAL has raised it for an ONU the rules are not evaluated for that ONU, so
+   the agent never clears an alarm raised by BAL. */
+
+enum onu_threshold_rule_id {
+    ONU_THRESHOLD_BIP_ERRORS,
+    ONU_THRESHOLD_FEC_UNCORRECTABLE,
+    NUM_ONU_THRESHOLD_RULES
+};
+
+/* Changes the threshold and window of a rule, a threshold of 0 disables the rule */
+void set_onu_threshold_rule(onu_threshold_rule_id rule, double threshold, uint32_t window);
+/* Evaluates the rules whose window is over against the counters of the ONUs of a PON.
+   Returns the number of ONUs whose alarm was raised or cleared. */
+uint32_t evaluate_onu_thresholds(uint32_t intf_id, const pon_onu_stats& snapshot, time_t now);
+void clear_onu_thresholds(uint32_t intf_id, uint32_t onu_id);
+/* Records a signal degrade alarm raised or cleared by BAL */
+void set_onu_bal_signal_degrade(uint32_t intf_id, uint32_t onu_id, bool degraded);
+
+#endif
@@ -0,0 +1,163 @@
+/*
+ * Copyright 2018-present Open Networking Foundation
+
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "trx_ddm_poller.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "core_data.h"
+
+/* The raw registers of a port under a sequence lock: the sequence is odd while
+   the poller writes them, a reader retries when it changed during its read. */
+typedef struct {
+    std::atomic<uint32_t> seq;
+    std::atomic<int> temperature;
+    std::atomic<int> vcc;
+    std::atomic<int> tx_bias;
+    std::atomic<int> tx_power;
+    std::atomic<int> rx_power;
+    std::atomic<time_t> timestamp; // 0 until the port is read
+} trx_ddm_slot;
+
+static trx_ddm_slot trx_ddm_slots[MAX_SUPPORTED_PON];
+// the sequence lock has a single writer
+static std::mutex trx_ddm_write_lock;
+
+static std::mutex trx_ddm_poller_lock;
+static std::condition_variable trx_ddm_poller_cond;
+static bool trx_ddm_poller_running = false;
+static std::thread trx_ddm_poller_thread;
+
+#ifdef ASGVOLT64
+static const TrxEepromReader::device_type trx_ddm_device = TrxEepromReader::DEVICE_GPON;
+#else
+static const TrxEepromReader::device_type trx_ddm_device = TrxEepromReader::DEVICE_XGSPON;
+#endif
+
+void update_trx_ddm(uint32_t intf_id, const TrxEepromReader::ddm_raw& raw, time_t timestamp) {
+    if (intf_id >= MAX_SUPPORTED_PON) {
+        return;
+    }
+    trx_ddm_slot& slot = trx_ddm_slots[intf_id];
+
+    std::lock_guard<std::mutex> lock(trx_ddm_write_lock);
+    uint32_t seq = slot.seq.load(std::memory_order_relaxed);
+    slot.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.temperature.store(raw.temperature, std::memory_order_relaxed);
+    slot.vcc.store(raw.vcc, std::memory_order_relaxed);
+    slot.tx_bias.store(raw.tx_bias, std::memory_order_relaxed);
+    slot.tx_power.store(raw.tx_power, std::memory_order_relaxed);
+    slot.rx_power.store(raw.rx_power, std::memory_order_relaxed);
+    slot.timestamp.store(timestamp, std::memory_order_relaxed);
+    slot.seq.store(seq + 2, std::memory_order_release);
+}
+
+bool get_trx_ddm(uint32_t intf_id, trx_ddm_reading* reading) {
+    TrxEepromReader::ddm_raw raw;
+    time_t timestamp;
+    uint32_t seq;
+
+    if (intf_id >= MAX_SUPPORTED_PON) {
+        return false;
+    }
+    const trx_ddm_slot& slot = trx_ddm_slots[intf_id];
+
+    do {
+        seq = slot.seq.load(std::memory_order_acquire);
+        raw.temperature = slot.temperature.load(std::memory_order_relaxed);
+        raw.vcc = slot.vcc.load(std::memory_order_relaxed);
+        raw.tx_bias = slot.tx_bias.load(std::memory_order_relaxed);
+        raw.tx_power = slot.tx_power.load(std::memory_order_relaxed);
+        raw.rx_power = slot.rx_power.load(std::memory_order_relaxed);
+        timestamp = slot.timestamp.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((seq & 1) || seq != slot.seq.load(std::memory_order_relaxed));
+
+    if (timestamp == 0 || time(NULL) - timestamp > 2 * (time_t)trx_ddm_poll_interval) {
+        return false;
+    }
+
+    TrxEepromReader reader{trx_ddm_device, TrxEepromReader::RX_AND_TX_POWER, (int)intf_id};
+    reading->temperature = reader.raw_temperature_to_celsius(raw.temperature);
+    reading->vcc = reader.raw_vcc_to_volt(raw.vcc);
+    reading->tx_bias = reader.raw_bias_to_ma(raw.tx_bias);
+    reading->tx_power_dbm = reader.mw_to_dbm(reader.raw_tx_to_mw(raw.tx_power));
+    reading->rx_power_dbm = reader.mw_to_dbm(reader.raw_rx_to_mw(raw.rx_power));
+    reading->timestamp = timestamp;
+    return true;
+}
+
+/* Reads the diagnostics of the transceivers of all the PONs once.
+   Returns the number of ports read. */
+uint32_t poll_trx_ddm() {
+    uint32_t num_ports = 0;
+
+    for (uint32_t i = 0; i < NumPonIf_(); i++) {
+        TrxEepromReader reader{trx_ddm_device, TrxEepromReader::RX_AND_TX_POWER, (int)i};
+        TrxEepromReader::ddm_raw raw;
+        if (!reader.read_ddm_raw(&raw)) {
+            continue;
+        }
+        update_trx_ddm(i, raw, time(NULL));
+        OPENOLT_LOG(INFO, openolt_log_id, "PON %u transceiver: %.1f C, %.3f V, %.3f mA, tx %.2f dBm, rx %.2f dBm\n", i,
+            reader.raw_temperature_to_celsius(raw.temperature), reader.raw_vcc_to_volt(raw.vcc), reader.raw_bias_to_ma(raw.tx_bias),
+            reader.mw_to_dbm(reader.raw_tx_to_mw(raw.tx_power)), reader.mw_to_dbm(reader.raw_rx_to_mw(raw.rx_power)));
+        num_ports++;
+    }
+    return num_ports;
+}
+
+static void trx_ddm_poller_loop() {
+    while (true) {
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+        uint32_t num_ports = poll_trx_ddm();
+        OPENOLT_LOG(DEBUG, openolt_log_id, "Read the diagnostics of %u transceivers in %ld ms\n", num_ports,
+            (long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count());
+
+        std::unique_lock<std::mutex> lock(trx_ddm_poller_lock);
+        trx_ddm_poller_cond.wait_until(lock, begin + std::chrono::seconds(trx_ddm_poll_interval), []() { return !trx_ddm_poller_running; });
+        if (!trx_ddm_poller_running) {
+            break;
+        }
+    }
+}
+
+void start_trx_ddm_poller() {
+    std::lock_guard<std::mutex> lock(trx_ddm_poller_lock);
+    if (trx_ddm_poller_running || trx_ddm_poll_interval == 0) {
+        return;
+    }
+    trx_ddm_poller_running = true;
+    trx_ddm_poller_thread = std::thread(trx_ddm_poller_loop);
+}
+
+void stop_trx_ddm_poller() {
+    {
+        std::lock_guard<std::mutex> lock(trx_ddm_poller_lock);
+        if (!trx_ddm_poller_running) {
+            return;
+        }
+        trx_ddm_poller_running = false;
+    }
+    trx_ddm_poller_cond.notify_all();
+    trx_ddm_poller_thread.join();
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright 2018-present Open Networking Foundation
+
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OPENOLT_TRX_DDM_POLLER_H_
+#define OPENOLT_TRX_DDM_POLLER_H_
+
+#include <string>
+
+#include "core.h"
+#include "trx_eeprom_reader.h"
+
+/* The diagnostics (DDM) of the PON transceivers are read in the background
+   every trx_ddm_poll_interval seconds, with one read of the EEPROM per port.
+   The last reading of each port is published with a sequence lock, so that
+   readers never wait for the I2C bus nor for the poller, and logged. No
+   indication carries the readings, so the poller only runs when an interval
+   is given with --ddm-interval. */
+
+typedef struct {
+    double temperature;  // in degree Celsius
+    double vcc;          // in V
+    double tx_bias;      // in mA
+    double tx_power_dbm;
+    double rx_power_dbm;
+    time_t timestamp;
+} trx_ddm_reading;
+
+uint32_t poll_trx_ddm();
+void start_trx_ddm_poller();
+void stop_trx_ddm_poller();
+
+void update_trx_ddm(uint32_t intf_id, const TrxEepromReader::ddm_raw& raw, time_t timestamp);
+/* Returns false when the port was not read for two intervals */
+bool get_trx_ddm(uint32_t intf_id, trx_ddm_reading* reading);
+
+#endif
@@ -24,9 +24,15 @@
 #include <cmath>
 #include <iomanip>
 #include <stdexcept>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "trx_eeprom_reader.h"
 
+// temperature, vcc, tx bias and tx power come before the rx power
+#define DDM_NUM_FIELDS 5
+
 // g++ -std=c++11 -DRXTX_POWER_EXE_MODE trx_eeprom_reader.cc -o rssi
 
 TrxEepromReader::TrxEepromReader(device_type dev_type, const power_type read_type, const int port)
@@ -104,32 +110,54 @@ std::string TrxEepromReader::get_board_name() {
 }
 
 int TrxEepromReader::read_binary_file(char* buffer) {
-    std::ifstream is;
     int len;
 
     if (buffer == NULL || _buf_size < 0) {
         return -1;
     }
 
+    len = read_bytes((unsigned char*)buffer, 0, _buf_size);
+    if (len < 0) {
+        return len;
+    }
+
+    if (len > _buf_size || len < (_read_offset + _read_num_bytes)) {
+        return -4;
+    }
+
+    return len;
+}
+
+// reads num_bytes at offset with a single system call, each byte read from the
+// EEPROM of the sysfs is a transfer on the I2C bus
+int TrxEepromReader::read_bytes(unsigned char* buffer, int offset, int num_bytes) {
+    int fd;
+    ssize_t len;
+
+    if (buffer == NULL || offset < 0 || num_bytes < 0) {
+        return -1;
+    }
+
 #ifdef TEST_MODE
-    is.open("./eeprom.bin", std::ios_base::in | std::ios_base::binary);
+    fd = open("./eeprom.bin", O_RDONLY);
 #else
-    is.open(_node_path, std::ios_base::in | std::ios_base::binary);
+    fd = open(_node_path, O_RDONLY);
 #endif
 
-    if (!is.is_open()) {
+    if (fd < 0) {
         return -2;
     }
 
-    is.read(buffer, _buf_size);
-    len = is.gcount();
-    is.close();
+    do {
+        len = pread(fd, buffer, num_bytes, offset);
+    } while (len < 0 && errno == EINTR);
+    close(fd);
 
-    if (len > _buf_size || len < (_read_offset + _read_num_bytes)) {
-        return -4;
+    if (len < 0) {
+        return -3;
     }
 
-    return len;
+    return (int)len;
 }
 
 bool TrxEepromReader::is_valid_port() const {
@@ -167,50 +195,46 @@ double TrxEepromReader::mw_to_dbm(double mw) {
     return 10 * log10(mw);
 }
 
+// signed, in 1/256 degree Celsius
+double TrxEepromReader::raw_temperature_to_celsius(int raw) {
+    return (raw >= 0x8000 ? raw - 0x10000 : raw) / 256.0;
+}
+
+// in 100 uV
+double TrxEepromReader::raw_vcc_to_volt(int raw) {
+    return raw * 0.0001;
+}
+
+// in 2 uA
+double TrxEepromReader::raw_bias_to_ma(int raw) {
+    return raw * 0.002;
+}
+
 std::pair<std::pair<int, int>, bool> TrxEepromReader::read_power_raw() {
     if (is_valid_port()) {
         set_port_path();
 
-        char* eeprom_data = new (std::nothrow) char[_buf_size];
-
-        if (!eeprom_data) {
-            std::cerr << "ERROR - memory allocation for eeprom_data failed\n";
-            return {{0, 0}, false};
-        }
-
-        int ret_file = read_binary_file(eeprom_data);
+        // the tx power is just before the rx power, both are read at once
+        unsigned char power_data[2 * _read_num_bytes];
+        int ret_file = read_bytes(power_data, _read_offset - _read_num_bytes, 2 * _read_num_bytes);
 
-        if (ret_file < 0) {
-            std::cerr << "ERROR - eeprom_data file cannot be opened\n";
+        if (ret_file != 2 * _read_num_bytes) {
+            std::cerr << "ERROR - eeprom_data file cannot be read\n";
             return {{0, 0}, false};
         }
 
-        // le = Little Endian, be = Big Endian
-        unsigned char rx_power_le[_read_num_bytes] = {0};
-        unsigned char tx_power_le[_read_num_bytes] = {0};
+        // be = Big Endian
         unsigned long rx_power_be = 0;
         unsigned long tx_power_be = 0;
 
         if (_read_type == RX_POWER || _read_type == RX_AND_TX_POWER) {
-            memcpy(&rx_power_le, eeprom_data + _read_offset, _read_num_bytes);
-            rx_power_be = get_value_from_pointer_u(rx_power_le, _read_num_bytes);
+            rx_power_be = get_value_from_pointer_u(power_data + _read_num_bytes, _read_num_bytes);
         }
 
         if (_read_type == TX_POWER || _read_type == RX_AND_TX_POWER) {
-            memcpy(&tx_power_le, eeprom_data + _read_offset - _read_num_bytes, _read_num_bytes);
-            tx_power_be = get_value_from_pointer_u(tx_power_le, _read_num_bytes);
-        }
-
-        if (_read_type == RX_POWER) {
-            tx_power_be = 0;
+            tx_power_be = get_value_from_pointer_u(power_data, _read_num_bytes);
         }
 
-        if (_read_type == TX_POWER) {
-            rx_power_be = 0;
-        }
-
-        delete[] eeprom_data;
-
         return {{(int)rx_power_be, (int)tx_power_be}, true};
     } else {
         std::cerr << "ERROR - invalid port: " << _port << '\n';
@@ -227,6 +251,27 @@ std::pair<std::pair<double, double>, bool> TrxEepromReader::read_power_mean_dbm(
     }
 }
 
+bool TrxEepromReader::read_ddm_raw(ddm_raw* raw) {
+    if (raw == NULL || !is_valid_port()) {
+        return false;
+    }
+    set_port_path();
+
+    unsigned char ddm_data[DDM_NUM_FIELDS * _read_num_bytes];
+    int ddm_offset = _read_offset - (DDM_NUM_FIELDS - 1) * _read_num_bytes;
+    if (read_bytes(ddm_data, ddm_offset, sizeof(ddm_data)) != (int)sizeof(ddm_data)) {
+        return false;
+    }
+
+    raw->temperature = get_value_from_pointer_u(ddm_data, _read_num_bytes);
+    raw->vcc = get_value_from_pointer_u(ddm_data + _read_num_bytes, _read_num_bytes);
+    raw->tx_bias = get_value_from_pointer_u(ddm_data + 2 * _read_num_bytes, _read_num_bytes);
+    raw->tx_power = get_value_from_pointer_u(ddm_data + 3 * _read_num_bytes, _read_num_bytes);
+    raw->rx_power = get_value_from_pointer_u(ddm_data + 4 * _read_num_bytes, _read_num_bytes);
+
+    return true;
+}
+
 std::string TrxEepromReader::dump_data() {
     std::ostringstream dump;
 
@@ -41,6 +41,15 @@ class TrxEepromReader {
             RX_AND_TX_POWER
         };
 
+        // the raw diagnostics of SFF-8472, in the order of the EEPROM, ending with the rx power at the read offset
+        struct ddm_raw {
+            int temperature;
+            int vcc;
+            int tx_bias;
+            int tx_power;
+            int rx_power;
+        };
+
         TrxEepromReader(device_type dev_type, const power_type read_type, const int port);
         TrxEepromReader() = delete;
 
@@ -48,14 +57,19 @@ class TrxEepromReader {
         static std::string get_board_name();
 
         int read_binary_file(char* buffer);
+        int read_bytes(unsigned char* buffer, int offset, int num_bytes);
         bool is_valid_port() const;
         void set_port_path();
         unsigned long get_value_from_pointer_u(unsigned char *ptr, int size);
         double raw_rx_to_mw(int raw);
         double raw_tx_to_mw(int raw);
         double mw_to_dbm(double mw);
+        double raw_temperature_to_celsius(int raw);
+        double raw_vcc_to_volt(int raw);
+        double raw_bias_to_ma(int raw);
         std::pair<std::pair<int, int>, bool> read_power_raw();
         std::pair<std::pair<double, double>, bool> read_power_mean_dbm();
+        bool read_ddm_raw(ddm_raw* raw);
         std::string dump_data();
         int get_buf_size() const;
         int get_read_offset() const;
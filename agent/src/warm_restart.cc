@@ -0,0 +1,229 @@
+/*
+ * Copyright 2018-present Open Networking Foundation
+
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "warm_restart.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "core_data.h"
+#include "core_utils.h"
+
+extern "C"
+{
+#include <bcmolt_api.h>
+#include <bcmolt_api_model_api_structs.h>
+}
+
+/* The keys are probed one by one with bcmolt_cfg_get, WARM_RESTART_SCAN_FANOUT
+   of them at a time. The key spaces are bounded by the agent's own allocators
+   and an absent key is answered by BAL without touching the device. BAL may
+   answer a key that is not configured as well, so configured() has to check
+   the state of the object. */
+static std::vector<uint32_t> scan_bal_keys(uint32_t start, uint32_t end, const std::function<bool(uint32_t)>& configured) {
+    std::atomic<uint32_t> next(start);
+    std::mutex found_lock;
+    std::vector<uint32_t> found;
+    std::vector<std::thread> workers;
+
+    for (int t = 0; t < WARM_RESTART_SCAN_FANOUT; t++) {
+        workers.emplace_back([&]() {
+            for (uint32_t key = next++; key < end; key = next++) {
+                if (configured(key)) {
+                    std::lock_guard<std::mutex> lock(found_lock);
+                    found.push_back(key);
+                }
+            }
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+    std::sort(found.begin(), found.end());
+    return found;
+}
+
+static bool flow_configured(uint32_t flow_id, bcmolt_flow_type flow_type) {
+    bcmolt_flow_cfg cfg;
+    bcmolt_flow_key key = { };
+
+    key.flow_id = flow_id;
+    key.flow_type = flow_type;
+    BCMOLT_CFG_INIT(&cfg, flow, key);
+    BCMOLT_FIELD_SET_PRESENT(&cfg.data, flow_cfg_data, state);
+    return bcmolt_cfg_get(dev_id, &cfg.hdr) == BCM_ERR_OK && cfg.data.state != BCMOLT_FLOW_STATE_NOT_CONFIGURED;
+}
+
+/* Flow IDs are shared by the flow types, the flow_map has an entry per BAL flow.
+   A flow that none of the VOLTHA flows restored from the state journal refers
+   to was left by a FlowAdd the agent did not complete, its ID stays taken. */
+static uint32_t rebuild_flows(uint32_t *num_unreferenced) {
+    const bcmolt_flow_type flow_types[] = {BCMOLT_FLOW_TYPE_UPSTREAM, BCMOLT_FLOW_TYPE_DOWNSTREAM, BCMOLT_FLOW_TYPE_MULTICAST};
+    uint32_t num_flows = 0;
+    std::set<uint32_t> referenced;
+
+    bcmos_fastlock_lock(&voltha_flow_to_device_flow_lock);
+    for (auto it = voltha_flow_to_device_flow.begin(); it != voltha_flow_to_device_flow.end(); ++it) {
+        int num_params = it->second.is_flow_replicated ? it->second.total_replicated_flows : 1;
+        for (int i = 0; i < num_params; i++) {
+            referenced.insert(it->second.params[i].flow_id);
+        }
+    }
+    bcmos_fastlock_unlock(&voltha_flow_to_device_flow_lock, 0);
+    *num_unreferenced = 0;
+
+    for (bcmolt_flow_type flow_type : flow_types) {
+        std::vector<uint32_t> flow_ids = scan_bal_keys(FLOW_ID_START, MAX_FLOW_ID, [flow_type](uint32_t flow_id) {
+            return flow_configured(flow_id, flow_type);
+        });
+
+        bcmos_fastlock_lock(&flow_id_bitset_lock);
+        for (uint32_t flow_id : flow_ids) {
+            flow_id_bitset[flow_id] = 1;
+        }
+        bcmos_fastlock_unlock(&flow_id_bitset_lock, 0);
+
+        bcmos_fastlock_lock(&data_lock);
+        for (uint32_t flow_id : flow_ids) {
+            flow_map[flow_pair(flow_id, flow_type)] = flow_map.size();
+        }
+        flow_id_counters = flow_map.size();
+        bcmos_fastlock_unlock(&data_lock, 0);
+        num_flows += flow_ids.size();
+        for (uint32_t flow_id : flow_ids) {
+            if (referenced.find(flow_id) == referenced.end()) {
+                (*num_unreferenced)++;
+            }
+        }
+    }
+    return num_flows;
+}
+
+/* Both the default interface schedulers and the subscriber schedulers come
+   out of the tm_sched_id space, so any configured one is taken. */
+static uint32_t rebuild_tm_scheds() {
+    std::vector<uint32_t> sched_ids = scan_bal_keys(0, MAX_TM_SCHED_ID, [](uint32_t sched_id) {
+        bcmolt_tm_sched_cfg cfg;
+        bcmolt_tm_sched_key key = { };
+
+        key.id = sched_id;
+        BCMOLT_CFG_INIT(&cfg, tm_sched, key);
+        BCMOLT_FIELD_SET_PRESENT(&cfg.data, tm_sched_cfg_data, state);
+        return bcmolt_cfg_get(dev_id, &cfg.hdr) == BCM_ERR_OK && cfg.data.state == BCMOLT_CONFIG_STATE_CONFIGURED;
+    });
+
+    bcmos_fastlock_lock(&tm_sched_bitset_lock);
+    for (uint32_t sched_id : sched_ids) {
+        tm_sched_bitset[sched_id] = 1;
+    }
+    bcmos_fastlock_unlock(&tm_sched_bitset_lock, 0);
+    return sched_ids.size();
+}
+
+/* Queue mapping profiles are shared by content, so the profile itself is
+   restored for get_tm_qmp_id() to find it again. */
+static uint32_t rebuild_tm_qmps() {
+    uint32_t num_qmps = 0;
+
+    for (uint32_t tm_qmp_id = 0; tm_qmp_id < MAX_TM_QMP_ID; tm_qmp_id++) {
+        bcmolt_tm_qmp_cfg cfg;
+        bcmolt_tm_qmp_key key = { };
+
+        key.id = tm_qmp_id;
+        BCMOLT_CFG_INIT(&cfg, tm_qmp, key);
+        BCMOLT_FIELD_SET_PRESENT(&cfg.data, tm_qmp_cfg_data, state);
+        BCMOLT_FIELD_SET_PRESENT(&cfg.data, tm_qmp_cfg_data, pbits_to_tmq_id);
+        if (bcmolt_cfg_get(dev_id, &cfg.hdr) != BCM_ERR_OK || cfg.data.state != BCMOLT_CONFIG_STATE_CONFIGURED) {
+            continue;
+        }
+
+        std::vector<uint32_t> tmq_map_profile(TMQ_MAP_PROFILE_SIZE, 0);
+        for (uint32_t i = 0; i < TMQ_MAP_PROFILE_SIZE; i++) {
+            tmq_map_profile[i] = cfg.data.pbits_to_tmq_id.arr[i];
+        }
+        bcmos_fastlock_lock(&tm_qmp_bitset_lock);
+        tm_qmp_bitset[tm_qmp_id] = 1;
+        qmp_id_to_qmp_map[tm_qmp_id] = tmq_map_profile;
+        bcmos_fastlock_unlock(&tm_qmp_bitset_lock, 0);
+        num_qmps++;
+    }
+    return num_qmps;
+}
+
+/* The ACL classifier key is rebuilt the way install_acl() set it up: absent
+   classifier fields are -1 and an absent o_vid is ANY_VLAN. */
+static uint32_t rebuild_acls() {
+    uint32_t num_acls = 0;
+
+    for (uint32_t acl_id = 0; acl_id < MAX_ACL_ID; acl_id++) {
+        bcmolt_access_control_cfg cfg;
+        bcmolt_access_control_key key = { };
+
+        key.id = acl_id;
+        BCMOLT_CFG_INIT(&cfg, access_control, key);
+        BCMOLT_FIELD_SET_PRESENT(&cfg.data, access_control_cfg_data, state);
+        BCMOLT_FIELD_SET_PRESENT(&cfg.data, access_control_cfg_data, classifier);
+        if (bcmolt_cfg_get(dev_id, &cfg.hdr) != BCM_ERR_OK || cfg.data.state != BCMOLT_CONFIG_STATE_CONFIGURED) {
+            continue;
+        }
+
+        acl_classifier_key acl_key;
+        acl_key.ether_type = cfg.data.classifier.ether_type ? cfg.data.classifier.ether_type : -1;
+        acl_key.ip_proto = cfg.data.classifier.ip_proto ? cfg.data.classifier.ip_proto : -1;
+        acl_key.src_port = cfg.data.classifier.src_port ? cfg.data.classifier.src_port : -1;
+        acl_key.dst_port = cfg.data.classifier.dst_port ? cfg.data.classifier.dst_port : -1;
+        acl_key.o_vid = cfg.data.classifier.o_vid ? cfg.data.classifier.o_vid : ANY_VLAN;
+
+        bcmos_fastlock_lock(&acl_id_bitset_lock);
+        acl_id_bitset[acl_id] = 1;
+        bcmos_fastlock_unlock(&acl_id_bitset_lock, 0);
+
+        bcmos_fastlock_lock(&acl_packet_trap_handler_lock);
+        acl_classifier_to_acl_id_map[acl_key] = acl_id;
+        if (acl_key.o_vid != ANY_VLAN && acl_id >= MAX_ACL_WITH_VLAN_CLASSIFIER) {
+            max_acls_with_vlan_classifiers_hit = true;
+        }
+        bcmos_fastlock_unlock(&acl_packet_trap_handler_lock, 0);
+        num_acls++;
+    }
+    return num_acls;
+}
+
+Status rebuild_state_from_bal() {
+    auto start = std::chrono::steady_clock::now();
+
+    OPENOLT_LOG(INFO, openolt_log_id, "Warm restart, rebuilding agent state from BAL\n");
+
+    uint32_t num_unreferenced_flows;
+    uint32_t num_flows = rebuild_flows(&num_unreferenced_flows);
+    uint32_t num_scheds = rebuild_tm_scheds();
+    uint32_t num_qmps = rebuild_tm_qmps();
+    uint32_t num_acls = rebuild_acls();
+
+    OPENOLT_LOG(INFO, openolt_log_id, "Warm restart, found %u flows, %u tm_scheds, %u tm_qmps, %u acls in %ld ms\n",
+        num_flows, num_scheds, num_qmps, num_acls,
+        (long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+    if (num_unreferenced_flows > 0) {
+        OPENOLT_LOG(WARNING, openolt_log_id, "Warm restart, %u flows in BAL are not referenced by a VOLTHA flow\n", num_unreferenced_flows);
+    }
+    return Status::OK;
+}
@@ -0,0 +1,27 @@
+/*
+ * Copyright 2018-present Open Networking Foundation
+
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+
+ * http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OPENOLT_WARM_RESTART_H_
+#define OPENOLT_WARM_RESTART_H_
+
+#include "core.h"
+
+/* Rebuild the resource state of the agent from the objects BAL still has
+   configured, when the agent is restarted against a running dev_mgmt_daemon
+   whose MAC devices stayed connected. */
+Status rebuild_state_from_bal();
+
+#endif
@@ -30,6 +30,7 @@ extern "C" {
 
 char log_string[500];
 dev_log_id def_log_id=0;
+bcm_dev_log_level stub_log_level = DEV_LOG_LEVEL_DEBUG;
 
 void bcmos_usleep(uint32_t us) {
     // let always sleep for 10ms irrespective of the value passed.
@@ -203,6 +204,14 @@ dev_log_id bcm_dev_log_id_register(const char *xi_name,
      bcm_dev_log_id_type xi_default_log_type) {
     return 0;
 }
+
+bcmos_errno bcm_dev_log_id_get_level(dev_log_id id,
+     bcm_dev_log_level *p_log_level_print,
+     bcm_dev_log_level *p_log_level_save) {
+    *p_log_level_print = stub_log_level;
+    *p_log_level_save = stub_log_level;
+    return BCM_ERR_OK;
+}
 bool bcmcli_is_stopped(bcmcli_session *sess) {
     printf("-- stub bcmcli_is_stopped called --\n");
     return true;
@@ -15,12 +15,24 @@
  */
 #include "gtest/gtest.h"
 #include "Queue.h"
+#include "ConflatingQueue.h"
 #include "bal_mocker.h"
 #include "core.h"
 #include "core_data.h"
 #include "core_utils.h"
 #include "server.h"
+#include "warm_restart.h"
+#include "state_journal.h"
+#include "indications.h"
+#include "stats_collection.h"
+#include "stats_history.h"
+#include "threshold_alarms.h"
+#include "gem_top_talkers.h"
+#include "rssi_sweep.h"
+#include "trx_ddm_poller.h"
+#include "async_log.h"
 #include <future>
+#include <thread>
 #include <fstream>
 #include "trx_eeprom_reader.h"
 using namespace testing;
@@ -376,9 +388,13 @@ class TestProbeDevCapabilities : public Test {
             BCMOLT_CFG_INIT(&olt_cfg, olt, olt_key);
 
             olt_cfg.data.topology.topology_maps.len = num_of_pon_port;
+
+            // every test starts cold
+            remove(DEVICE_CAPABILITY_CACHE_FILE);
         }
 
         virtual void TearDown() {
+            remove(DEVICE_CAPABILITY_CACHE_FILE);
         }
 };
 
@@ -435,6 +451,26 @@ TEST_F(TestProbeDevCapabilities, ProbedDev_OltQuerySucceeded_SomeDevQueriesFaile
     ASSERT_TRUE( query_status.error_message() == Status::OK.error_message() );
 }
 
+// Test 5 - A restart with a matching capability cache only queries the first device
+TEST_F(TestProbeDevCapabilities, ProbedDev_WarmStartUsesCache) {
+
+    EXPECT_GLOBAL_CALL(bcmolt_cfg_get__olt_topology_stub, bcmolt_cfg_get__olt_topology_stub(_,_))
+                     .Times(2)
+                     .WillRepeatedly(Return(olt_res_success));
+
+    EXPECT_CALL(balMock, bcmolt_cfg_get(_, _))
+        .Times(BCM_MAX_DEVS_PER_LINE_CARD + 1)
+        .WillRepeatedly(Return(dev_res_success));
+
+    // cold start probes all the devices and saves the cache
+    Status query_status = ProbeDeviceCapabilities_();
+    ASSERT_TRUE( query_status.error_message() == Status::OK.error_message() );
+
+    // warm start validates the cache against the first device
+    query_status = ProbeDeviceCapabilities_();
+    ASSERT_TRUE( query_status.error_message() == Status::OK.error_message() );
+}
+
 ////////////////////////////////////////////////////////////////////////////
 // For testing EnablePonIf functionality
 ////////////////////////////////////////////////////////////////////////////
@@ -1357,6 +1393,47 @@ TEST_F(TestOmciMsgOut, OmciMsgOutFailure) {
     ASSERT_TRUE( status.error_message() != Status::OK.error_message() );
 }
 
+// Test 3 - OmciMsgOut hex payload is decoded into the OMCI buffer
+TEST_F(TestOmciMsgOut, OmciMsgOutHexDecode) {
+    std::string hex_pkt = "00014F0A000200000000000000000000000000000000000000000000000000000000000000000000000000000028";
+    uint8_t decoded[MAX_OMCI_MSG_LENGTH] = {};
+    uint32_t decoded_len = 0;
+
+    EXPECT_CALL(balMock, bcmolt_oper_submit(_, _))
+        .WillOnce(Invoke([&](bcmolt_oltid olt, bcmolt_oper *oper) {
+            bcmolt_onu_cpu_packets *omci = (bcmolt_onu_cpu_packets *)oper;
+            decoded_len = omci->data.buffer.len;
+            memcpy(decoded, omci->data.buffer.arr, decoded_len);
+            return BCM_ERR_OK;
+        }));
+
+    Status status = OmciMsgOut_(pon_id, onu_id, hex_pkt);
+    ASSERT_TRUE( status.error_message() == Status::OK.error_message() );
+    ASSERT_EQ(decoded_len, MAX_OMCI_MSG_LENGTH);
+    ASSERT_EQ(decoded[0], 0x00);
+    ASSERT_EQ(decoded[2], 0x4F);
+    ASSERT_EQ(decoded[3], 0x0A);
+    ASSERT_EQ(decoded[MAX_OMCI_MSG_LENGTH - 1], 0x00);
+}
+
+// Test 4 - OmciMsgOut message rate, this is the per message cost a unary or
+// streamed OMCI request pays inside the agent
+TEST_F(TestOmciMsgOut, OmciMsgOutMessageRate) {
+    const int num_msgs = 10000;
+    std::string hex_pkt(2*MAX_OMCI_MSG_LENGTH, 'a');
+
+    ON_CALL(balMock, bcmolt_oper_submit(_, _)).WillByDefault(Return(BCM_ERR_OK));
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_msgs; i++) {
+        Status status = OmciMsgOut_(pon_id, onu_id, hex_pkt);
+        ASSERT_TRUE( status.error_message() == Status::OK.error_message() );
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "OmciMsgOut_: " << num_msgs << " messages in " << elapsed << " us ("
+              << (elapsed ? (num_msgs * 1000000LL / elapsed) : 0) << " msgs/sec)" << std::endl;
+}
+
 ////////////////////////////////////////////////////////////////////////////
 // For testing FlowAdd functionality
 ////////////////////////////////////////////////////////////////////////////
@@ -3835,6 +3912,12 @@ class TestPowerRead : public Test {
             content.fill(0x00); // not required for 0x00
 
             // for asfvolt16
+            content[96] = 0x1A;
+            content[97] = 0x80;
+            content[98] = 0x80;
+            content[99] = 0x83;
+            content[100] = 0x1F;
+            content[101] = 0x40;
             content[102] = 0x5D;
             content[103] = 0x38;
             content[104] = 0x1A;
@@ -3958,6 +4041,37 @@ TEST_F(TestPowerRead, TestAsgvolt64) {
     ASSERT_STREQ(trx_eeprom_reader2.get_node_path(), "/sys/bus/i2c/devices/41-0050/eeprom");
 }
 
+TEST_F(TestPowerRead, TestDdmRead) {
+    auto trx_eeprom_reader = TrxEepromReader{TrxEepromReader::DEVICE_XGSPON, TrxEepromReader::RX_AND_TX_POWER, 0};
+    TrxEepromReader::ddm_raw raw;
+
+    ASSERT_TRUE(trx_eeprom_reader.read_ddm_raw(&raw));
+    ASSERT_DOUBLE_EQ(trx_eeprom_reader.raw_temperature_to_celsius(raw.temperature), 26.5);
+    ASSERT_NEAR(trx_eeprom_reader.raw_vcc_to_volt(raw.vcc), 3.2899, 1e-9);
+    ASSERT_NEAR(trx_eeprom_reader.raw_bias_to_ma(raw.tx_bias), 16.0, 1e-9);
+    ASSERT_EQ(raw.tx_power, 0x5D38);
+    ASSERT_EQ(raw.rx_power, 0x1AB5);
+    ASSERT_DOUBLE_EQ(trx_eeprom_reader.raw_temperature_to_celsius(0xFF00), -1.0);
+}
+
+TEST_F(TestPowerRead, TestDdmCache) {
+    TrxEepromReader::ddm_raw raw = {0x1A80, 0x8083, 0x1F40, 0x5D38, 0x1AB5};
+    trx_ddm_reading reading;
+    uint32_t saved_trx_ddm_poll_interval = trx_ddm_poll_interval;
+
+    // as with --ddm-interval 60
+    trx_ddm_poll_interval = 60;
+    ASSERT_FALSE(get_trx_ddm(3, &reading));
+    update_trx_ddm(3, raw, time(NULL));
+    ASSERT_TRUE(get_trx_ddm(3, &reading));
+    ASSERT_DOUBLE_EQ(reading.temperature, 26.5);
+    ASSERT_NEAR(reading.rx_power_dbm, -1.65, 0.01);
+
+    update_trx_ddm(3, raw, time(NULL) - 2 * trx_ddm_poll_interval - 1);
+    ASSERT_FALSE(get_trx_ddm(3, &reading));
+    trx_ddm_poll_interval = saved_trx_ddm_poll_interval;
+}
+
 ////////////////////////////////////////////////////////////////////////////
 // For testing SFP eeprom read and decode capabilities
 ////////////////////////////////////////////////////////////////////////////
@@ -3989,6 +4103,26 @@ TEST_F(TestEEPROMReadDecode, TestSFF8436Decode) {
 
 }
 
+// The sfp presence is read from the EEPROM files, only the EEPROM of sfp 0
+// (bus 47) is in the test directory.
+TEST_F(TestEEPROMReadDecode, TestSfpPresenceFromSysfs) {
+    set<int> sfp = ponTrx.read_sfp_presence_data();
+    ASSERT_EQ(sfp.size(), 1);
+    ASSERT_EQ(sfp.count(0), 1);
+}
+
+// The EEPROMs of all the present sfps are read concurrently and decoded, a
+// missing EEPROM fails the whole read.
+TEST_F(TestEEPROMReadDecode, TestConcurrentReadDecode) {
+    ASSERT_TRUE(ponTrx.read_and_decode_eeprom_data({0}));
+    trx_data* t = ponTrx.get_trx_data(0);
+    ASSERT_NE(t, NULL);
+    ASSERT_STREQ(t->vendor_part_no.c_str(), "LTH7226-PC+     ");
+    ASSERT_EQ(t->p_data[0].wavelength, 1577);
+
+    ASSERT_FALSE(ponTrx.read_and_decode_eeprom_data({0, 1}));
+}
+
 TEST_F(TestEEPROMReadDecode, TestHexToAsciiSuccess) {
     std::string vn_ascii("SUPERXON LTD.   ");
     std::string oui_ascii("");
@@ -4026,4 +4160,1424 @@ TEST_F(TestEEPROMReadDecode, TestHexToUintSuccess) {
     res = hex_to_uinteger(vn_hex, EEPROM_DOWNSTREAM_WAVELENGTH_LENGTH);
     ASSERT_TRUE(res.second);
     ASSERT_EQ(res.first, wl_uint);
-}
\ No newline at end of file
+}
+////////////////////////////////////////////////////////////////////////////
+// For testing indication Queue functionality
+////////////////////////////////////////////////////////////////////////////
+
+// Counts the copies and moves made while an item travels through the Queue
+struct QueueItemCounter {
+    static int copies;
+    static int moves;
+    std::string payload;
+
+    QueueItemCounter() = default;
+    QueueItemCounter(const QueueItemCounter& other) : payload(other.payload) { copies++; }
+    QueueItemCounter(QueueItemCounter&& other) : payload(std::move(other.payload)) { moves++; }
+    QueueItemCounter& operator=(const QueueItemCounter& other) { payload = other.payload; copies++; return *this; }
+    QueueItemCounter& operator=(QueueItemCounter&& other) { payload = std::move(other.payload); moves++; return *this; }
+};
+int QueueItemCounter::copies = 0;
+int QueueItemCounter::moves = 0;
+
+class TestIndicationQueue : public Test {
+    protected:
+        virtual void SetUp() {
+            QueueItemCounter::copies = 0;
+            QueueItemCounter::moves = 0;
+        }
+
+        virtual void TearDown() {
+        }
+};
+
+// Test 1 - Items pushed as rvalues are never copied by any of the pop variants
+TEST_F(TestIndicationQueue, PushPopWithoutCopy) {
+    Queue<QueueItemCounter> q;
+    QueueItemCounter item;
+
+    item.payload = "pkt";
+    q.push(std::move(item));
+    QueueItemCounter out;
+    ASSERT_TRUE(q.pop(out, std::chrono::milliseconds(10)));
+    ASSERT_EQ(out.payload, "pkt");
+
+    item.payload = "omci";
+    q.push(std::move(item));
+    std::pair<QueueItemCounter, bool> res = q.pop(10);
+    ASSERT_TRUE(res.second);
+    ASSERT_EQ(res.first.payload, "omci");
+
+    item.payload = "alarm";
+    q.push(std::move(item));
+    q.pop(out);
+    ASSERT_EQ(out.payload, "alarm");
+
+    ASSERT_EQ(QueueItemCounter::copies, 0);
+}
+
+// Test 2 - An indication keeps its sub message allocation through the queue
+TEST_F(TestIndicationQueue, IndicationMovedThroughQueue) {
+    Queue<openolt::Indication> q;
+    openolt::Indication ind;
+    openolt::OmciIndication* omci_ind = new openolt::OmciIndication;
+
+    omci_ind->set_intf_id(1);
+    omci_ind->set_onu_id(2);
+    omci_ind->set_pkt(std::string(MAX_OMCI_MSG_LENGTH, 'a'));
+    ind.set_allocated_omci_ind(omci_ind);
+    q.push(std::move(ind));
+
+    openolt::Indication out;
+    ASSERT_TRUE(q.pop(out, std::chrono::milliseconds(10)));
+    ASSERT_TRUE(out.has_omci_ind());
+    // Moved, not copied, so it is still the same object that was allocated by the producer
+    ASSERT_EQ(&out.omci_ind(), omci_ind);
+    ASSERT_EQ(out.omci_ind().onu_id(), 2);
+}
+
+////////////////////////////////////////////////////////////////////////////
+// For testing indication conflation
+////////////////////////////////////////////////////////////////////////////
+
+// Items are (object, value) pairs. Objects >= 0 are state-like and keyed by the
+// object, negative ones are events.
+static bool test_item_key(const std::pair<int, int>& item, int* key) {
+    *key = item.first;
+    return item.first >= 0;
+}
+
+class TestConflatingQueue : public Test {
+    protected:
+        ConflatingQueue<std::pair<int, int>, int> q{test_item_key};
+
+        virtual void SetUp() {
+        }
+
+        virtual void TearDown() {
+        }
+};
+
+// Test 1 - Only the latest state of an object is kept, and it moves to the tail
+TEST_F(TestConflatingQueue, StateIsConflated) {
+    std::pair<int, int> out;
+
+    q.push(std::make_pair(1, 100));
+    q.push(std::make_pair(-1, 1));
+    q.push(std::make_pair(2, 200));
+    q.push(std::make_pair(1, 101));
+    q.push(std::make_pair(1, 102));
+
+    ASSERT_EQ(q.size(), 3);
+    ASSERT_EQ(q.conflated(), 2);
+    ASSERT_TRUE(q.pop(out, std::chrono::milliseconds(10)));
+    ASSERT_EQ(out, std::make_pair(-1, 1));
+    ASSERT_TRUE(q.pop(out, std::chrono::milliseconds(10)));
+    ASSERT_EQ(out, std::make_pair(2, 200));
+    ASSERT_TRUE(q.pop(out, std::chrono::milliseconds(10)));
+    ASSERT_EQ(out, std::make_pair(1, 102));
+}
+
+// Test 2 - Events are never conflated and keep FIFO order
+TEST_F(TestConflatingQueue, EventsKeepFifoOrder) {
+    for (int i = 0; i < 10; i++) {
+        q.push(std::make_pair(-1, i));
+    }
+    ASSERT_EQ(q.size(), 10);
+    ASSERT_EQ(q.conflated(), 0);
+    for (int i = 0; i < 10; i++) {
+        std::pair<std::pair<int, int>, bool> res = q.pop(10);
+        ASSERT_TRUE(res.second);
+        ASSERT_EQ(res.first.second, i);
+    }
+    ASSERT_FALSE(q.pop(10).second);
+}
+
+// Test 3 - Memory stays bounded by the number of objects however many updates are pushed
+TEST_F(TestConflatingQueue, StateIsBoundedByObjects) {
+    for (int i = 0; i < 10000; i++) {
+        q.push(std::make_pair(i % 16, i));
+    }
+    ASSERT_EQ(q.size(), 16);
+}
+
+// Test 4 - A state put back after a failed delivery goes to the head, unless a newer one is queued
+TEST_F(TestConflatingQueue, PushFrontDropsStaleState) {
+    std::pair<int, int> out;
+
+    q.push(std::make_pair(-1, 1));
+    q.push(std::make_pair(1, 101));
+    q.push_front(std::make_pair(1, 100));
+    q.push_front(std::make_pair(2, 200));
+
+    ASSERT_EQ(q.size(), 3);
+    q.pop(out);
+    ASSERT_EQ(out, std::make_pair(2, 200));
+    q.pop(out);
+    ASSERT_EQ(out, std::make_pair(-1, 1));
+    q.pop(out);
+    ASSERT_EQ(out, std::make_pair(1, 101));
+}
+
+////////////////////////////////////////////////////////////////////////////
+// For testing the agent State transitions
+////////////////////////////////////////////////////////////////////////////
+
+class TestState : public Test {
+    protected:
+        State olt_state;
+
+        virtual void SetUp() {
+        }
+
+        virtual void TearDown() {
+        }
+};
+
+// Test 1 - A waiter is woken by the activation instead of a poll tick
+TEST_F(TestState, WaitUntilActivatedWakesOnActivate) {
+    auto start = std::chrono::steady_clock::now();
+    std::thread activator([this]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        olt_state.activate();
+    });
+
+    ASSERT_TRUE(olt_state.wait_until_activated(start + std::chrono::seconds(10)));
+    ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+    activator.join();
+}
+
+// Test 2 - The wait gives up at the deadline
+TEST_F(TestState, WaitUntilActivatedTimesOut) {
+    ASSERT_FALSE(olt_state.wait_until_activated(std::chrono::steady_clock::now() + std::chrono::milliseconds(20)));
+}
+
+// Test 3 - Callbacks run once per transition, not on repeated connect/disconnect
+TEST_F(TestState, CallbacksRunOnTransitions) {
+    int connected = 0, disconnected = 0;
+
+    olt_state.on_connected([&connected]() { connected++; });
+    olt_state.on_disconnected([&disconnected]() { disconnected++; });
+
+    olt_state.disconnect();
+    olt_state.connect();
+    olt_state.connect();
+    olt_state.disconnect();
+    olt_state.disconnect();
+
+    ASSERT_EQ(connected, 1);
+    ASSERT_EQ(disconnected, 1);
+    ASSERT_TRUE(olt_state.previously_connected());
+    ASSERT_FALSE(olt_state.is_connected());
+}
+
+////////////////////////////////////////////////////////////////////////////
+// For testing rebuilding the agent state on warm restart
+////////////////////////////////////////////////////////////////////////////
+
+class TestWarmRestart : public Test {
+    protected:
+        NiceMock<BalMocker> balMock;
+        std::map<flow_pair, int32_t> saved_flow_map;
+        std::bitset<MAX_FLOW_ID> saved_flow_id_bitset;
+        std::bitset<MAX_TM_SCHED_ID> saved_tm_sched_bitset;
+        std::bitset<MAX_TM_QMP_ID> saved_tm_qmp_bitset;
+        std::map<int, std::vector < uint32_t > > saved_qmp_id_to_qmp_map;
+
+        virtual void SetUp() {
+            saved_flow_map = flow_map;
+            saved_flow_id_bitset = flow_id_bitset;
+            saved_tm_sched_bitset = tm_sched_bitset;
+            saved_tm_qmp_bitset = tm_qmp_bitset;
+            saved_qmp_id_to_qmp_map = qmp_id_to_qmp_map;
+        }
+
+        virtual void TearDown() {
+            flow_map = saved_flow_map;
+            flow_id_counters = flow_map.size();
+            flow_id_bitset = saved_flow_id_bitset;
+            tm_sched_bitset = saved_tm_sched_bitset;
+            tm_qmp_bitset = saved_tm_qmp_bitset;
+            qmp_id_to_qmp_map = saved_qmp_id_to_qmp_map;
+        }
+};
+
+// Test 1 - Nothing configured in BAL leaves the allocators as they are
+TEST_F(TestWarmRestart, NothingConfigured) {
+    ON_CALL(balMock, bcmolt_cfg_get(_, _)).WillByDefault(Return(BCM_ERR_NOENT));
+
+    Status st = rebuild_state_from_bal();
+
+    ASSERT_TRUE(st.ok());
+    ASSERT_EQ(flow_map, saved_flow_map);
+    ASSERT_EQ(flow_id_bitset, saved_flow_id_bitset);
+    ASSERT_EQ(tm_sched_bitset, saved_tm_sched_bitset);
+    ASSERT_EQ(tm_qmp_bitset, saved_tm_qmp_bitset);
+}
+
+// Test 2 - IDs of the objects configured in BAL are not handed out again, the
+// ones BAL answers for without being configured stay free
+TEST_F(TestWarmRestart, ConfiguredIdsAreTaken) {
+    // the even IDs are configured, the odd ones are not
+    ON_CALL(balMock, bcmolt_cfg_get(_, _)).WillByDefault(Invoke([] (bcmolt_oltid olt, bcmolt_cfg *cfg) {
+        switch (cfg->hdr.obj_type) {
+            case BCMOLT_OBJ_ID_FLOW: {
+                bcmolt_flow_cfg* flow_cfg = (bcmolt_flow_cfg*)cfg;
+                flow_cfg->data.state = (flow_cfg->key.flow_id % 2) ? BCMOLT_FLOW_STATE_NOT_CONFIGURED : BCMOLT_FLOW_STATE_ENABLE;
+                break;
+            }
+            case BCMOLT_OBJ_ID_TM_SCHED: {
+                bcmolt_tm_sched_cfg* sched_cfg = (bcmolt_tm_sched_cfg*)cfg;
+                sched_cfg->data.state = (sched_cfg->key.id % 2) ? BCMOLT_CONFIG_STATE_NOT_CONFIGURED : BCMOLT_CONFIG_STATE_CONFIGURED;
+                break;
+            }
+            case BCMOLT_OBJ_ID_TM_QMP: {
+                bcmolt_tm_qmp_cfg* qmp_cfg = (bcmolt_tm_qmp_cfg*)cfg;
+                qmp_cfg->data.state = (qmp_cfg->key.id % 2) ? BCMOLT_CONFIG_STATE_NOT_CONFIGURED : BCMOLT_CONFIG_STATE_CONFIGURED;
+                break;
+            }
+            case BCMOLT_OBJ_ID_ACCESS_CONTROL:
+                ((bcmolt_access_control_cfg*)cfg)->data.state = BCMOLT_CONFIG_STATE_NOT_CONFIGURED;
+                break;
+            default:
+                break;
+        }
+        return BCM_ERR_OK;
+    }));
+
+    Status st = rebuild_state_from_bal();
+
+    ASSERT_TRUE(st.ok());
+    ASSERT_EQ(flow_id_counters, (uint16_t)flow_map.size());
+    for (uint32_t flow_id = FLOW_ID_START; flow_id < MAX_FLOW_ID; flow_id++) {
+        bool configured = flow_id % 2 == 0;
+        ASSERT_EQ((bool)flow_id_bitset[flow_id], configured || saved_flow_id_bitset[flow_id]);
+        ASSERT_EQ(flow_map.count(flow_pair(flow_id, BCMOLT_FLOW_TYPE_DOWNSTREAM)),
+            (configured || saved_flow_map.count(flow_pair(flow_id, BCMOLT_FLOW_TYPE_DOWNSTREAM))) ? 1 : 0);
+    }
+    ASSERT_FALSE(tm_sched_bitset.all());
+    for (uint32_t sched_id = 0; sched_id < MAX_TM_SCHED_ID; sched_id++) {
+        ASSERT_EQ((bool)tm_sched_bitset[sched_id], sched_id % 2 == 0 || saved_tm_sched_bitset[sched_id]);
+    }
+    ASSERT_FALSE(tm_qmp_bitset.all());
+    for (uint32_t tm_qmp_id = 0; tm_qmp_id < MAX_TM_QMP_ID; tm_qmp_id++) {
+        ASSERT_EQ((bool)tm_qmp_bitset[tm_qmp_id], tm_qmp_id % 2 == 0 || saved_tm_qmp_bitset[tm_qmp_id]);
+        ASSERT_EQ(qmp_id_to_qmp_map.count(tm_qmp_id),
+            (tm_qmp_id % 2 == 0 || saved_qmp_id_to_qmp_map.count(tm_qmp_id)) ? 1 : 0);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////
+// For testing the state journal
+////////////////////////////////////////////////////////////////////////////
+
+#define TEST_STATE_SNAPSHOT_FILE "./test_state.snapshot"
+#define TEST_STATE_JOURNAL_FILE "./test_state.journal"
+
+class TestStateJournal : public Test {
+    protected:
+        std::map<sched_map_key_tuple, int> saved_sched_map;
+        std::bitset<MAX_TM_SCHED_ID> saved_tm_sched_bitset;
+        std::bitset<MAX_FLOW_ID> saved_flow_id_bitset;
+        std::map<uint64_t, device_flow> saved_voltha_flow_to_device_flow;
+        std::map<pon_gem, onu_uni> saved_pon_gem_to_onu_uni_map;
+
+        virtual void SetUp() {
+            saved_sched_map = sched_map;
+            saved_tm_sched_bitset = tm_sched_bitset;
+            saved_flow_id_bitset = flow_id_bitset;
+            saved_voltha_flow_to_device_flow = voltha_flow_to_device_flow;
+            saved_pon_gem_to_onu_uni_map = pon_gem_to_onu_uni_map;
+            ASSERT_TRUE(state_journal_open(TEST_STATE_SNAPSHOT_FILE, TEST_STATE_JOURNAL_FILE, false));
+        }
+
+        virtual void TearDown() {
+            state_journal_close();
+            std::remove(TEST_STATE_SNAPSHOT_FILE);
+            std::remove(TEST_STATE_JOURNAL_FILE);
+            sched_map = saved_sched_map;
+            tm_sched_bitset = saved_tm_sched_bitset;
+            flow_id_bitset = saved_flow_id_bitset;
+            voltha_flow_to_device_flow = saved_voltha_flow_to_device_flow;
+            pon_gem_to_onu_uni_map = saved_pon_gem_to_onu_uni_map;
+        }
+
+        // simulates the agent restart
+        void restart() {
+            state_journal_close();
+            sched_map = saved_sched_map;
+            tm_sched_bitset = saved_tm_sched_bitset;
+            flow_id_bitset = saved_flow_id_bitset;
+            voltha_flow_to_device_flow = saved_voltha_flow_to_device_flow;
+            pon_gem_to_onu_uni_map = saved_pon_gem_to_onu_uni_map;
+            ASSERT_TRUE(state_journal_open(TEST_STATE_SNAPSHOT_FILE, TEST_STATE_JOURNAL_FILE, true));
+        }
+};
+
+// Test 1 - Allocations and frees are replayed after a restart
+TEST_F(TestStateJournal, RestoreFromJournal) {
+    uint32_t sched_id = get_tm_sched_id(1, 1, 0, downstream, 64);
+    uint32_t freed_sched_id = get_tm_sched_id(1, 2, 0, downstream, 64);
+    free_tm_sched_id(1, 2, 0, downstream, 64);
+    device_flow dev_fl = device_flow();
+    dev_fl.flow_type = upstream;
+    dev_fl.params[0].flow_id = 4000;
+    dev_fl.params[0].gemport_id = 1024;
+    dev_fl.params[0].pbit = 0xff;
+    update_voltha_flow_to_cache(123, dev_fl);
+
+    restart();
+
+    ASSERT_TRUE(is_tm_sched_id_present(1, 1, 0, downstream, 64));
+    ASSERT_FALSE(is_tm_sched_id_present(1, 2, 0, downstream, 64));
+    ASSERT_TRUE(tm_sched_bitset[sched_id]);
+    ASSERT_FALSE(tm_sched_bitset[freed_sched_id]);
+    ASSERT_TRUE(flow_id_bitset[4000]);
+    const device_flow *restored = get_device_flow(123);
+    ASSERT_TRUE(restored != NULL);
+    ASSERT_EQ(restored->params[0].gemport_id, 1024);
+    ASSERT_EQ(restored->params[0].pbit, 0xff);
+}
+
+// Test 2 - The changes made after a compaction are replayed on top of the snapshot
+TEST_F(TestStateJournal, RestoreAfterCompaction) {
+    pon_gem pg(1, 1024);
+    onu_uni ou(1, 0);
+    get_tm_sched_id(1, 1, 0, upstream, 64);
+    ASSERT_TRUE(state_journal_compact());
+    pon_gem_to_onu_uni_map[pg] = ou;
+    state_journal_gem_set(pg, ou);
+
+    restart();
+
+    ASSERT_TRUE(is_tm_sched_id_present(1, 1, 0, upstream, 64));
+    ASSERT_EQ(pon_gem_to_onu_uni_map.count(pg), 1);
+}
+
+// Test 3 - The replay stops at a torn record
+TEST_F(TestStateJournal, TornRecordIsDropped) {
+    pon_gem pg(1, 1024);
+    onu_uni ou(1, 0);
+    get_tm_sched_id(1, 1, 0, upstream, 64);
+    pon_gem_to_onu_uni_map[pg] = ou;
+    state_journal_gem_set(pg, ou);
+    state_journal_close();
+
+    std::fstream journal(TEST_STATE_JOURNAL_FILE, std::ios::in | std::ios::out | std::ios::binary);
+    std::string head(4096, '\0');
+    journal.read(&head[0], head.size());
+    journal.clear();
+    journal.seekp(head.find("gem "));
+    journal.write("X", 1);
+    journal.close();
+
+    restart();
+
+    ASSERT_TRUE(is_tm_sched_id_present(1, 1, 0, upstream, 64));
+    ASSERT_EQ(pon_gem_to_onu_uni_map.count(pg), 0);
+}
+
+////////////////////////////////////////////////////////////////////////////
+// For testing the oper state replay on reconciliation
+////////////////////////////////////////////////////////////////////////////
+
+class TestReplayIndications : public Test {
+    protected:
+        NiceMock<BalMocker> balMock;
+        unsigned int saved_num_of_pon_ports;
+
+        virtual void SetUp() {
+            saved_num_of_pon_ports = num_of_pon_ports;
+            num_of_pon_ports = 2;
+            state.connect();
+        }
+
+        virtual void TearDown() {
+            num_of_pon_ports = saved_num_of_pon_ports;
+            state.disconnect();
+            while (oltIndQ.size() > 0) {
+                oltIndQ.pop(10);
+            }
+        }
+
+        bcmolt_pon_interface_cfg pon_cfg_in_state(bcmolt_interface_state intf_state) {
+            bcmolt_pon_interface_cfg pon_cfg;
+            bcmolt_pon_interface_key key = {};
+            BCMOLT_CFG_INIT(&pon_cfg, pon_interface, key);
+            pon_cfg.data.state = intf_state;
+            return pon_cfg;
+        }
+};
+
+// Test 1 - The ONUs of a PON that is down are not walked
+TEST_F(TestReplayIndications, PonDown) {
+    EXPECT_GLOBAL_CALL(bcmolt_cfg_get__pon_intf_stub, bcmolt_cfg_get__pon_intf_stub(_, _))
+                     .WillOnce(DoAll(SetArg1ToBcmOltPonCfg(pon_cfg_in_state(BCMOLT_INTERFACE_STATE_INACTIVE)), Return(BCM_ERR_OK)));
+    EXPECT_CALL(balMock, bcmolt_cfg_get(_, _)).Times(0);
+
+    ASSERT_EQ(ReplayIndications(0), 0);
+
+    std::pair<openolt::Indication, bool> ind = oltIndQ.pop(10);
+    ASSERT_TRUE(ind.second);
+    ASSERT_TRUE(ind.first.has_intf_oper_ind());
+    ASSERT_EQ(ind.first.intf_oper_ind().intf_id(), 0);
+    ASSERT_EQ(ind.first.intf_oper_ind().oper_state(), "down");
+    ASSERT_EQ(oltIndQ.size(), 0);
+}
+
+// Test 2 - Only the filtered PON is replayed, ONUs that are not configured are skipped
+TEST_F(TestReplayIndications, PonFilter) {
+    EXPECT_GLOBAL_CALL(bcmolt_cfg_get__pon_intf_stub, bcmolt_cfg_get__pon_intf_stub(_, _))
+                     .WillOnce(DoAll(SetArg1ToBcmOltPonCfg(pon_cfg_in_state(BCMOLT_INTERFACE_STATE_ACTIVE_WORKING)), Return(BCM_ERR_OK)));
+    EXPECT_CALL(balMock, bcmolt_cfg_get(_, _)).Times(ONU_ID_END - ONU_ID_START + 1).WillRepeatedly(Return(BCM_ERR_NOENT));
+
+    ASSERT_EQ(ReplayIndications(1), 0);
+
+    std::pair<openolt::Indication, bool> ind = oltIndQ.pop(10);
+    ASSERT_TRUE(ind.second);
+    ASSERT_EQ(ind.first.intf_oper_ind().intf_id(), 1);
+    ASSERT_EQ(ind.first.intf_oper_ind().oper_state(), "up");
+    ASSERT_EQ(oltIndQ.size(), 0);
+}
+
+// Test 3 - The ONUs of the PONs that are up are replayed in order, a page at a time
+TEST_F(TestReplayIndications, ActiveOnus) {
+    uint32_t num_onus = 0;
+    std::atomic<bool> done(false);
+    size_t queued_at_last_pon = 0;
+
+    num_of_pon_ports = 3;
+    onu_state_cache.clear();
+    EXPECT_GLOBAL_CALL(bcmolt_cfg_get__pon_intf_stub, bcmolt_cfg_get__pon_intf_stub(_, _))
+                     .WillRepeatedly(DoAll(SetArg1ToBcmOltPonCfg(pon_cfg_in_state(BCMOLT_INTERFACE_STATE_ACTIVE_WORKING)), Return(BCM_ERR_OK)));
+    ON_CALL(balMock, bcmolt_cfg_get(_, _)).WillByDefault(Invoke([&queued_at_last_pon](bcmolt_oltid olt, bcmolt_cfg *cfg) {
+        bcmolt_onu_cfg *onu_cfg = (bcmolt_onu_cfg*)cfg;
+        if (onu_cfg->key.onu_id == ONU_ID_START + 1) {
+            onu_cfg->data.onu_state = BCMOLT_ONU_STATE_DISABLED;
+        } else if (onu_cfg->key.onu_id == ONU_ID_START + 2) {
+            onu_cfg->data.onu_state = BCMOLT_ONU_STATE_INACTIVE;
+        } else {
+            onu_cfg->data.onu_state = BCMOLT_ONU_STATE_ACTIVE;
+        }
+        if (onu_cfg->key.pon_ni == 2 && onu_cfg->key.onu_id == ONU_ID_START) {
+            queued_at_last_pon = oltIndQ.size();
+        }
+        return BCM_ERR_OK;
+    }));
+
+    std::thread replay([&num_onus, &done]() {
+        num_onus = ReplayIndications(-1);
+        done = true;
+    });
+    // The page is full, the walk waits for the stream to drain
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_FALSE(done);
+    EXPECT_GT(oltIndQ.size(), RECONCILE_PAGE_SIZE);
+
+    for (uint32_t intf_id = 0; intf_id < num_of_pon_ports; intf_id++) {
+        // a failure does not return before the replay thread is joined
+        std::pair<openolt::Indication, bool> ind = oltIndQ.pop(1000);
+        EXPECT_TRUE(ind.second);
+        EXPECT_TRUE(ind.first.has_intf_oper_ind());
+        EXPECT_EQ(ind.first.intf_oper_ind().intf_id(), intf_id);
+        EXPECT_EQ(ind.first.intf_oper_ind().oper_state(), "up");
+        for (uint32_t onu_id = ONU_ID_START; onu_id <= ONU_ID_END; onu_id++) {
+            ind = oltIndQ.pop(1000);
+            EXPECT_TRUE(ind.second);
+            EXPECT_TRUE(ind.first.has_onu_ind());
+            EXPECT_EQ(ind.first.onu_ind().intf_id(), intf_id);
+            EXPECT_EQ(ind.first.onu_ind().onu_id(), onu_id);
+            EXPECT_EQ(ind.first.onu_ind().oper_state(), onu_id == ONU_ID_START || onu_id > ONU_ID_START + 2 ? "up" : "down");
+            EXPECT_EQ(ind.first.onu_ind().admin_state(), onu_id == ONU_ID_START + 1 ? "down" : "up");
+        }
+    }
+    replay.join();
+    ASSERT_EQ(num_onus, num_of_pon_ports * MAX_ONUS_PER_PON);
+    // at most a page of ONUs and the last PON were queued
+    ASSERT_LE(queued_at_last_pon, RECONCILE_PAGE_SIZE + 1);
+    ASSERT_EQ(oltIndQ.size(), 0);
+}
+
+////////////////////////////////////////////////////////////////////////////
+// For testing the ONU state cache
+////////////////////////////////////////////////////////////////////////////
+
+class TestOnuStateCache : public Test {
+    protected:
+        NiceMock<BalMocker> balMock;
+        uint32_t pon_id = 0;
+        uint32_t onu_id = 1;
+
+        virtual void SetUp() {
+        }
+
+        virtual void TearDown() {
+            onu_state_cache.clear();
+        }
+};
+
+// Test 1 - The state reported by an indication is served without a BAL get
+TEST_F(TestOnuStateCache, CacheHit) {
+    bcmolt_onu_state onu_state;
+
+    update_onu_state_cache(pon_id, onu_id, BCMOLT_ONU_STATE_ACTIVE);
+    EXPECT_CALL(balMock, bcmolt_cfg_get(_, _)).Times(0);
+
+    ASSERT_EQ(get_onu_state((bcmolt_interface)pon_id, onu_id, &onu_state), BCM_ERR_OK);
+    ASSERT_EQ(onu_state, BCMOLT_ONU_STATE_ACTIVE);
+}
+
+// Test 2 - A state change of the ONU or of its PON falls back to BAL
+TEST_F(TestOnuStateCache, Invalidate) {
+    bcmolt_onu_state onu_state;
+
+    update_onu_state_cache(pon_id, onu_id, BCMOLT_ONU_STATE_ACTIVE);
+    update_onu_state_cache(pon_id, onu_id + 1, BCMOLT_ONU_STATE_ACTIVE);
+    invalidate_onu_state_cache(pon_id, onu_id);
+    EXPECT_CALL(balMock, bcmolt_cfg_get(_, _)).Times(2).WillRepeatedly(Return(BCM_ERR_OK));
+
+    ASSERT_EQ(get_onu_state((bcmolt_interface)pon_id, onu_id, &onu_state), BCM_ERR_OK);
+    ASSERT_TRUE(get_cached_onu_state(pon_id, onu_id + 1, &onu_state));
+
+    invalidate_pon_onu_state_cache(pon_id);
+    ASSERT_FALSE(get_cached_onu_state(pon_id, onu_id + 1, &onu_state));
+    ASSERT_EQ(get_onu_state((bcmolt_interface)pon_id, onu_id + 1, &onu_state), BCM_ERR_OK);
+}
+
+////////////////////////////////////////////////////////////////////////////
+// For testing the ONU serial number index
+////////////////////////////////////////////////////////////////////////////
+
+class TestOnuSnIndex : public Test {
+    protected:
+        onu_sn_key sn = get_onu_sn_key("BRCM", "\x12\x34\x56\x78");
+
+        virtual void SetUp() {
+        }
+
+        virtual void TearDown() {
+            onu_sn_index.clear();
+            onu_to_sn_map.clear();
+            onu_sn_duplicate_count = 0;
+        }
+};
+
+// Test 1 - The serial number is packed as vendor_id followed by vendor_specific
+TEST_F(TestOnuSnIndex, PackSerialNumber) {
+    ASSERT_EQ(sn, 0x4252434d12345678ULL);
+}
+
+// Test 2 - A serial number discovered on another PON than the one it is activated on is a duplicate
+TEST_F(TestOnuSnIndex, DuplicateSerialNumber) {
+    uint32_t pon_intf_id, onu_id;
+
+    ASSERT_FALSE(onu_sn_index_discovered(0, sn));
+    ASSERT_TRUE(onu_sn_index_lookup(sn, &pon_intf_id, &onu_id));
+    ASSERT_EQ(onu_id, 0);
+
+    ASSERT_TRUE(onu_sn_index_activated(0, 5, sn));
+    ASSERT_FALSE(onu_sn_index_discovered(0, sn));
+    ASSERT_TRUE(onu_sn_index_discovered(1, sn));
+    ASSERT_EQ(onu_sn_duplicate_count, 1);
+    ASSERT_TRUE(onu_sn_index_lookup(sn, &pon_intf_id, &onu_id));
+    ASSERT_EQ(pon_intf_id, 0);
+    ASSERT_EQ(onu_id, 5);
+
+    onu_sn_index_remove(0, 5);
+    ASSERT_FALSE(onu_sn_index_lookup(sn, &pon_intf_id, &onu_id));
+}
+
+////////////////////////////////////////////////////////////////////////////
+// For testing the ONU discovery de-duplication
+////////////////////////////////////////////////////////////////////////////
+
+class TestOnuDiscovery : public Test {
+    protected:
+        onu_sn_key sn = get_onu_sn_key("BRCM", "\x12\x34\x56\x78");
+        uint32_t saved_onu_discovery_window;
+
+        virtual void SetUp() {
+            saved_onu_discovery_window = onu_discovery_window;
+            onu_discovery_window = 60;
+            memset(onu_discovery_forwarded_count, 0, sizeof(onu_discovery_forwarded_count));
+            memset(onu_discovery_suppressed_count, 0, sizeof(onu_discovery_suppressed_count));
+        }
+
+        virtual void TearDown() {
+            onu_discovery_window = saved_onu_discovery_window;
+            onu_discovery_map.clear();
+        }
+};
+
+// Test 1 - Repeated discoveries of a serial number on a PON are suppressed within the window
+TEST_F(TestOnuDiscovery, SuppressWithinWindow) {
+    ASSERT_FALSE(onu_discovery_suppressed(0, sn));
+    ASSERT_TRUE(onu_discovery_suppressed(0, sn));
+    ASSERT_TRUE(onu_discovery_suppressed(0, sn));
+    // the same serial number on another PON is tracked separately
+    ASSERT_FALSE(onu_discovery_suppressed(1, sn));
+
+    ASSERT_EQ(onu_discovery_forwarded_count[0], 1);
+    ASSERT_EQ(onu_discovery_suppressed_count[0], 2);
+    ASSERT_EQ(onu_discovery_forwarded_count[1], 1);
+}
+
+// Test 2 - A forgotten ONU, or a window of 0, lets the next discovery through
+TEST_F(TestOnuDiscovery, ForgetAndDisable) {
+    ASSERT_FALSE(onu_discovery_suppressed(0, sn));
+    onu_discovery_forget(0, sn);
+    ASSERT_FALSE(onu_discovery_suppressed(0, sn));
+    onu_discovery_forget_pon(0);
+    ASSERT_FALSE(onu_discovery_suppressed(0, sn));
+
+    onu_discovery_window = 0;
+    ASSERT_FALSE(onu_discovery_suppressed(0, sn));
+    ASSERT_EQ(onu_discovery_suppressed_count[0], 0);
+}
+
+////////////////////////////////////////////////////////////////////////////
+// For testing the ONU statistics cache filled by the sweep
+////////////////////////////////////////////////////////////////////////////
+
+class TestOnuStatsCache : public Test {
+    protected:
+        uint32_t pon_id = 1;
+        uint32_t onu_id = ONU_ID_START;
+
+        virtual void SetUp() {
+        }
+
+        virtual void TearDown() {
+            invalidate_onu_stats_cache(pon_id, onu_id);
+        }
+
+        openolt::OnuStatistics swept_onu_stats(time_t timestamp) {
+            openolt::OnuStatistics onu_stats;
+            onu_stats.set_intf_id(pon_id);
+            onu_stats.set_onu_id(onu_id);
+            onu_stats.set_bip_errors(7);
+            onu_stats.set_fec_codewords(1000);
+            onu_stats.set_timestamp(timestamp);
+            return onu_stats;
+        }
+};
+
+// Test 1 - The counters of the sweep are returned until the ONU is invalidated
+TEST_F(TestOnuStatsCache, CacheHit) {
+    openolt::OnuStatistics onu_stats;
+
+    update_onu_stats_cache(swept_onu_stats(time(NULL)));
+    ASSERT_TRUE(get_cached_onu_statistics(pon_id, onu_id, &onu_stats));
+    ASSERT_EQ(onu_stats.intf_id(), pon_id);
+    ASSERT_EQ(onu_stats.onu_id(), onu_id);
+    ASSERT_EQ(onu_stats.bip_errors(), 7);
+    ASSERT_EQ(onu_stats.fec_codewords(), 1000);
+
+    invalidate_onu_stats_cache(pon_id, onu_id);
+    ASSERT_FALSE(get_cached_onu_statistics(pon_id, onu_id, &onu_stats));
+}
+
+// Test 2 - Counters older than two sweep intervals are not returned
+TEST_F(TestOnuStatsCache, StaleCounters) {
+    openolt::OnuStatistics onu_stats;
+
+    update_onu_stats_cache(swept_onu_stats(time(NULL) - 3 * STATS_SWEEP_INTERVAL));
+    ASSERT_FALSE(get_cached_onu_statistics(pon_id, onu_id, &onu_stats));
+    ASSERT_FALSE(get_cached_onu_statistics(pon_id, ONU_ID_END + 1, &onu_stats));
+}
+
+////////////////////////////////////////////////////////////////////////////
+// For testing the GEM port statistics cache filled by the sweep
+////////////////////////////////////////////////////////////////////////////
+
+class TestGemStatsCache : public Test {
+    protected:
+        uint32_t pon_id = 2;
+        uint32_t onu_id = 1;
+
+        virtual void SetUp() {
+        }
+
+        virtual void TearDown() {
+            for (uint32_t gemport_id = 1024; gemport_id < 1030; gemport_id++) {
+                invalidate_gem_stats_cache(pon_id, gemport_id);
+            }
+            pon_gem_to_onu_uni_map.clear();
+        }
+
+        void sweep_gem(uint32_t gemport_id, uint32_t uni_id, uint64_t rx_bytes) {
+            openolt::GemPortStatistics gemport_stats;
+            gemport_stats.set_intf_id(pon_id);
+            gemport_stats.set_gemport_id(gemport_id);
+            gemport_stats.set_rx_bytes(rx_bytes);
+            gemport_stats.set_tx_bytes(2 * rx_bytes);
+            gemport_stats.set_timestamp(time(NULL));
+            update_gem_stats_cache(onu_id, uni_id, gemport_stats);
+        }
+};
+
+// Test 1 - The swept counters of a GEM port are returned from the cache, per PON
+TEST_F(TestGemStatsCache, CachedCounters) {
+    openolt::GemPortStatistics gemport_stats;
+
+    sweep_gem(1024, 0, 100);
+    sweep_gem(1026, 1, 400);
+
+    ASSERT_TRUE(get_cached_gemport_statistics(pon_id, 1026, &gemport_stats));
+    ASSERT_EQ(gemport_stats.intf_id(), pon_id);
+    ASSERT_EQ(gemport_stats.gemport_id(), 1026);
+    ASSERT_EQ(gemport_stats.rx_bytes(), 400);
+    ASSERT_EQ(gemport_stats.tx_bytes(), 800);
+    ASSERT_FALSE(get_cached_gemport_statistics(pon_id, 1025, &gemport_stats));
+    ASSERT_FALSE(get_cached_gemport_statistics(pon_id + 1, 1024, &gemport_stats));
+}
+
+// Test 2 - The sweep drops the GEM ports that are no longer mapped to a UNI
+TEST_F(TestGemStatsCache, SweepDropsRemovedGem) {
+    openolt::GemPortStatistics gemport_stats;
+
+    sweep_gem(1024, 0, 100);
+    sweep_gem(1025, 0, 200);
+    pon_gem_to_onu_uni_map[pon_gem(pon_id, 1025)] = onu_uni(onu_id, 0);
+
+    sweep_gem_statistics();
+    ASSERT_FALSE(get_cached_gemport_statistics(pon_id, 1024, &gemport_stats));
+    ASSERT_TRUE(get_cached_gemport_statistics(pon_id, 1025, &gemport_stats));
+    ASSERT_EQ(gemport_stats.rx_bytes(), 200);
+}
+
+////////////////////////////////////////////////////////////////////////////
+// For testing the statistics history
+////////////////////////////////////////////////////////////////////////////
+
+class TestStatsHistory : public Test {
+    protected:
+        uint32_t pon_id = 3;
+        uint32_t onu_id = ONU_ID_START;
+
+        virtual void SetUp() {
+        }
+
+        virtual void TearDown() {
+            clear_onu_stats_history(pon_id, onu_id);
+        }
+
+        void record(time_t timestamp, uint64_t rx_bytes) {
+            uint64_t counters[STATS_HISTORY_NUM_COUNTERS] = {rx_bytes, 0, 0, 0, 0};
+            record_onu_stats_history(pon_id, onu_id, timestamp, counters);
+        }
+};
+
+// Test 1 - A 64-bit wrap gives the increase across it, a reset counts from 0
+TEST_F(TestStatsHistory, CounterWrap) {
+    ASSERT_EQ(stats_history_delta(100, 150), 50);
+    ASSERT_EQ(stats_history_delta(UINT64_MAX - 9, 10), 20);
+    ASSERT_EQ(stats_history_delta(1000, 10), 10);
+}
+
+// Test 2 - The samples are returned oldest first, with the deltas and the smoothed rate
+TEST_F(TestStatsHistory, SamplesAndRate) {
+    std::vector<stats_history_sample> samples;
+    double rates[STATS_HISTORY_NUM_COUNTERS];
+
+    ASSERT_FALSE(get_onu_stats_rates(pon_id, onu_id, rates));
+    record(1000, 0);
+    for (int i = 1; i <= STATS_HISTORY_DEPTH + 5; i++) {
+        record(1000 + 10 * i, 1000 * i);
+    }
+
+    ASSERT_EQ(get_onu_stats_history(pon_id, onu_id, 3, &samples), 3);
+    ASSERT_EQ(samples[0].timestamp, 1000 + 10 * (STATS_HISTORY_DEPTH + 3));
+    ASSERT_EQ(samples[2].timestamp, 1000 + 10 * (STATS_HISTORY_DEPTH + 5));
+    ASSERT_EQ(samples[2].interval, 10);
+    ASSERT_EQ(samples[2].delta[STATS_HISTORY_RX_BYTES], 1000);
+
+    samples.clear();
+    ASSERT_EQ(get_onu_stats_history(pon_id, onu_id, 2 * STATS_HISTORY_DEPTH, &samples), STATS_HISTORY_DEPTH);
+    ASSERT_TRUE(get_onu_stats_rates(pon_id, onu_id, rates));
+    ASSERT_DOUBLE_EQ(rates[STATS_HISTORY_RX_BYTES], 100.0);
+}
+
+// Test 3 - The rates of a port are logged once it has a sample, with those of the busiest ONU of a PON
+TEST_F(TestStatsHistory, LogRates) {
+    uint32_t nni_id = STATS_HISTORY_NNI_PORTS - 1;
+    uint64_t counters[STATS_HISTORY_NUM_COUNTERS] = {0, 0, 0, 0, 0};
+
+    ASSERT_FALSE(log_port_stats_rates(BCMOLT_INTERFACE_TYPE_NNI, nni_id));
+    record_port_stats_history(BCMOLT_INTERFACE_TYPE_NNI, nni_id, 1000, counters);
+    ASSERT_FALSE(log_port_stats_rates(BCMOLT_INTERFACE_TYPE_NNI, nni_id));
+    counters[STATS_HISTORY_RX_BYTES] = 1500000;
+    record_port_stats_history(BCMOLT_INTERFACE_TYPE_NNI, nni_id, 1015, counters);
+    ASSERT_TRUE(log_port_stats_rates(BCMOLT_INTERFACE_TYPE_NNI, nni_id));
+
+    record(1000, 0);
+    record(1015, 150000);
+    record_port_stats_history(BCMOLT_INTERFACE_TYPE_PON, pon_id, 1000, counters);
+    counters[STATS_HISTORY_RX_BYTES] = 3000000;
+    record_port_stats_history(BCMOLT_INTERFACE_TYPE_PON, pon_id, 1015, counters);
+    ASSERT_TRUE(log_port_stats_rates(BCMOLT_INTERFACE_TYPE_PON, pon_id));
+}
+
+////////////////////////////////////////////////////////////////////////////
+// For testing the threshold alarms
+////////////////////////////////////////////////////////////////////////////
+
+class TestThresholdAlarms : public Test {
+    protected:
+        uint32_t pon_id = 5;
+        uint32_t onu_id = ONU_ID_START + 2;
+        pon_onu_stats snapshot = {};
+
+        virtual void SetUp() {
+        }
+
+        virtual void TearDown() {
+            clear_onu_thresholds(pon_id, onu_id);
+            while (oltIndQ.size() > 0) {
+                oltIndQ.pop(10);
+            }
+        }
+
+        void set_bip(time_t timestamp, uint64_t bip_units, uint64_t bip_errors) {
+            int i = onu_id - ONU_ID_START;
+            snapshot.timestamp[i] = timestamp;
+            snapshot.bip_units[i] = bip_units;
+            snapshot.bip_errors[i] = bip_errors;
+        }
+};
+
+// Test 1 - Crossing the BIP error threshold raises a signal degrade alarm once
+TEST_F(TestThresholdAlarms, Crossed) {
+    time_t now = 1000;
+
+    set_bip(now, 1000000000, 0);
+    ASSERT_EQ(evaluate_onu_thresholds(pon_id, snapshot, now), 0);
+    now += THRESHOLD_WINDOW;
+    set_bip(now, 2000000000, 10000);
+    ASSERT_EQ(evaluate_onu_thresholds(pon_id, snapshot, now), 1);
+
+    std::pair<openolt::Indication, bool> ind = oltIndQ.pop(10);
+    ASSERT_TRUE(ind.second);
+    ASSERT_TRUE(ind.first.alarm_ind().has_onu_signal_degrade_ind());
+    ASSERT_EQ(ind.first.alarm_ind().onu_signal_degrade_ind().intf_id(), pon_id);
+    ASSERT_EQ(ind.first.alarm_ind().onu_signal_degrade_ind().onu_id(), onu_id);
+    ASSERT_EQ(ind.first.alarm_ind().onu_signal_degrade_ind().status(), "on");
+    ASSERT_EQ(ind.first.alarm_ind().onu_signal_degrade_ind().inverse_bit_error_rate(), 100000);
+
+    // Still above the threshold, nothing new to report
+    now += THRESHOLD_WINDOW;
+    set_bip(now, 3000000000, 20000);
+    ASSERT_EQ(evaluate_onu_thresholds(pon_id, snapshot, now), 0);
+    ASSERT_EQ(oltIndQ.size(), 0);
+}
+
+// Test 2 - The alarm is cleared after a window below the threshold, not before the window is over
+TEST_F(TestThresholdAlarms, Cleared) {
+    time_t now = 2000;
+
+    set_bip(now, 1000000000, 0);
+    evaluate_onu_thresholds(pon_id, snapshot, now);
+    now += THRESHOLD_WINDOW;
+    set_bip(now, 2000000000, 10000);
+    ASSERT_EQ(evaluate_onu_thresholds(pon_id, snapshot, now), 1);
+    oltIndQ.pop(10);
+
+    set_bip(now + 1, 3000000000, 10000);
+    ASSERT_EQ(evaluate_onu_thresholds(pon_id, snapshot, now + 1), 0);
+    now += THRESHOLD_WINDOW;
+    set_bip(now, 3000000000, 10000);
+    ASSERT_EQ(evaluate_onu_thresholds(pon_id, snapshot, now), 1);
+
+    std::pair<openolt::Indication, bool> ind = oltIndQ.pop(10);
+    ASSERT_TRUE(ind.second);
+    ASSERT_EQ(ind.first.alarm_ind().onu_signal_degrade_ind().status(), "off");
+}
+
+// Test 3 - An alarm raised by BAL is left to BAL, the agent raises it again once BAL has cleared it
+TEST_F(TestThresholdAlarms, RaisedByBal) {
+    time_t now = 3000;
+
+    set_onu_bal_signal_degrade(pon_id, onu_id, true);
+    set_bip(now, 1000000000, 0);
+    evaluate_onu_thresholds(pon_id, snapshot, now);
+    now += THRESHOLD_WINDOW;
+    set_bip(now, 2000000000, 10000);
+    ASSERT_EQ(evaluate_onu_thresholds(pon_id, snapshot, now), 0);
+    // Below the threshold, BAL's alarm is not cleared by the agent
+    now += THRESHOLD_WINDOW;
+    set_bip(now, 2000000000, 10000);
+    ASSERT_EQ(evaluate_onu_thresholds(pon_id, snapshot, now), 0);
+    ASSERT_EQ(oltIndQ.size(), 0);
+
+    set_onu_bal_signal_degrade(pon_id, onu_id, false);
+    now += THRESHOLD_WINDOW;
+    set_bip(now, 3000000000, 10000);
+    ASSERT_EQ(evaluate_onu_thresholds(pon_id, snapshot, now), 0);
+    now += THRESHOLD_WINDOW;
+    set_bip(now, 4000000000, 20000);
+    ASSERT_EQ(evaluate_onu_thresholds(pon_id, snapshot, now), 1);
+
+    std::pair<openolt::Indication, bool> ind = oltIndQ.pop(10);
+    ASSERT_TRUE(ind.second);
+    ASSERT_EQ(ind.first.alarm_ind().onu_signal_degrade_ind().status(), "on");
+}
+
+////////////////////////////////////////////////////////////////////////////
+// For testing the top talkers of the GEM ports
+////////////////////////////////////////////////////////////////////////////
+
+class TestGemTopTalkers : public Test {
+    protected:
+        uint32_t pon_id = 6;
+
+        virtual void SetUp() {
+        }
+
+        virtual void TearDown() {
+            clear_gem_top_talkers(pon_id);
+            clear_gem_top_talkers(pon_id + 1);
+        }
+};
+
+// Test 1 - The GEM ports with the most bytes are kept, those read after them with fewer bytes are dropped
+TEST_F(TestGemTopTalkers, HeavyHitters) {
+    std::vector<gem_top_talker> talkers;
+
+    // one sweep reads each GEM port once
+    for (uint32_t gemport_id = 1024; gemport_id < 1024 + GEM_TOP_TALKERS; gemport_id++) {
+        gem_top_talkers_add(pon_id, gemport_id, 1, 0, 1000);
+    }
+    for (uint32_t gemport_id = 1024 + GEM_TOP_TALKERS; gemport_id < 1024 + 2 * GEM_TOP_TALKERS; gemport_id++) {
+        gem_top_talkers_add(pon_id, gemport_id, 1, 0, 1);
+    }
+    gem_top_talkers_add(pon_id, 4000, 2, 0, 1000000);
+    gem_top_talkers_add(pon_id, 4001, 3, 1, 500000);
+    gem_top_talkers_rotate();
+
+    ASSERT_EQ(get_gem_top_talkers(pon_id, 2, &talkers), 2);
+    ASSERT_EQ(talkers[0].gemport_id, 4000);
+    ASSERT_EQ(talkers[0].onu_id, 2);
+    ASSERT_EQ(talkers[0].bytes, 1000000);
+    ASSERT_EQ(talkers[1].gemport_id, 4001);
+    ASSERT_EQ(talkers[1].uni_id, 1);
+    ASSERT_EQ(talkers[1].bytes, 500000);
+
+    // the idle GEM ports never replace a talker, the counts are exact
+    talkers.clear();
+    ASSERT_EQ(get_gem_top_talkers(pon_id, 2 * GEM_TOP_TALKERS, &talkers), GEM_TOP_TALKERS);
+    for (uint32_t i = 2; i < GEM_TOP_TALKERS; i++) {
+        ASSERT_LT(talkers[i].gemport_id, 1024 + GEM_TOP_TALKERS);
+        ASSERT_EQ(talkers[i].bytes, 1000);
+    }
+}
+
+// Test 2 - The talkers are those of the last complete sweep, per PON
+TEST_F(TestGemTopTalkers, LastSweep) {
+    std::vector<gem_top_talker> talkers;
+
+    gem_top_talkers_add(pon_id, 1024, 1, 0, 300);
+    gem_top_talkers_add(pon_id + 1, 2048, 5, 0, 200);
+    ASSERT_EQ(get_gem_top_talkers(pon_id, 5, &talkers), 0);
+
+    gem_top_talkers_rotate();
+    gem_top_talkers_add(pon_id, 1025, 1, 0, 900);
+    ASSERT_EQ(get_gem_top_talkers(pon_id, 5, &talkers), 1);
+    ASSERT_EQ(talkers[0].gemport_id, 1024);
+    ASSERT_EQ(talkers[0].bytes, 300);
+
+    talkers.clear();
+    ASSERT_EQ(get_gem_top_talkers(pon_id + 1, 5, &talkers), 1);
+    ASSERT_EQ(talkers[0].gemport_id, 2048);
+}
+
+////////////////////////////////////////////////////////////////////////////
+// For testing the flow statistics collection
+////////////////////////////////////////////////////////////////////////////
+
+class TestFlowStats : public Test {
+    protected:
+        std::map<uint64_t, device_flow> saved_voltha_flow_to_device_flow;
+        uint32_t saved_flow_stats_budget;
+
+        virtual void SetUp() {
+            saved_voltha_flow_to_device_flow = voltha_flow_to_device_flow;
+            saved_flow_stats_budget = flow_stats_budget;
+            voltha_flow_to_device_flow.clear();
+            init_stats();
+        }
+
+        virtual void TearDown() {
+            voltha_flow_to_device_flow = saved_voltha_flow_to_device_flow;
+            flow_stats_budget = saved_flow_stats_budget;
+            init_stats();
+            while (oltIndQ.size() > 0) {
+                oltIndQ.pop(10);
+            }
+        }
+
+        void add_flow(uint64_t voltha_flow_id, const std::string& flow_type, uint16_t flow_id, uint8_t num_replicated) {
+            device_flow dev_fl = device_flow();
+            dev_fl.flow_type = flow_type;
+            dev_fl.voltha_flow_id = voltha_flow_id;
+            dev_fl.is_flow_replicated = num_replicated > 1;
+            dev_fl.total_replicated_flows = num_replicated;
+            for (uint8_t i = 0; i < num_replicated; i++) {
+                dev_fl.params[i].flow_id = flow_id + i;
+                dev_fl.params[i].pbit = i;
+            }
+            voltha_flow_to_device_flow[voltha_flow_id] = dev_fl;
+        }
+};
+
+// Test 1 - The flows are read in turn within the budget, replicated flows are not split
+TEST_F(TestFlowStats, Rotation) {
+    std::vector<flow_pair> batch;
+
+    add_flow(10, upstream, 100, 1);
+    add_flow(20, downstream, 200, 4);
+    add_flow(30, multicast, 300, 1);
+    add_flow(40, upstream, 400, 1);
+
+    ASSERT_EQ(next_flow_stats_batch(4, &batch), 1);
+    ASSERT_EQ(batch[0], flow_pair(100, BCMOLT_FLOW_TYPE_UPSTREAM));
+
+    batch.clear();
+    ASSERT_EQ(next_flow_stats_batch(5, &batch), 5);
+    ASSERT_EQ(batch[0], flow_pair(200, BCMOLT_FLOW_TYPE_DOWNSTREAM));
+    ASSERT_EQ(batch[3], flow_pair(203, BCMOLT_FLOW_TYPE_DOWNSTREAM));
+    ASSERT_EQ(batch[4], flow_pair(400, BCMOLT_FLOW_TYPE_UPSTREAM));
+
+    // a flow replicated over more BAL flows than the budget is skipped
+    batch.clear();
+    ASSERT_EQ(next_flow_stats_batch(2, &batch), 2);
+    ASSERT_EQ(batch[0], flow_pair(100, BCMOLT_FLOW_TYPE_UPSTREAM));
+    ASSERT_EQ(batch[1], flow_pair(400, BCMOLT_FLOW_TYPE_UPSTREAM));
+}
+
+// Test 2 - The flows read are cached and sent to VOLTHA
+TEST_F(TestFlowStats, Indications) {
+    openolt::FlowStatistics flow_stats;
+
+    add_flow(10, upstream, 100, 1);
+    add_flow(20, downstream, 200, 1);
+    flow_stats_budget = 1;
+
+    ASSERT_EQ(collect_flow_statistics(), 1);
+    ASSERT_TRUE(get_cached_flow_statistics(100, BCMOLT_FLOW_TYPE_UPSTREAM, &flow_stats));
+    ASSERT_FALSE(get_cached_flow_statistics(200, BCMOLT_FLOW_TYPE_DOWNSTREAM, &flow_stats));
+
+    std::pair<openolt::Indication, bool> ind = oltIndQ.pop(10);
+    ASSERT_TRUE(ind.second);
+    ASSERT_TRUE(ind.first.has_flow_stats());
+    ASSERT_EQ(ind.first.flow_stats().flow_id(), 100);
+
+    invalidate_flow_stats_cache(100, BCMOLT_FLOW_TYPE_UPSTREAM);
+    ASSERT_FALSE(get_cached_flow_statistics(100, BCMOLT_FLOW_TYPE_UPSTREAM, &flow_stats));
+}
+
+////////////////////////////////////////////////////////////////////////////
+// For testing the cached rx power of the RSSI sweep
+////////////////////////////////////////////////////////////////////////////
+
+class TestRssiCache : public Test {
+    protected:
+        NiceMock<BalMocker> balMock;
+        uint32_t pon_id = 1;
+        uint32_t onu_id = 4;
+
+        virtual void SetUp() {
+        }
+
+        virtual void TearDown() {
+            invalidate_onu_rx_power_cache(pon_id, onu_id);
+        }
+
+        void measured(time_t timestamp, double rx_power_mean_dbm) {
+            onu_rssi_complete_result result{};
+            result.pon_intf_id = pon_id;
+            result.onu_id = onu_id;
+            result.status = "success";
+            result.rx_power_mean_dbm = rx_power_mean_dbm;
+            update_onu_rx_power_cache(result, timestamp);
+        }
+};
+
+// Test 1 - A recent measurement is returned without measuring the ONU again
+TEST_F(TestRssiCache, CacheHit) {
+    openolt::PonRxPowerData rx_power;
+    std::vector<onu_rssi_complete_result> results;
+
+    measured(time(NULL), -21.5);
+    EXPECT_CALL(balMock, bcmolt_oper_submit(_, _)).Times(0);
+
+    Status status = GetPonRxPower_(pon_id, onu_id, &rx_power);
+    ASSERT_TRUE(status.ok());
+    ASSERT_EQ(rx_power.onu_id(), onu_id);
+    ASSERT_DOUBLE_EQ(rx_power.rx_power_mean_dbm(), -21.5);
+
+    ASSERT_EQ(get_cached_pon_rx_power(pon_id, &results), 1);
+    ASSERT_EQ(get_cached_pon_rx_power(pon_id + 1, &results), 0);
+}
+
+// Test 2 - An old measurement is measured again
+TEST_F(TestRssiCache, Stale) {
+    openolt::PonRxPowerData rx_power;
+
+    measured(time(NULL) - rssi_sweep_interval - 1, -21.5);
+    EXPECT_CALL(balMock, bcmolt_oper_submit(_, _)).WillOnce(Return(BCM_ERR_INTERNAL));
+
+    Status status = GetPonRxPower_(pon_id, onu_id, &rx_power);
+    ASSERT_FALSE(status.ok());
+}
+
+////////////////////////////////////////////////////////////////////////////
+// For testing the asynchronous OPENOLT_LOG backend
+////////////////////////////////////////////////////////////////////////////
+
+// Last message written by the bcm_dev_log_log stub
+extern char log_string[];
+extern bcm_dev_log_level stub_log_level;
+
+class TestAsyncLog : public Test {
+    protected:
+        virtual void SetUp() {
+            start_async_log();
+        }
+
+        virtual void TearDown() {
+            stop_async_log();
+        }
+};
+
+// Test 1 - The arguments are copied when logging, strings by value
+TEST_F(TestAsyncLog, DeferredFormat) {
+    char flow_type[16] = "upstream";
+    uint16_t flow_id = 5;
+    uint64_t cookie = 1ULL << 40;
+
+    OPENOLT_LOG(INFO, openolt_log_id, "flow %u %s cookie %lu\n", flow_id, flow_type, cookie);
+    strcpy(flow_type, "downstream");
+    stop_async_log();
+    ASSERT_NE(strstr(log_string, "flow 5 upstream cookie 1099511627776\n"), nullptr);
+
+    uint64_t written, dropped;
+    get_async_log_stats(&written, &dropped);
+    // logged synchronously once stopped
+    OPENOLT_LOG(INFO, openolt_log_id, "flow %u %s\n", flow_id, flow_type);
+    uint64_t written_after, dropped_after;
+    get_async_log_stats(&written_after, &dropped_after);
+    ASSERT_EQ(written_after, written);
+}
+
+// Test 2 - Every message of a burst is either written or counted as dropped
+TEST_F(TestAsyncLog, DropCounter) {
+    uint64_t written, dropped, written_after, dropped_after;
+    std::vector<std::thread> threads;
+
+    get_async_log_stats(&written, &dropped);
+    for (int t = 0; t < 2; t++) {
+        threads.emplace_back([t]() {
+            for (int i = 0; i < 1000; i++) {
+                OPENOLT_LOG(INFO, openolt_log_id, "packet indication %d from thread %d on %s\n", i, t, "pon");
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    stop_async_log();
+    get_async_log_stats(&written_after, &dropped_after);
+    ASSERT_EQ((written_after - written) + (dropped_after - dropped), 2000);
+}
+
+// Test 3 - Cost of a log call on the calling thread: queued, filtered out by its level and synchronous
+TEST_F(TestAsyncLog, HotPathCost) {
+    // a batch fits in the ring of the thread, the ring is written between the batches
+    const int batches = 20;
+    const int calls = 500;
+    uint64_t written, dropped;
+    long async_ns = 0;
+    long filtered_ns = 0;
+
+    get_async_log_stats(&written, &dropped);
+    for (int b = 0; b < batches; b++) {
+        auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < calls; i++) {
+            OPENOLT_LOG(INFO, openolt_log_id, "flow add %d, onu %d, %s\n", i, i % 32, "downstream");
+        }
+        async_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+        async_log_flush();
+    }
+
+    stub_log_level = DEV_LOG_LEVEL_INFO;
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < batches * calls; i++) {
+        OPENOLT_LOG(DEBUG, openolt_log_id, "flow add %d, onu %d, %s\n", i, i % 32, "downstream");
+    }
+    filtered_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+    stub_log_level = DEV_LOG_LEVEL_DEBUG;
+    stop_async_log();
+
+    begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < batches * calls; i++) {
+        OPENOLT_LOG(INFO, openolt_log_id, "flow add %d, onu %d, %s\n", i, i % 32, "downstream");
+    }
+    long sync_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+
+    std::cout << "OPENOLT_LOG cost per call: asynchronous " << async_ns / (batches * calls)
+              << " ns, below the level " << filtered_ns / (batches * calls)
+              << " ns, synchronous " << sync_ns / (batches * calls) << " ns" << std::endl;
+    uint64_t written_after, dropped_after;
+    get_async_log_stats(&written_after, &dropped_after);
+    ASSERT_EQ((written_after - written) + (dropped_after - dropped), batches * calls);
+}
+
+// Test 4 - An error is written before returning, after the queued messages of the thread
+TEST_F(TestAsyncLog, ErrorIsSynchronous) {
+    uint64_t written, dropped, written_after, dropped_after;
+
+    get_async_log_stats(&written, &dropped);
+    OPENOLT_LOG(INFO, openolt_log_id, "flow add %d on %s\n", 1, "pon");
+    OPENOLT_LOG(ERROR, openolt_log_id, "flow add %d failed\n", 1);
+    get_async_log_stats(&written_after, &dropped_after);
+    ASSERT_EQ(dropped_after, dropped);
+    ASSERT_EQ(written_after - written, 1);
+}
+
+// Test 5 - A message queued after the log is stopped is still written
+TEST_F(TestAsyncLog, QueuedAfterStop) {
+    uint64_t written, dropped, written_after, dropped_after;
+
+    stop_async_log();
+    get_async_log_stats(&written, &dropped);
+    // as if the caller had seen the log running just before it was stopped
+    async_log(DEV_LOG_LEVEL_INFO, openolt_log_id, "flow add %d on %s\n", 2, "pon");
+    get_async_log_stats(&written_after, &dropped_after);
+    ASSERT_EQ(dropped_after, dropped);
+    ASSERT_EQ(written_after - written, 1);
+    ASSERT_NE(strstr(log_string, "flow add 2 on pon\n"), nullptr);
+}
+
+// Test 6 - A message below the level of its log id is not queued
+TEST_F(TestAsyncLog, BelowLevel) {
+    uint64_t written, dropped, written_after, dropped_after;
+
+    stub_log_level = DEV_LOG_LEVEL_INFO;
+    get_async_log_stats(&written, &dropped);
+    OPENOLT_LOG(DEBUG, openolt_log_id, "flow add %d on %s\n", 3, "pon");
+    OPENOLT_LOG(INFO, openolt_log_id, "flow add %d on %s\n", 4, "pon");
+    stop_async_log();
+    stub_log_level = DEV_LOG_LEVEL_DEBUG;
+    get_async_log_stats(&written_after, &dropped_after);
+    ASSERT_EQ(dropped_after, dropped);
+    ASSERT_EQ(written_after - written, 1);
+    ASSERT_NE(strstr(log_string, "flow add 4 on pon\n"), nullptr);
+}
+
+////////////////////////////////////////////////////////////////////////////
+// For testing the MAC device connect tracking of Enable_
+////////////////////////////////////////////////////////////////////////////
+
+class TestMacDeviceConnect : public Test {
+    protected:
+        virtual void SetUp() {
+            bcmos_fastlock_init(&mac_device_connect_lock, 0);
+            mac_device_connect_map.clear();
+            mac_device_connect_armed = false;
+            mac_device_connected_cnt = 0;
+            state.deactivate();
+        }
+
+        virtual void TearDown() {
+            mac_device_connect_map.clear();
+            mac_device_connect_armed = false;
+            mac_device_connected_cnt = 0;
+            state.deactivate();
+        }
+};
+
+// Test 1 - The OLT is activated once every submitted device has connected
+TEST_F(TestMacDeviceConnect, AllCompleted) {
+    mac_device_connect_start(0);
+    mac_device_connect_start(1);
+    mac_device_connect_arm();
+    ASSERT_FALSE(state.is_activated());
+
+    ASSERT_TRUE(mac_device_connect_done(0, true));
+    ASSERT_FALSE(state.is_activated());
+    ASSERT_TRUE(mac_device_connect_done(1, true));
+    ASSERT_TRUE(state.is_activated());
+    ASSERT_TRUE(mac_device_connect_map.empty());
+    ASSERT_FALSE(mac_device_connect_armed);
+}
+
+// Test 2 - The OLT is activated if one device connected and the other one failed
+TEST_F(TestMacDeviceConnect, OneFailed) {
+    mac_device_connect_start(0);
+    mac_device_connect_start(1);
+    mac_device_connect_arm();
+
+    ASSERT_TRUE(mac_device_connect_done(1, false));
+    ASSERT_FALSE(state.is_activated());
+    ASSERT_TRUE(mac_device_connect_done(0, true));
+    ASSERT_TRUE(state.is_activated());
+}
+
+// Test 3 - The OLT is not activated if every submitted device failed
+TEST_F(TestMacDeviceConnect, AllFailed) {
+    mac_device_connect_start(0);
+    mac_device_connect_arm();
+
+    ASSERT_TRUE(mac_device_connect_done(0, false));
+    ASSERT_FALSE(state.is_activated());
+    ASSERT_FALSE(mac_device_connect_armed);
+}
+
+// Test 4 - A device aborted before the arm does not hold back the activation
+TEST_F(TestMacDeviceConnect, AbortBeforeArm) {
+    mac_device_connect_start(0);
+    mac_device_connect_start(1);
+    mac_device_connect_abort(1);
+    // not armed yet, the connect of the other devices is still being submitted
+    ASSERT_FALSE(mac_device_connect_armed);
+    ASSERT_FALSE(state.is_activated());
+
+    mac_device_connect_arm();
+    ASSERT_FALSE(state.is_activated());
+    ASSERT_TRUE(mac_device_connect_done(0, true));
+    ASSERT_TRUE(state.is_activated());
+}
+
+// Test 5 - A done indication for a device which was never submitted is not a startup connect
+TEST_F(TestMacDeviceConnect, NotSubmitted) {
+    mac_device_connect_start(0);
+    mac_device_connect_arm();
+
+    ASSERT_FALSE(mac_device_connect_done(1, true));
+    ASSERT_FALSE(state.is_activated());
+    ASSERT_EQ(mac_device_connected_cnt, 0);
+    ASSERT_EQ(mac_device_connect_map.size(), 1);
+
+    ASSERT_TRUE(mac_device_connect_done(0, true));
+    ASSERT_TRUE(state.is_activated());
+    // the device reconnecting later does not go through the startup tracking again
+    ASSERT_FALSE(mac_device_connect_done(0, true));
+}
+
+// Test 6 - Devices already connected, submitted and failed to submit are mixed
+TEST_F(TestMacDeviceConnect, MixedAlreadySubmittedFailed) {
+    // device 0 is already connected, Enable_ activates right away
+    mac_device_connect_already(0);
+    state.activate();
+    // device 1 is submitted, the submit of device 2 fails
+    mac_device_connect_start(1);
+    mac_device_connect_start(2);
+    mac_device_connect_abort(2);
+    mac_device_connect_arm();
+    ASSERT_EQ(mac_device_connect_map.size(), 1);
+
+    // the failure of the submitted device must not deactivate the OLT
+    ASSERT_TRUE(mac_device_connect_done(1, false));
+    ASSERT_TRUE(state.is_activated());
+    ASSERT_TRUE(mac_device_connect_map.empty());
+}